@@ -0,0 +1,262 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+/*----------------------------------------------------------------------------*/
+/*!
+\file Arena.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Implementation of the class Arena.
+*/
+/*----------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include <new>
+#include <utility>
+
+#include "Arena.h"
+
+// Blocks are aligned to and padded to a multiple of a cache line
+#define CACHE_LINE_SIZE 64
+
+// Blocks of at least this size are backed by huge pages
+#define HUGE_PAGE_SIZE ( 2 * 1024 * 1024 )
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor for an empty arena
+*/
+/*----------------------------------------------------------------------------*/
+Arena::Arena() :
+   m_Data( NULL ),
+   m_Bytes( 0 ),
+   m_MapBytes( 0 )
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor
+\param bytes The size of the block
+*/
+/*----------------------------------------------------------------------------*/
+Arena::Arena( size_t bytes ) :
+   Arena()
+{
+   allocate( bytes );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Copy constructor
+*/
+/*----------------------------------------------------------------------------*/
+Arena::Arena( const Arena &other ) :
+   Arena()
+{
+   *this = other;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Move constructor
+*/
+/*----------------------------------------------------------------------------*/
+Arena::Arena( Arena &&other ) noexcept :
+   Arena()
+{
+   *this = std::move( other );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Destructor
+*/
+/*----------------------------------------------------------------------------*/
+Arena::~Arena()
+{
+   release();
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Copy the contents of another arena. The block is only reallocated if the
+sizes differ.
+*/
+/*----------------------------------------------------------------------------*/
+Arena &Arena::operator=( const Arena &other )
+{
+   if( this != &other )
+   {
+      if( m_Bytes != other.m_Bytes )
+      {
+         release();
+         allocate( other.m_Bytes );
+      }
+      if( m_Bytes > 0 )
+      {
+         memcpy( m_Data, other.m_Data, m_Bytes );
+      }
+   }
+
+   return( *this );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Take over the block of another arena, leaving the other one empty.
+*/
+/*----------------------------------------------------------------------------*/
+Arena &Arena::operator=( Arena &&other ) noexcept
+{
+   if( this != &other )
+   {
+      release();
+      m_Data = other.m_Data;
+      m_Bytes = other.m_Bytes;
+      m_MapBytes = other.m_MapBytes;
+
+      other.m_Data = NULL;
+      other.m_Bytes = 0;
+      other.m_MapBytes = 0;
+   }
+
+   return( *this );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The start of the block
+*/
+/*----------------------------------------------------------------------------*/
+void *Arena::data() const
+{
+   return( m_Data );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The size of the block in bytes
+*/
+/*----------------------------------------------------------------------------*/
+size_t Arena::size() const
+{
+   return( m_Bytes );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param bytes A size in bytes
+\return The size rounded up to a multiple of a cache line, so the next part
+of a block starts on a cache line boundary as well
+*/
+/*----------------------------------------------------------------------------*/
+size_t Arena::align( size_t bytes )
+{
+   return( ( ( bytes + CACHE_LINE_SIZE - 1 ) / CACHE_LINE_SIZE ) * CACHE_LINE_SIZE );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Allocate the block. Large blocks are mapped in whole, aligned huge pages
+which the kernel is asked to back with transparent huge pages, so streaming
+through them doesn't thrash the TLB. Since mmap() only aligns to a page, a
+huge page more is mapped and the unaligned ends are unmapped again. The pages
+of an anonymous mapping are only allocated when they are touched first.
+\param bytes The size of the block
+\throw std::bad_alloc if the block can't be allocated
+*/
+/*----------------------------------------------------------------------------*/
+void Arena::allocate( size_t bytes )
+{
+   m_Bytes = align( bytes );
+   m_MapBytes = 0;
+   m_Data = NULL;
+
+   if( m_Bytes < 1 )
+   {
+      return;
+   }
+
+   if( m_Bytes >= HUGE_PAGE_SIZE )
+   {
+      size_t mapBytes = ( ( m_Bytes + HUGE_PAGE_SIZE - 1 ) / HUGE_PAGE_SIZE ) * HUGE_PAGE_SIZE;
+      void *p = mmap( NULL, mapBytes + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+      if( p != MAP_FAILED )
+      {
+         char *start = (char *)p;
+         char *aligned = (char *)( ( (uintptr_t)start + HUGE_PAGE_SIZE - 1 ) & ~( (uintptr_t)HUGE_PAGE_SIZE - 1 ) );
+         if( aligned > start )
+         {
+            munmap( start, aligned - start );
+         }
+         if( aligned + mapBytes < start + mapBytes + HUGE_PAGE_SIZE )
+         {
+            munmap( aligned + mapBytes, start + HUGE_PAGE_SIZE - aligned );
+         }
+#ifdef MADV_HUGEPAGE
+         madvise( aligned, mapBytes, MADV_HUGEPAGE );
+#endif
+         m_Data = aligned;
+         m_MapBytes = mapBytes;
+      }
+   }
+
+   if( !m_Data )
+   {
+      m_Data = aligned_alloc( CACHE_LINE_SIZE, m_Bytes );
+      if( !m_Data )
+      {
+         m_Bytes = 0;
+         throw std::bad_alloc();
+      }
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Free the block
+*/
+/*----------------------------------------------------------------------------*/
+void Arena::release()
+{
+   if( m_MapBytes > 0 )
+   {
+      munmap( m_Data, m_MapBytes );
+   } else
+   {
+      free( m_Data );
+   }
+
+   m_Data = NULL;
+   m_Bytes = 0;
+   m_MapBytes = 0;
+}
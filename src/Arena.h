@@ -0,0 +1,68 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+/*----------------------------------------------------------------------------*/
+/*!
+\file Arena.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for class Arena
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+
+/*----------------------------------------------------------------------------*/
+/*!
+\class Arena
+\date  2026-10-18
+
+A single block of memory which starts on a cache line boundary. Large blocks
+are backed by transparent huge pages. The memory isn't touched when it's
+allocated, so its pages end up on the NUMA node of the thread which writes
+them first. Allocation failures throw std::bad_alloc.
+*/
+/*----------------------------------------------------------------------------*/
+class Arena
+{
+public:
+   Arena();
+   Arena( size_t bytes );
+   Arena( const Arena &other );
+   Arena( Arena &&other ) noexcept;
+   ~Arena();
+
+   Arena &operator=( const Arena &other );
+   Arena &operator=( Arena &&other ) noexcept;
+
+   void *data() const;
+   size_t size() const;
+
+   static size_t align( size_t bytes );
+
+private:
+   void allocate( size_t bytes );
+   void release();
+
+private:
+   void *m_Data;
+   size_t m_Bytes;
+   size_t m_MapBytes;
+};
+
+#endif
@@ -0,0 +1,232 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file BackpropSelector.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Implementation of the class BackpropSelector, which picks the training
+samples whose error is backpropagated.
+*/
+/*----------------------------------------------------------------------------*/
+#include <algorithm>
+
+#include "BackpropSelector.h"
+
+// The number of recent losses the percentile and the mean loss are taken of
+#define SELECTOR_HISTORY 1024
+
+// The number of samples after which the percentile is determined anew
+#define SELECTOR_UPDATE_INTERVAL 64
+
+// The maximum weight of the learning rate of a sample with SELECT_IMPORTANCE.
+// It bounds the probability of samples with a tiny loss from below.
+#define SELECTOR_MAX_WEIGHT 4.0
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor
+\param mode How the samples are selected
+\param keepFraction The fraction of the samples to backpropagate, from 0.0
+to 1.0
+\param nWarmup The number of samples at the start of the training which are
+all backpropagated
+\param seed The seed of the random choice with SELECT_IMPORTANCE
+*/
+/*----------------------------------------------------------------------------*/
+BackpropSelector::BackpropSelector( Mode mode, double keepFraction, long nWarmup, uint64_t seed ) :
+   m_Mode( mode ),
+   m_Keep( std::min( 1.0, std::max( 0.0, keepFraction ) ) ),
+   m_nWarmup( nWarmup ),
+   m_Random( seed, RANDOM_SELECT_STREAM ),
+   m_HistoryPos( 0 ),
+   m_HistorySum( 0.0 ),
+   m_Threshold( -1.0 ),
+   m_nTotal( 0 ),
+   m_nSeen( 0 ),
+   m_nSkipped( 0 )
+{
+   m_History.reserve( SELECTOR_HISTORY );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Destructor
+*/
+/*----------------------------------------------------------------------------*/
+BackpropSelector::~BackpropSelector()
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Decide whether a sample is backpropagated.
+\param loss The loss of the network for the sample
+\param weight Receives the factor of the learning rate of the sample
+\return true if the sample is to be backpropagated, false if it's skipped
+*/
+/*----------------------------------------------------------------------------*/
+bool BackpropSelector::select( double loss, double &weight )
+{
+   m_nTotal++;
+   m_nSeen++;
+   weight = 1.0;
+
+   if( m_History.size() < SELECTOR_HISTORY )
+   {
+      m_History.push_back( loss );
+   } else
+   {
+      m_HistorySum -= m_History[m_HistoryPos];
+      m_History[m_HistoryPos] = loss;
+   }
+   m_HistorySum += loss;
+   m_HistoryPos = ( m_HistoryPos + 1 ) % SELECTOR_HISTORY;
+
+   if( m_Mode == SELECT_ALL || m_nTotal <= m_nWarmup || m_History.size() < SELECTOR_UPDATE_INTERVAL )
+   {
+      return( true );
+   }
+
+   bool selected;
+   if( m_Mode == SELECT_PERCENTILE )
+   {
+      if( m_Threshold < 0.0 || m_nTotal % SELECTOR_UPDATE_INTERVAL == 0 )
+      {
+         std::vector<double> losses( m_History );
+         size_t n = (size_t)( ( 1.0 - m_Keep ) * ( losses.size() - 1 ) );
+         std::nth_element( losses.begin(), losses.begin() + n, losses.end() );
+         m_Threshold = losses[n];
+      }
+      selected = loss >= m_Threshold;
+   } else
+   {
+      double mean = m_HistorySum / m_History.size();
+      double p = mean > 0.0 ? m_Keep * loss / mean : 1.0;
+      p = std::min( 1.0, std::max( p, m_Keep / SELECTOR_MAX_WEIGHT ) );
+      selected = m_Random.uniform() < p;
+      weight = m_Keep / p;
+   }
+
+   if( !selected )
+   {
+      m_nSkipped++;
+   }
+
+   return( selected );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of samples seen since the last call of resetStats()
+*/
+/*----------------------------------------------------------------------------*/
+long BackpropSelector::numSeen() const
+{
+   return( m_nSeen );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of samples skipped since the last call of resetStats()
+*/
+/*----------------------------------------------------------------------------*/
+long BackpropSelector::numSkipped() const
+{
+   return( m_nSkipped );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The fraction of the samples skipped since the last call of
+resetStats()
+*/
+/*----------------------------------------------------------------------------*/
+double BackpropSelector::skipRate() const
+{
+   return( m_nSeen > 0 ? (double)m_nSkipped / m_nSeen : 0.0 );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Reset the numbers of seen and skipped samples. The recent losses and the
+warmup are kept.
+*/
+/*----------------------------------------------------------------------------*/
+void BackpropSelector::resetStats()
+{
+   m_nSeen = 0;
+   m_nSkipped = 0;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param mode A mode
+\return The name of the mode
+*/
+/*----------------------------------------------------------------------------*/
+const char *BackpropSelector::modeName( Mode mode )
+{
+   switch( mode )
+   {
+      case SELECT_PERCENTILE:
+         return( "percentile" );
+      case SELECT_IMPORTANCE:
+         return( "importance" );
+      default:
+         return( "all" );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param name The name of a mode: "all", "percentile" or "importance"
+\param mode Receives the mode
+\return true on success, false if the name is unknown
+*/
+/*----------------------------------------------------------------------------*/
+bool BackpropSelector::parseMode( const std::string &name, Mode &mode )
+{
+   if( name == "all" )
+   {
+      mode = SELECT_ALL;
+   } else
+   if( name == "percentile" )
+   {
+      mode = SELECT_PERCENTILE;
+   } else
+   if( name == "importance" )
+   {
+      mode = SELECT_IMPORTANCE;
+   } else
+   {
+      return( false );
+   }
+
+   return( true );
+}
@@ -0,0 +1,100 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file BackpropSelector.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for class BackpropSelector
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __BACKPROPSELECTOR_H__
+#define __BACKPROPSELECTOR_H__
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "Random.h"
+
+/*----------------------------------------------------------------------------*/
+/*!
+\class BackpropSelector
+\date  2026-10-18
+
+Decides, after the forward pass of a training sample, whether the error is
+backpropagated and the weights are adjusted (see NeuralNetwork::setSelector()).
+Samples the network has already learned well have a small loss and
+contribute little to the weights, but the backward pass costs about twice
+as much as the forward pass.
+
+With SELECT_PERCENTILE, a sample is backpropagated if its loss is at least
+the (1 - keepFraction) percentile of the losses of the recent samples. With
+SELECT_IMPORTANCE, a sample is backpropagated with a probability in
+proportion to its loss, keepFraction of the samples on average. Its
+learning rate is weighted with keepFraction divided by that probability, so
+the adjustments still follow the gradient of all samples, and the weights
+of the backpropagated samples are 1 on average.
+
+During the first nWarmup samples, all samples are backpropagated.
+*/
+/*----------------------------------------------------------------------------*/
+class BackpropSelector
+{
+public:
+   typedef enum
+   {
+      SELECT_ALL,
+      SELECT_PERCENTILE,
+      SELECT_IMPORTANCE
+   } Mode;
+
+public:
+   BackpropSelector( Mode mode, double keepFraction, long nWarmup, uint64_t seed );
+   ~BackpropSelector();
+
+   bool select( double loss, double &weight );
+
+   long numSeen() const;
+   long numSkipped() const;
+   double skipRate() const;
+   void resetStats();
+
+   static const char *modeName( Mode mode );
+   static bool parseMode( const std::string &name, Mode &mode );
+
+private:
+   Mode m_Mode;
+   double m_Keep;
+   long m_nWarmup;
+   Random m_Random;
+
+   // The losses of the recent samples, a ring buffer
+   std::vector<double> m_History;
+   size_t m_HistoryPos;
+   double m_HistorySum;
+   double m_Threshold;
+
+   long m_nTotal;
+   long m_nSeen;
+   long m_nSkipped;
+};
+
+#endif
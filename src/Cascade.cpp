@@ -0,0 +1,323 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file Cascade.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Implementation of the class Cascade, which answers confidently
+classified input vectors with a small network and escalates the others to a
+large network.
+*/
+/*----------------------------------------------------------------------------*/
+#include <math.h>
+
+#include <algorithm>
+
+#include "Cascade.h"
+#include "util.h"
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor
+\param small The gatekeeper network
+\param large The network the input vectors the gatekeeper isn't confident
+about are escalated to
+\param threshold The minimum margin between the highest and the second
+highest output of the gatekeeper for its output to be the answer
+*/
+/*----------------------------------------------------------------------------*/
+Cascade::Cascade( const NeuralNetwork &small, const NeuralNetwork &large, double threshold ) :
+   m_Small( small ),
+   m_Large( large ),
+   m_Threshold( threshold ),
+   m_nQueries( 0 ),
+   m_nEscalated( 0 )
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Destructor
+*/
+/*----------------------------------------------------------------------------*/
+Cascade::~Cascade()
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Query the cascade with a batch of input vectors. All of them are run through
+the gatekeeper, then those with a margin below the threshold are run through
+the large network as one batch.
+\param inputVectors The input vectors
+\param outputVectors Receives one output vector per input vector, either
+from the gatekeeper or from the large network
+\return true on success, false if an input vector has the wrong size
+*/
+/*----------------------------------------------------------------------------*/
+bool Cascade::query( const std::vector<std::vector<double> > &inputVectors, std::vector<std::vector<double> > &outputVectors )
+{
+   if( !m_Small.query( inputVectors, outputVectors ) )
+   {
+      return( false );
+   }
+
+   std::vector<int> escalated;
+   for( int i = 0; i < outputVectors.size(); i++ )
+   {
+      if( !( margin( outputVectors[i] ) >= m_Threshold ) )
+      {
+         escalated.push_back( i );
+      }
+   }
+
+   if( !escalated.empty() )
+   {
+      std::vector<std::vector<double> > in( escalated.size() );
+      for( int i = 0; i < escalated.size(); i++ )
+      {
+         in[i] = inputVectors[escalated[i]];
+      }
+
+      std::vector<std::vector<double> > out;
+      if( !m_Large.query( in, out ) )
+      {
+         return( false );
+      }
+      for( int i = 0; i < escalated.size(); i++ )
+      {
+         outputVectors[escalated[i]].swap( out[i] );
+      }
+   }
+
+   m_nQueries += inputVectors.size();
+   m_nEscalated += escalated.size();
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Calibrate the threshold with a validation set. The threshold is set to the
+lowest margin which keeps the success rate of the cascade on the validation
+set at most maxLoss percentage points below that of the large network
+alone, so as many input vectors as possible stop at the gatekeeper.
+\param inputVectors The input vectors of the validation set
+\param labels The index of the expected highest output of each input vector
+\param maxLoss The tolerated loss of success rate in percentage points
+\return true on success, false if the validation set is empty or an input
+vector has the wrong size
+*/
+/*----------------------------------------------------------------------------*/
+bool Cascade::calibrate( const std::vector<std::vector<double> > &inputVectors, const std::vector<int> &labels, double maxLoss )
+{
+   std::vector<std::vector<double> > smallOut, largeOut;
+   if( inputVectors.empty() || labels.size() != inputVectors.size() ||
+       !m_Small.query( inputVectors, smallOut ) || !m_Large.query( inputVectors, largeOut ) )
+   {
+      return( false );
+   }
+
+   int n = inputVectors.size();
+   std::vector<double> margins( n );
+   std::vector<int> order( n );
+   int nLargePass = 0;
+   for( int i = 0; i < n; i++ )
+   {
+      margins[i] = margin( smallOut[i] );
+      order[i] = i;
+      nLargePass += util::indexOfMaxValue( largeOut[i] ) == labels[i];
+   }
+
+   // Most confident first. Accepting the first k input vectors at the
+   // gatekeeper replaces the answers of the large network for them.
+   std::stable_sort( order.begin(), order.end(), [&margins]( int a, int b )
+   {
+      return( margins[a] > margins[b] );
+   } );
+
+   double minPass = nLargePass - maxLoss * n / 100.0;
+   int nPass = nLargePass;
+   m_Threshold = INFINITY;
+   for( int k = 1; k <= n; k++ )
+   {
+      int i = order[k - 1];
+      nPass += ( util::indexOfMaxValue( smallOut[i] ) == labels[i] ) -
+               ( util::indexOfMaxValue( largeOut[i] ) == labels[i] );
+
+      // Input vectors with equal margins can only be accepted together
+      if( ( k == n || margins[order[k]] < margins[i] ) && nPass >= minPass )
+      {
+         m_Threshold = margins[i];
+      }
+   }
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param threshold The minimum margin of the gatekeeper for its output to be
+the answer
+*/
+/*----------------------------------------------------------------------------*/
+void Cascade::setThreshold( double threshold )
+{
+   m_Threshold = threshold;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The minimum margin of the gatekeeper for its output to be the answer
+*/
+/*----------------------------------------------------------------------------*/
+double Cascade::threshold() const
+{
+   return( m_Threshold );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of input vectors queried since the last call of
+resetStats()
+*/
+/*----------------------------------------------------------------------------*/
+long Cascade::numQueries() const
+{
+   return( m_nQueries );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of input vectors escalated to the large network since the
+last call of resetStats()
+*/
+/*----------------------------------------------------------------------------*/
+long Cascade::numEscalated() const
+{
+   return( m_nEscalated );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Reset the numbers of queried and escalated input vectors.
+*/
+/*----------------------------------------------------------------------------*/
+void Cascade::resetStats()
+{
+   m_nQueries = 0;
+   m_nEscalated = 0;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The floating point operations of a query of the gatekeeper
+*/
+/*----------------------------------------------------------------------------*/
+double Cascade::flopsSmall() const
+{
+   return( flops( m_Small ) );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The floating point operations of a query of the large network
+*/
+/*----------------------------------------------------------------------------*/
+double Cascade::flopsLarge() const
+{
+   return( flops( m_Large ) );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The average floating point operations per input vector queried since
+the last call of resetStats(). Every input vector pays for the gatekeeper,
+the escalated ones for the large network as well.
+*/
+/*----------------------------------------------------------------------------*/
+double Cascade::flopsPerQuery() const
+{
+   long nQueries = m_nQueries;
+   if( nQueries < 1 )
+   {
+      return( 0.0 );
+   }
+
+   return( flopsSmall() + flopsLarge() * m_nEscalated / nQueries );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param outputVector The output vector of a network
+\return The difference between the highest and the second highest output
+*/
+/*----------------------------------------------------------------------------*/
+double Cascade::margin( const std::vector<double> &outputVector )
+{
+   double first = -INFINITY;
+   double second = -INFINITY;
+   for( int i = 0; i < outputVector.size(); i++ )
+   {
+      if( outputVector[i] > first )
+      {
+         second = first;
+         first = outputVector[i];
+      } else
+      if( outputVector[i] > second )
+      {
+         second = outputVector[i];
+      }
+   }
+
+   return( outputVector.size() < 2 ? 0.0 : first - second );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param nn A network
+\return The floating point operations of a query of the network, counting
+each multiply-add as two
+*/
+/*----------------------------------------------------------------------------*/
+double Cascade::flops( const NeuralNetwork &nn )
+{
+   double n = 0.0;
+   for( int i = 1; i < nn.numLayers(); i++ )
+   {
+      n += 2.0 * nn.numMultiplyAdds( i );
+   }
+
+   return( n );
+}
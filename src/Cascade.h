@@ -0,0 +1,88 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file Cascade.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for class Cascade
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __CASCADE_H__
+#define __CASCADE_H__
+
+#include <atomic>
+#include <vector>
+
+#include "NeuralNetwork.h"
+
+/*----------------------------------------------------------------------------*/
+/*!
+\class Cascade
+\date  2026-10-18
+
+Queries a small, cheap gatekeeper network first and only escalates the input
+vectors it isn't confident about to a large network. The confidence of the
+gatekeeper is the margin between its highest and its second highest output.
+If the margin is at least the threshold, the output of the gatekeeper is the
+answer, otherwise the output of the large network.
+
+The threshold can be calibrated with a validation set, so the cascade is
+at most a given number of percentage points less accurate than the large
+network alone.
+
+Both networks must take the same input vectors, yield the same number of
+outputs and must not be modified while the Cascade exists.
+*/
+/*----------------------------------------------------------------------------*/
+class Cascade
+{
+public:
+   Cascade( const NeuralNetwork &small, const NeuralNetwork &large, double threshold );
+   ~Cascade();
+
+   bool query( const std::vector<std::vector<double> > &inputVectors, std::vector<std::vector<double> > &outputVectors );
+   bool calibrate( const std::vector<std::vector<double> > &inputVectors, const std::vector<int> &labels, double maxLoss );
+
+   void setThreshold( double threshold );
+   double threshold() const;
+
+   long numQueries() const;
+   long numEscalated() const;
+   void resetStats();
+
+   double flopsSmall() const;
+   double flopsLarge() const;
+   double flopsPerQuery() const;
+
+   static double margin( const std::vector<double> &outputVector );
+
+private:
+   static double flops( const NeuralNetwork &nn );
+
+private:
+   const NeuralNetwork &m_Small;
+   const NeuralNetwork &m_Large;
+   double m_Threshold;
+
+   std::atomic<long> m_nQueries;
+   std::atomic<long> m_nEscalated;
+};
+
+#endif
@@ -0,0 +1,308 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file DistributedTrainer.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Implementation of the class DistributedTrainer, multi-process
+data-parallel training.
+*/
+/*----------------------------------------------------------------------------*/
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+
+#include "DistributedTrainer.h"
+#include "Random.h"
+#include "ThreadPool.h"
+#include "Transport.h"
+#include "mnist.h"
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor
+\param nn The network to be trained
+\param nWorkers The number of worker processes
+\param syncInterval The number of samples each worker trains with between
+two synchronizations
+\param transport The transport for the allreduce
+\param basePort With TRANSPORT_TCP, worker n listens on port basePort + n
+*/
+/*----------------------------------------------------------------------------*/
+DistributedTrainer::DistributedTrainer( NeuralNetwork &nn, int nWorkers, int syncInterval, TransportType transport, int basePort ) :
+   m_NeuralNetwork( nn ),
+   m_nWorkers( nWorkers < 1 ? 1 : nWorkers ),
+   m_SyncInterval( syncInterval < 1 ? 1 : syncInterval ),
+   m_Transport( transport ),
+   m_BasePort( basePort ),
+   m_SamplesPerSecond( 0.0 )
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Destructor
+*/
+/*----------------------------------------------------------------------------*/
+DistributedTrainer::~DistributedTrainer()
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of samples per second all workers together trained with
+during the last call of train()
+*/
+/*----------------------------------------------------------------------------*/
+double DistributedTrainer::samplesPerSecond() const
+{
+   return( m_SamplesPerSecond );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Train the network. The worker processes are forked from this process, so
+they share the training samples and start with the current weights of the
+network. When they're done, the network receives the trained weights.
+
+\param dataset The training samples
+\param nEpochs The number of epochs
+\param seed The seed of the shuffling
+\param alpha The learning rate
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool DistributedTrainer::train( const mnist::Dataset &dataset, int nEpochs, uint64_t seed, double alpha )
+{
+   std::vector<double> weights;
+   m_NeuralNetwork.getWeights( weights );
+
+   // The workers report their results through a shared anonymous mapping
+   size_t weightBytes = weights.size() * sizeof( double );
+   size_t bytes = weightBytes + m_nWorkers * sizeof( WorkerResult );
+   void *shared = mmap( NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+   if( shared == MAP_FAILED )
+   {
+      perror( "mmap" );
+      return( false );
+   }
+   double *sharedWeights = (double *)shared;
+   WorkerResult *results = (WorkerResult *)( (char *)shared + weightBytes );
+   memset( results, 0, m_nWorkers * sizeof( WorkerResult ) );
+
+   std::string shmName = "/NeuralNetwork-" + std::to_string( getpid() );
+   if( m_Transport == TRANSPORT_SHM && !ShmTransport::create( shmName, m_nWorkers ) )
+   {
+      munmap( shared, bytes );
+      return( false );
+   }
+
+   fflush( stdout );
+   fflush( stderr );
+
+   std::vector<pid_t> pids;
+   for( int rank = 0; rank < m_nWorkers; rank++ )
+   {
+      pid_t pid = fork();
+      if( pid == 0 )
+      {
+         bool ok = runWorker( rank, shmName, dataset, nEpochs, seed, alpha,
+                              sharedWeights, &results[rank] );
+         fflush( stdout );
+         _exit( ok ? 0 : 1 );
+      }
+
+      if( pid < 0 )
+      {
+         perror( "fork" );
+         break;
+      }
+      pids.push_back( pid );
+   }
+
+   // Without all workers, the ones already started would wait for the
+   // missing ones in the allreduce until it times out
+   bool ok = (int)pids.size() == m_nWorkers;
+   for( int i = 0; !ok && i < (int)pids.size(); i++ )
+   {
+      kill( pids[i], SIGKILL );
+   }
+
+   for( int i = 0; i < (int)pids.size(); i++ )
+   {
+      int status;
+      if( waitpid( pids[i], &status, 0 ) < 0 || !WIFEXITED( status ) || WEXITSTATUS( status ) != 0 )
+      {
+         ok = false;
+      }
+   }
+
+   if( m_Transport == TRANSPORT_SHM )
+   {
+      ShmTransport::remove( shmName );
+   }
+
+   if( ok )
+   {
+      double elapsed = 0.0;
+      long nSamples = 0;
+      for( int i = 0; i < m_nWorkers; i++ )
+      {
+         elapsed = std::max( elapsed, results[i].elapsed );
+         nSamples += results[i].nSamples;
+      }
+      m_SamplesPerSecond = elapsed > 0.0 ? nSamples / elapsed : 0.0;
+
+      weights.assign( sharedWeights, sharedWeights + weights.size() );
+      ok = m_NeuralNetwork.setWeights( weights );
+   }
+
+   munmap( shared, bytes );
+
+   return( ok );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+The worker process. The samples of each epoch are shuffled the same way in
+all workers, starting from the order of the previous epoch like
+trainNetwork() does, then worker n trains with samples n, n + nWorkers,
+n + 2 * nWorkers and so on. All workers run the same number of steps, so they
+all take part in each allreduce, even if they've run out of samples.
+
+\param rank The index of the worker
+\param shmName The name of the shared memory object of the transport
+\param weights Where worker 0 stores the trained weights
+\param result Where the worker stores its statistics
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool DistributedTrainer::runWorker( int rank, std::string shmName, const mnist::Dataset &dataset, int nEpochs, uint64_t seed, double alpha,
+                                    double *weights, WorkerResult *result )
+{
+   // Spread the workers across the CPUs this process may run on. Memory a
+   // worker writes to from now on, e.g. the copy-on-write pages of its
+   // replica of the network, is then allocated on its own NUMA node.
+   std::vector<int> allowed = ThreadPool::allowedCpus();
+   if( !allowed.empty() )
+   {
+      cpu_set_t cpus;
+      CPU_ZERO( &cpus );
+      CPU_SET( allowed[rank % allowed.size()], &cpus );
+      if( sched_setaffinity( 0, sizeof( cpus ), &cpus ) != 0 )
+      {
+         perror( "sched_setaffinity" );
+      }
+   }
+
+   std::unique_ptr<Transport> transport;
+   if( m_Transport == TRANSPORT_SHM )
+   {
+      ShmTransport *shm = new ShmTransport( shmName, rank, m_nWorkers );
+      transport.reset( shm );
+      if( !shm->isOpen() )
+      {
+         return( false );
+      }
+   } else
+   {
+      TcpTransport *tcp = new TcpTransport( std::vector<std::string>( m_nWorkers, "127.0.0.1" ), m_BasePort, rank );
+      transport.reset( tcp );
+      if( !tcp->isOpen() )
+      {
+         return( false );
+      }
+   }
+
+   NeuralNetwork &nn = m_NeuralNetwork;
+   int nSamples = dataset.size();
+   int nSteps = ( nSamples + m_nWorkers - 1 ) / m_nWorkers;
+   std::vector<int> order( nSamples );
+   for( int i = 0; i < nSamples; i++ )
+   {
+      order[i] = i;
+   }
+   std::vector<double> w;
+   long nTrained = 0;
+
+   // A softmax output layer expects probabilities, which add up to 1
+   bool softmax = nn.layer( nn.numLayers() - 1 ).type == LayerSpec::LAYER_SOFTMAX;
+   double falseVal = softmax ? 0.0 : 0.01;
+   double trueVal = softmax ? 1.0 : 0.99;
+
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+   for( int epoch = 0; epoch < nEpochs; epoch++ )
+   {
+      Random rng( seed, RANDOM_SHUFFLE_STREAM + epoch );
+      rng.shuffle( order );
+
+      for( int step = 0; step < nSteps; step++ )
+      {
+         int n = step * m_nWorkers + rank;
+         if( n < nSamples )
+         {
+            int nSample = order[n];
+            nn.train( dataset.sample( nSample ), dataset.levels,
+                      mnist::convertToExpectedOut( dataset.digits[nSample], falseVal, trueVal ), alpha );
+            nTrained++;
+         }
+
+         if( ( step + 1 ) % m_SyncInterval == 0 || step == nSteps - 1 )
+         {
+            nn.getWeights( w );
+            if( !transport->allreduceMean( w ) )
+            {
+               return( false );
+            }
+            nn.setWeights( w );
+         }
+      }
+
+      if( rank == 0 )
+      {
+         printf( "Finished epoch %d.\n", epoch + 1 );
+      }
+   }
+
+   result->elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+   result->nSamples = nTrained;
+   result->ok = 1;
+
+   if( rank == 0 )
+   {
+      nn.getWeights( w );
+      memcpy( weights, w.data(), w.size() * sizeof( double ) );
+   }
+
+   return( true );
+}
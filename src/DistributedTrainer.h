@@ -0,0 +1,86 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file DistributedTrainer.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for class DistributedTrainer
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __DISTRIBUTEDTRAINER_H__
+#define __DISTRIBUTEDTRAINER_H__
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "NeuralNetwork.h"
+#include "mnist.h"
+
+/*----------------------------------------------------------------------------*/
+/*!
+\class DistributedTrainer
+\date  2026-10-18
+
+Trains a NeuralNetwork with several worker processes (data parallelism). The
+training samples of each epoch are shuffled and dealt out to the workers in
+turn. Each worker trains its own replica of the network with its samples and
+every syncInterval samples, the replicas are replaced by their mean with a
+ring allreduce. With a single worker, the result is exactly the same as
+training the network in a single process.
+*/
+/*----------------------------------------------------------------------------*/
+class DistributedTrainer
+{
+public:
+   enum TransportType
+   {
+      TRANSPORT_SHM,
+      TRANSPORT_TCP
+   };
+
+   DistributedTrainer( NeuralNetwork &nn, int nWorkers, int syncInterval, TransportType transport, int basePort );
+   ~DistributedTrainer();
+
+   bool train( const mnist::Dataset &dataset, int nEpochs, uint64_t seed, double alpha );
+   double samplesPerSecond() const;
+
+private:
+   struct WorkerResult
+   {
+      double elapsed;
+      long nSamples;
+      int ok;
+   };
+
+   bool runWorker( int rank, std::string shmName, const mnist::Dataset &dataset, int nEpochs, uint64_t seed, double alpha,
+                   double *weights, WorkerResult *result );
+
+private:
+   NeuralNetwork &m_NeuralNetwork;
+   int m_nWorkers;
+   int m_SyncInterval;
+   TransportType m_Transport;
+   int m_BasePort;
+   double m_SamplesPerSecond;
+};
+
+#endif
@@ -0,0 +1,345 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file HalfMatrix.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Implementation of the class HalfMatrix and of the conversions between
+single precision and the 16 bit formats.
+*/
+/*----------------------------------------------------------------------------*/
+#include <string.h>
+
+#include "HalfMatrix.h"
+
+// Rows are padded to a multiple of a cache line
+#define CACHE_LINE_HALVES ( 64 / sizeof( uint16_t ) )
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor for an empty matrix without a format
+*/
+/*----------------------------------------------------------------------------*/
+HalfMatrix::HalfMatrix() :
+   m_Format( FORMAT_NONE ),
+   m_Rows( 0 ),
+   m_Cols( 0 ),
+   m_Stride( 0 )
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor
+\param w The master weights
+\param format The format of the copy
+*/
+/*----------------------------------------------------------------------------*/
+HalfMatrix::HalfMatrix( const WeightMatrix &w, Format format ) :
+   m_Format( format ),
+   m_Rows( w.rows() ),
+   m_Cols( w.cols() ),
+   m_Stride( ( ( w.cols() + CACHE_LINE_HALVES - 1 ) / CACHE_LINE_HALVES ) * CACHE_LINE_HALVES )
+{
+   m_Data.assign( (size_t)m_Rows * m_Stride, 0 );
+   update( w );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Convert the master weights into the format of the copy. The master weights
+must have the same shape as when the copy was constructed.
+\param w The master weights
+*/
+/*----------------------------------------------------------------------------*/
+void HalfMatrix::update( const WeightMatrix &w )
+{
+   if( m_Format == FORMAT_NONE || w.rows() != m_Rows || w.cols() != m_Cols )
+   {
+      return;
+   }
+
+   for( int r = 0; r < m_Rows; r++ )
+   {
+      const double *src = w.row( r );
+      uint16_t *dst = m_Data.data() + (size_t)r * m_Stride;
+      if( m_Format == FORMAT_BF16 )
+      {
+         for( int c = 0; c < m_Cols; c++ )
+         {
+            dst[c] = toBf16( src[c] );
+         }
+      } else
+      {
+         for( int c = 0; c < m_Cols; c++ )
+         {
+            dst[c] = toFp16( src[c] );
+         }
+      }
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The format, FORMAT_NONE for an empty matrix
+*/
+/*----------------------------------------------------------------------------*/
+HalfMatrix::Format HalfMatrix::format() const
+{
+   return( m_Format );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of rows, i.e. neurons
+*/
+/*----------------------------------------------------------------------------*/
+int HalfMatrix::rows() const
+{
+   return( m_Rows );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of columns, i.e. inputs of each neuron
+*/
+/*----------------------------------------------------------------------------*/
+int HalfMatrix::cols() const
+{
+   return( m_Cols );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The distance between two rows in 16 bit values, a multiple of 32.
+The values beyond cols() are 0.
+*/
+/*----------------------------------------------------------------------------*/
+int HalfMatrix::stride() const
+{
+   return( m_Stride );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param r The index of the row
+\return The weights of the row
+*/
+/*----------------------------------------------------------------------------*/
+const uint16_t *HalfMatrix::row( int r ) const
+{
+   return( m_Data.data() + (size_t)r * m_Stride );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param format A format
+\return The name of the format
+*/
+/*----------------------------------------------------------------------------*/
+const char *HalfMatrix::formatName( Format format )
+{
+   switch( format )
+   {
+      case FORMAT_BF16:
+         return( "bf16" );
+      case FORMAT_FP16:
+         return( "fp16" );
+      default:
+         return( "double" );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param name The name of a format: "double", "bf16" or "fp16"
+\param format Receives the format
+\return true on success, false if the name is unknown
+*/
+/*----------------------------------------------------------------------------*/
+bool HalfMatrix::parseFormat( const std::string &name, Format &format )
+{
+   if( name == "double" )
+   {
+      format = FORMAT_NONE;
+   } else
+   if( name == "bf16" )
+   {
+      format = FORMAT_BF16;
+   } else
+   if( name == "fp16" )
+   {
+      format = FORMAT_FP16;
+   } else
+   {
+      return( false );
+   }
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Round a single precision value to the nearest bfloat16, ties to even.
+\param v The value
+\return The bfloat16
+*/
+/*----------------------------------------------------------------------------*/
+uint16_t HalfMatrix::toBf16( float v )
+{
+   uint32_t u;
+   memcpy( &u, &v, sizeof( u ) );
+
+   if( ( u & 0x7fffffff ) > 0x7f800000 )
+   {
+      // Keep NaNs quiet
+      return( ( u >> 16 ) | 0x0040 );
+   }
+
+   u += 0x7fff + ( ( u >> 16 ) & 1 );
+   return( u >> 16 );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Round a single precision value to the nearest IEEE half precision value, ties
+to even. Values beyond the range of half precision become infinite, tiny
+values become subnormal or zero.
+\param v The value
+\return The half precision value
+*/
+/*----------------------------------------------------------------------------*/
+uint16_t HalfMatrix::toFp16( float v )
+{
+   uint32_t u;
+   memcpy( &u, &v, sizeof( u ) );
+
+   uint16_t sign = ( u >> 16 ) & 0x8000;
+   uint32_t a = u & 0x7fffffff;
+
+   if( a >= 0x7f800000 )
+   {
+      // Infinity or NaN
+      return( sign | 0x7c00 | ( a > 0x7f800000 ? 0x0200 : 0 ) );
+   }
+   if( a >= 0x477ff000 )
+   {
+      // Rounds to 65536 or more
+      return( sign | 0x7c00 );
+   }
+   if( a < 0x38800000 )
+   {
+      // Subnormal: the implicit bit is shifted into the mantissa. Values
+      // below half the smallest subnormal become 0.
+      if( a < 0x33000000 )
+      {
+         return( sign );
+      }
+      int shift = 113 - ( a >> 23 );
+      uint32_t m = ( a & 0x007fffff ) | 0x00800000;
+      uint32_t h = m >> ( shift + 13 );
+      uint32_t rest = m & ( ( 1u << ( shift + 13 ) ) - 1 );
+      uint32_t half = 1u << ( shift + 12 );
+      if( rest > half || ( rest == half && ( h & 1 ) ) )
+      {
+         h++;
+      }
+      return( sign | h );
+   }
+
+   // Normal: rebias the exponent from 127 to 15 and round the mantissa
+   a -= 0x38000000;
+   a += 0x0fff + ( ( a >> 13 ) & 1 );
+   return( sign | ( a >> 13 ) );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param h A bfloat16
+\return The value as single precision, which is exact
+*/
+/*----------------------------------------------------------------------------*/
+float HalfMatrix::fromBf16( uint16_t h )
+{
+   uint32_t u = (uint32_t)h << 16;
+   float v;
+   memcpy( &v, &u, sizeof( v ) );
+
+   return( v );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param h An IEEE half precision value
+\return The value as single precision, which is exact
+*/
+/*----------------------------------------------------------------------------*/
+float HalfMatrix::fromFp16( uint16_t h )
+{
+   uint32_t sign = (uint32_t)( h & 0x8000 ) << 16;
+   uint32_t e = ( h >> 10 ) & 0x1f;
+   uint32_t m = h & 0x03ff;
+   uint32_t u;
+
+   if( e == 0x1f )
+   {
+      // Infinity or NaN
+      u = sign | 0x7f800000 | ( m << 13 );
+   } else
+   if( e == 0 )
+   {
+      if( m == 0 )
+      {
+         u = sign;
+      } else
+      {
+         // Subnormal: normalize the mantissa
+         e = 113;
+         while( !( m & 0x0400 ) )
+         {
+            m <<= 1;
+            e--;
+         }
+         u = sign | ( e << 23 ) | ( ( m & 0x03ff ) << 13 );
+      }
+   } else
+   {
+      u = sign | ( ( e + 112 ) << 23 ) | ( m << 13 );
+   }
+
+   float v;
+   memcpy( &v, &u, sizeof( v ) );
+
+   return( v );
+}
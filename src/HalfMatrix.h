@@ -0,0 +1,88 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file HalfMatrix.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for class HalfMatrix
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __HALFMATRIX_H__
+#define __HALFMATRIX_H__
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "WeightMatrix.h"
+
+/*----------------------------------------------------------------------------*/
+/*!
+\class HalfMatrix
+\date  2026-10-18
+
+A copy of a WeightMatrix in a 16 bit floating point format, either bfloat16
+(the upper half of an IEEE single) or IEEE half precision. It takes a quarter
+of the memory of the double weights, so the layer kernels stream a quarter of
+the bytes. The WeightMatrix stays the master copy, which is trained; the
+HalfMatrix is updated from it.
+
+Each row is padded with zeros to a multiple of a cache line, so the kernels
+never need to handle a remainder.
+*/
+/*----------------------------------------------------------------------------*/
+class HalfMatrix
+{
+public:
+   enum Format
+   {
+      FORMAT_NONE,
+      FORMAT_BF16,
+      FORMAT_FP16
+   };
+
+   HalfMatrix();
+   HalfMatrix( const WeightMatrix &w, Format format );
+
+   void update( const WeightMatrix &w );
+
+   Format format() const;
+   int rows() const;
+   int cols() const;
+   int stride() const;
+   const uint16_t *row( int r ) const;
+
+   static const char *formatName( Format format );
+   static bool parseFormat( const std::string &name, Format &format );
+   static uint16_t toBf16( float v );
+   static uint16_t toFp16( float v );
+   static float fromBf16( uint16_t h );
+   static float fromFp16( uint16_t h );
+
+private:
+   std::vector<uint16_t> m_Data;
+   Format m_Format;
+   int m_Rows;
+   int m_Cols;
+   int m_Stride;
+};
+
+#endif
@@ -0,0 +1,262 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file IncrementalQuery.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Implementation of the class IncrementalQuery, which updates the
+response of a network to slightly changed input vectors.
+*/
+/*----------------------------------------------------------------------------*/
+#include "IncrementalQuery.h"
+#include "kernel.h"
+
+// If more than this fraction of the input values has changed, updating the
+// kept sums isn't cheaper than calculating them from scratch
+#define INCREMENTAL_MAX_CHANGED_FRACTION 0.25
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor. Copies the input weights of the first layer beyond the input
+layer column by column, so the weights of each input are contiguous.
+
+\param nn The network
+\param fullInterval The number of queries after which the kept sums are
+calculated from scratch
+*/
+/*----------------------------------------------------------------------------*/
+IncrementalQuery::IncrementalQuery( const NeuralNetwork &nn, int fullInterval ) :
+   m_NeuralNetwork( nn ),
+   m_Incremental( false ),
+   m_FullInterval( fullInterval > 0 ? fullInterval : 1 ),
+   m_SinceFull( 0 ),
+   m_nFull( 0 ),
+   m_nIncremental( 0 )
+{
+   if( nn.numLayers() < 2 )
+   {
+      return;
+   }
+
+   LayerSpec::LayerType type = nn.layer( 1 ).type;
+   if( type != LayerSpec::LAYER_DENSE && type != LayerSpec::LAYER_SOFTMAX && type != LayerSpec::LAYER_LINEAR )
+   {
+      return;
+   }
+
+   const WeightMatrix &w = nn.weights( 1 );
+   m_Columns = WeightMatrix( w.cols(), w.rows() );
+   for( int r = 0; r < w.rows(); r++ )
+   {
+      const double *src = w.row( r );
+      for( int c = 0; c < w.cols(); c++ )
+      {
+         m_Columns.row( c )[r] = src[c];
+      }
+   }
+
+   m_Incremental = true;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Destructor
+*/
+/*----------------------------------------------------------------------------*/
+IncrementalQuery::~IncrementalQuery()
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Query the network with an input vector. It's compared with the previous one,
+and only the values which have changed are applied to the kept sums, unless
+there are too many of them or it's time for a calculation from scratch.
+
+\param inputVector The input vector. Its length must be equal to the number
+of input neurons.
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool IncrementalQuery::query( const std::vector<double> &inputVector )
+{
+   if( inputVector.size() != m_NeuralNetwork.numNeurons( 0 ) || inputVector.size() < 1 )
+   {
+      return( false );
+   }
+
+   if( m_Input.size() != inputVector.size() )
+   {
+      m_Input = inputVector;
+      return( queryFull() );
+   }
+
+   m_Changed.clear();
+   for( int i = 0; i < inputVector.size(); i++ )
+   {
+      if( inputVector[i] != m_Input[i] )
+      {
+         m_Changed.push_back( i );
+      }
+   }
+
+   if( !m_Incremental || m_SinceFull >= m_FullInterval ||
+       m_Changed.size() > INCREMENTAL_MAX_CHANGED_FRACTION * inputVector.size() )
+   {
+      m_Input = inputVector;
+      return( queryFull() );
+   }
+
+   int nRows = m_Columns.cols();
+   for( int n = 0; n < m_Changed.size(); n++ )
+   {
+      int i = m_Changed[n];
+      double delta = inputVector[i] - m_Input[i];
+      const double *column = m_Columns.row( i );
+      for( int r = 0; r < nRows; r++ )
+      {
+         m_Sums[r] += delta * column[r];
+      }
+      m_Input[i] = inputVector[i];
+   }
+
+   m_SinceFull++;
+   m_nIncremental++;
+
+   return( queryFrom( 1 ) );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Query the network with the previous input vector with some of its values
+replaced.
+
+\param indices The indices of the values to replace
+\param values The new values
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool IncrementalQuery::update( const std::vector<int> &indices, const std::vector<double> &values )
+{
+   if( indices.size() != values.size() || m_Input.size() < 1 )
+   {
+      return( false );
+   }
+
+   std::vector<double> inputVector = m_Input;
+   for( int n = 0; n < indices.size(); n++ )
+   {
+      if( indices[n] < 0 || indices[n] >= inputVector.size() )
+      {
+         return( false );
+      }
+      inputVector[indices[n]] = values[n];
+   }
+
+   return( query( inputVector ) );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The output vector of the last query
+*/
+/*----------------------------------------------------------------------------*/
+const std::vector<double> &IncrementalQuery::output() const
+{
+   return( m_Output );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of queries calculated from scratch
+*/
+/*----------------------------------------------------------------------------*/
+long IncrementalQuery::numFull() const
+{
+   return( m_nFull );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of queries calculated by updating the kept sums
+*/
+/*----------------------------------------------------------------------------*/
+long IncrementalQuery::numIncremental() const
+{
+   return( m_nIncremental );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Calculate the response to the current input vector from scratch.
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool IncrementalQuery::queryFull()
+{
+   m_SinceFull = 0;
+   m_nFull++;
+
+   if( !m_Incremental )
+   {
+      m_Output = m_Input;
+      return( queryFrom( 0 ) );
+   }
+
+   const WeightMatrix &w = m_NeuralNetwork.weights( 1 );
+   m_Sums.resize( w.rows() );
+   kernel::weightedSums( w, m_Input.data(), 1, m_Sums.data(), 0, w.rows() );
+
+   return( queryFrom( 1 ) );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Calculate the layers following a given layer.
+\param nLayer The index of the layer. If it's 0, m_Output holds the input
+vector, otherwise m_Sums holds the weighted sums of layer 1.
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool IncrementalQuery::queryFrom( int nLayer )
+{
+   bool ok = true;
+   if( nLayer == 1 )
+   {
+      ok = m_NeuralNetwork.activateLayer( 1, m_Sums, m_Output );
+   }
+
+   for( int i = nLayer + 1; ok && i < m_NeuralNetwork.numLayers(); i++ )
+   {
+      ok = m_NeuralNetwork.queryLayer( i, m_Output, m_Next );
+      m_Output.swap( m_Next );
+   }
+
+   return( ok );
+}
@@ -0,0 +1,91 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file IncrementalQuery.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for class IncrementalQuery
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __INCREMENTALQUERY_H__
+#define __INCREMENTALQUERY_H__
+
+#include <vector>
+
+#include "NeuralNetwork.h"
+#include "WeightMatrix.h"
+
+/*----------------------------------------------------------------------------*/
+/*!
+\class IncrementalQuery
+\date  2026-10-18
+
+Queries a NeuralNetwork with a stream of input vectors which differ from one
+to the next in only a few values. The weighted sums of the first layer beyond
+the input layer are kept from one query to the next. Instead of calculating
+them from scratch, the change of each input value which has changed, times
+the input weights of that input, is added to them. Only the following layers
+are calculated from scratch.
+
+To bound the rounding errors accumulating in the kept sums, they're
+calculated from scratch every fullInterval queries.
+
+The network must not be modified while an IncrementalQuery exists. If the
+first layer beyond the input layer isn't a dense layer, every query is
+calculated from scratch.
+*/
+/*----------------------------------------------------------------------------*/
+class IncrementalQuery
+{
+public:
+   IncrementalQuery( const NeuralNetwork &nn, int fullInterval );
+   ~IncrementalQuery();
+
+   bool query( const std::vector<double> &inputVector );
+   bool update( const std::vector<int> &indices, const std::vector<double> &values );
+   const std::vector<double> &output() const;
+
+   long numFull() const;
+   long numIncremental() const;
+
+private:
+   bool queryFull();
+   bool queryFrom( int nLayer );
+
+private:
+   const NeuralNetwork &m_NeuralNetwork;
+   bool m_Incremental;
+   int m_FullInterval;
+
+   // The input weights of the first layer, one row per input
+   WeightMatrix m_Columns;
+
+   std::vector<double> m_Input;
+   std::vector<double> m_Sums;
+   std::vector<double> m_Output;
+   std::vector<double> m_Next;
+   std::vector<int> m_Changed;
+
+   int m_SinceFull;
+   long m_nFull;
+   long m_nIncremental;
+};
+
+#endif
@@ -0,0 +1,285 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file LayerSpec.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Implementation of the struct LayerSpec, which describes the type and
+the shape of a layer.
+*/
+/*----------------------------------------------------------------------------*/
+#include <stdio.h>
+
+#include "LayerSpec.h"
+#include "util.h"
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of outputs of the layer
+*/
+/*----------------------------------------------------------------------------*/
+int LayerSpec::size() const
+{
+   return( width * height * channels );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return A description of the layer in the syntax accepted by parse()
+*/
+/*----------------------------------------------------------------------------*/
+std::string LayerSpec::toString() const
+{
+   char s[64];
+
+   switch( type )
+   {
+      case LAYER_INPUT:
+         snprintf( s, sizeof( s ), "%dx%dx%d", width, height, channels );
+         break;
+      case LAYER_CONV:
+         snprintf( s, sizeof( s ), "conv%dx%ds%d", channels, kernelSize, stride );
+         break;
+      case LAYER_POOL:
+         snprintf( s, sizeof( s ), "pool%d", kernelSize );
+         break;
+      case LAYER_SOFTMAX:
+         snprintf( s, sizeof( s ), "softmax%d", width );
+         break;
+      case LAYER_LINEAR:
+         snprintf( s, sizeof( s ), "linear%d", width );
+         break;
+      default:
+         snprintf( s, sizeof( s ), "%d", width );
+         break;
+   }
+
+   return( s );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param width The width of the input image
+\param height The height of the input image
+\param channels The number of values per pixel
+\return The description of an input layer
+*/
+/*----------------------------------------------------------------------------*/
+LayerSpec LayerSpec::input( int width, int height, int channels )
+{
+   LayerSpec l = { LAYER_INPUT, width, height, channels, 1, 1 };
+   return( l );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param nNeurons The number of neurons
+\return The description of a fully connected layer
+*/
+/*----------------------------------------------------------------------------*/
+LayerSpec LayerSpec::dense( int nNeurons )
+{
+   LayerSpec l = { LAYER_DENSE, nNeurons, 1, 1, 1, 1 };
+   return( l );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param nFilters The number of filters, which is the number of output channels
+\param kernelSize The width and height of each filter
+\param stride The distance in pixels between two positions of a filter
+\return The description of a convolution layer. Its width and height are
+determined by resolve().
+*/
+/*----------------------------------------------------------------------------*/
+LayerSpec LayerSpec::conv( int nFilters, int kernelSize, int stride )
+{
+   LayerSpec l = { LAYER_CONV, 0, 0, nFilters, kernelSize, stride };
+   return( l );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param size The width and height of the squares to pool
+\return The description of a max pooling layer. Its shape is determined by
+resolve().
+*/
+/*----------------------------------------------------------------------------*/
+LayerSpec LayerSpec::pool( int size )
+{
+   LayerSpec l = { LAYER_POOL, 0, 0, 0, size, size };
+   return( l );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param nNeurons The number of neurons
+\return The description of a fully connected output layer with the softmax
+function
+*/
+/*----------------------------------------------------------------------------*/
+LayerSpec LayerSpec::softmax( int nNeurons )
+{
+   LayerSpec l = { LAYER_SOFTMAX, nNeurons, 1, 1, 1, 1 };
+   return( l );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param nNeurons The number of neurons
+\return The description of a fully connected layer without an activation
+function
+*/
+/*----------------------------------------------------------------------------*/
+LayerSpec LayerSpec::linear( int nNeurons )
+{
+   LayerSpec l = { LAYER_LINEAR, nNeurons, 1, 1, 1, 1 };
+   return( l );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Determine the shapes of the convolution and pooling layers from the shapes
+of their previous layers. A leading dense layer becomes the input layer.
+\param layers The layers, from the input layer to the output layer
+\return true on success, false if the layers don't fit together
+*/
+/*----------------------------------------------------------------------------*/
+bool LayerSpec::resolve( std::vector<LayerSpec> &layers )
+{
+   if( layers.size() < 1 )
+   {
+      return( false );
+   }
+
+   if( layers[0].type == LAYER_DENSE )
+   {
+      layers[0] = input( layers[0].width, 1, 1 );
+   }
+
+   int nLayers = layers.size();
+   for( int i = 0; i < nLayers; i++ )
+   {
+      LayerSpec &l = layers[i];
+      if( ( l.type == LAYER_INPUT ) != ( i == 0 ) || l.kernelSize < 1 || l.stride < 1 ||
+          ( l.type == LAYER_SOFTMAX && i != nLayers - 1 ) )
+      {
+         return( false );
+      }
+
+      if( i > 0 )
+      {
+         const LayerSpec &prev = layers[i - 1];
+         if( l.type == LAYER_CONV )
+         {
+            l.width = ( prev.width - l.kernelSize ) / l.stride + 1;
+            l.height = ( prev.height - l.kernelSize ) / l.stride + 1;
+            if( prev.width < l.kernelSize || prev.height < l.kernelSize )
+            {
+               return( false );
+            }
+         } else
+         if( l.type == LAYER_POOL )
+         {
+            l.width = prev.width / l.kernelSize;
+            l.height = prev.height / l.kernelSize;
+            l.channels = prev.channels;
+         }
+      }
+
+      if( l.width < 1 || l.height < 1 || l.channels < 1 )
+      {
+         return( false );
+      }
+   }
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Parse a comma separated description of the layers of a network. The first
+item is the input layer, either as a number of neurons ("784") or as an image
+("28x28x1"). The following items are dense layers ("100"), convolution
+layers ("conv8x5" for 8 filters of 5x5 pixels, "conv8x5s2" for a stride of 2),
+max pooling layers ("pool2"), linear layers ("linear32") and, as the last
+item, a softmax output layer ("softmax10").
+
+\param topology The description, for example "28x28x1,conv8x5,pool2,100,10"
+\param layers Receives the resolved layers
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool LayerSpec::parse( std::string topology, std::vector<LayerSpec> &layers )
+{
+   layers.clear();
+
+   std::vector<std::string> items = util::strsplit( topology, ",", false );
+   for( int i = 0; i < (int)items.size(); i++ )
+   {
+      std::string item = util::trim( items[i] );
+      int length = item.size();
+      int a = 0, b = 0, c = 1, n = 0;
+
+      if( sscanf( item.c_str(), "conv%dx%ds%d%n", &a, &b, &c, &n ) == 3 && n == length )
+      {
+         layers.push_back( conv( a, b, c ) );
+      } else
+      if( sscanf( item.c_str(), "conv%dx%d%n", &a, &b, &n ) == 2 && n == length )
+      {
+         layers.push_back( conv( a, b ) );
+      } else
+      if( sscanf( item.c_str(), "pool%d%n", &a, &n ) == 1 && n == length )
+      {
+         layers.push_back( pool( a ) );
+      } else
+      if( sscanf( item.c_str(), "softmax%d%n", &a, &n ) == 1 && n == length )
+      {
+         layers.push_back( softmax( a ) );
+      } else
+      if( sscanf( item.c_str(), "linear%d%n", &a, &n ) == 1 && n == length )
+      {
+         layers.push_back( linear( a ) );
+      } else
+      if( i == 0 && sscanf( item.c_str(), "%dx%dx%d%n", &a, &b, &c, &n ) == 3 && n == length )
+      {
+         layers.push_back( input( a, b, c ) );
+      } else
+      if( sscanf( item.c_str(), "%d%n", &a, &n ) == 1 && n == length )
+      {
+         layers.push_back( dense( a ) );
+      } else
+      {
+         return( false );
+      }
+   }
+
+   return( resolve( layers ) );
+}
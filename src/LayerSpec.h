@@ -0,0 +1,88 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file LayerSpec.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for struct LayerSpec
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __LAYERSPEC_H__
+#define __LAYERSPEC_H__
+
+#include <string>
+#include <vector>
+
+/*----------------------------------------------------------------------------*/
+/*!
+\struct LayerSpec
+\date  2026-10-18
+
+Describes the type and the shape of a layer of a NeuralNetwork. The outputs
+of a layer form an image of width x height pixels with channels values per
+pixel, stored pixel by pixel, row by row. Dense layers are images of a
+single row with a single channel.
+
+Convolution layers apply channels filters of kernelSize x kernelSize pixels
+across all channels of the previous layer, moving by stride pixels. Only
+positions where the filter lies completely within the image are used. Their
+activation function is the rectifier.
+Pooling layers keep the maximum of each channel within non-overlapping
+squares of kernelSize x kernelSize pixels. A softmax layer is a dense layer
+whose outputs are normalized to probabilities; it can only be the output
+layer and is trained with the cross-entropy loss. A linear layer is a dense
+layer without an activation function, such as the first factor of a
+low-rank factorized layer (see lowrank::factorize()).
+*/
+/*----------------------------------------------------------------------------*/
+struct LayerSpec
+{
+   enum LayerType
+   {
+      LAYER_INPUT,
+      LAYER_DENSE,
+      LAYER_CONV,
+      LAYER_POOL,
+      LAYER_SOFTMAX,
+      LAYER_LINEAR
+   };
+
+   LayerType type;
+   int width;
+   int height;
+   int channels;
+   int kernelSize;
+   int stride;
+
+   int size() const;
+   std::string toString() const;
+
+   static LayerSpec input( int width, int height, int channels );
+   static LayerSpec dense( int nNeurons );
+   static LayerSpec conv( int nFilters, int kernelSize, int stride = 1 );
+   static LayerSpec pool( int size );
+   static LayerSpec softmax( int nNeurons );
+   static LayerSpec linear( int nNeurons );
+
+   static bool resolve( std::vector<LayerSpec> &layers );
+   static bool parse( std::string topology, std::vector<LayerSpec> &layers );
+};
+
+#endif
@@ -0,0 +1,240 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file LoadGenerator.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Implementation of the class LoadGenerator, a benchmarking client for
+the inference server.
+*/
+/*----------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "LoadGenerator.h"
+#include "Server.h"
+#include "util.h"
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor
+\param socketPath The path of the server's Unix domain socket
+\param inputs The input vectors to be sent, in turn
+\param labels The expected digit for each input vector, used to report the
+success rate of the responses
+*/
+/*----------------------------------------------------------------------------*/
+LoadGenerator::LoadGenerator( std::string socketPath, const std::vector<std::vector<double> > &inputs, const std::vector<int> &labels ) :
+   m_SocketPath( socketPath ),
+   m_Inputs( inputs ),
+   m_Labels( labels ),
+   m_nPass( 0 ),
+   m_nFail( 0 ),
+   m_nRejected( 0 )
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Destructor
+*/
+/*----------------------------------------------------------------------------*/
+LoadGenerator::~LoadGenerator()
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Run the benchmark and print the client-side latency and throughput.
+\param nConnections The number of concurrent connections
+\param nRequests The number of requests to be sent over each connection
+\param burstSize The number of requests to be sent back to back
+\return true on success, false if any connection failed
+*/
+/*----------------------------------------------------------------------------*/
+bool LoadGenerator::run( int nConnections, int nRequests, int burstSize )
+{
+   if( m_Inputs.size() < 1 || nConnections < 1 || nRequests < 1 )
+   {
+      return( false );
+   }
+
+   m_Latencies.clear();
+   m_nPass = 0;
+   m_nFail = 0;
+   m_nRejected = 0;
+
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+   std::vector<std::thread> threads;
+   std::vector<char> results( nConnections, 0 );
+   for( int i = 0; i < nConnections; i++ )
+   {
+      threads.push_back( std::thread( [this, i, nRequests, burstSize, &results]()
+      {
+         results[i] = runConnection( i, nRequests, burstSize ) ? 1 : 0;
+      } ) );
+   }
+
+   bool ok = true;
+   for( int i = 0; i < nConnections; i++ )
+   {
+      threads[i].join();
+      ok = ok && results[i];
+   }
+
+   double elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+   printf( "%ld requests over %d connections in %0.2f s, %0.0f requests/s\n",
+      (long)m_Latencies.size(), nConnections, elapsed, m_Latencies.size() / elapsed );
+   printf( "Latency p50 = %0.0f us, p99 = %0.0f us, max = %0.0f us\n",
+      util::percentile( m_Latencies, 50.0 ),
+      util::percentile( m_Latencies, 99.0 ),
+      util::percentile( m_Latencies, 100.0 ) );
+   if( m_nPass + m_nFail > 0 )
+   {
+      printf( "Success rate: %0.1f%%\n", 100.0 * ( (double)m_nPass / (double)( m_nPass + m_nFail ) ) );
+   }
+   if( m_nRejected > 0 )
+   {
+      printf( "%ld requests were rejected by the server\n", m_nRejected );
+   }
+
+   return( ok );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Send requests over a single connection.
+\param nConnection The index of the connection, used to pick the input vectors
+\param nRequests The number of requests to be sent
+\param burstSize The number of requests to be sent back to back
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool LoadGenerator::runConnection( int nConnection, int nRequests, int burstSize )
+{
+   struct sockaddr_un addr;
+   memset( &addr, 0, sizeof( addr ) );
+   addr.sun_family = AF_UNIX;
+   if( m_SocketPath.size() >= sizeof( addr.sun_path ) )
+   {
+      return( false );
+   }
+   strcpy( addr.sun_path, m_SocketPath.c_str() );
+
+   int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+   if( fd < 0 || connect( fd, (struct sockaddr *)&addr, sizeof( addr ) ) < 0 )
+   {
+      perror( m_SocketPath.c_str() );
+      if( fd >= 0 )
+      {
+         close( fd );
+      }
+      return( false );
+   }
+
+   if( burstSize < 1 )
+   {
+      burstSize = 1;
+   }
+
+   std::vector<double> latencies;
+   std::vector<std::chrono::steady_clock::time_point> sent( burstSize );
+   std::vector<double> output;
+   long nPass = 0;
+   long nFail = 0;
+   long nRejected = 0;
+   bool ok = true;
+
+   // Each connection starts at a different sample
+   int nSample = ( nConnection * 7919 ) % m_Inputs.size();
+
+   for( int n = 0; ok && n < nRequests; n += burstSize )
+   {
+      int nBurst = std::min( burstSize, nRequests - n );
+
+      for( int i = 0; ok && i < nBurst; i++ )
+      {
+         const std::vector<double> &input = m_Inputs[( nSample + i ) % m_Inputs.size()];
+         uint32_t len = input.size() * sizeof( double );
+         sent[i] = std::chrono::steady_clock::now();
+         ok = Server::writeFully( fd, &len, sizeof( len ) ) &&
+              Server::writeFully( fd, input.data(), len );
+      }
+
+      for( int i = 0; ok && i < nBurst; i++ )
+      {
+         uint32_t len;
+         ok = Server::readFully( fd, &len, sizeof( len ) ) && ( len % sizeof( double ) ) == 0;
+         if( ok )
+         {
+            output.resize( len / sizeof( double ) );
+            ok = Server::readFully( fd, output.data(), len );
+         }
+         if( !ok )
+         {
+            break;
+         }
+
+         latencies.push_back( std::chrono::duration<double, std::micro>( std::chrono::steady_clock::now() - sent[i] ).count() );
+
+         int nInput = ( nSample + i ) % m_Inputs.size();
+         if( output.size() < 1 )
+         {
+            nRejected++;
+         } else
+         if( nInput < m_Labels.size() )
+         {
+            if( util::indexOfMaxValue( output ) == m_Labels[nInput] )
+            {
+               nPass++;
+            } else
+            {
+               nFail++;
+            }
+         }
+      }
+
+      nSample = ( nSample + nBurst ) % m_Inputs.size();
+   }
+
+   close( fd );
+
+   std::lock_guard<std::mutex> lock( m_StatsMutex );
+   m_Latencies.insert( m_Latencies.end(), latencies.begin(), latencies.end() );
+   m_nPass += nPass;
+   m_nFail += nFail;
+   m_nRejected += nRejected;
+
+   return( ok );
+}
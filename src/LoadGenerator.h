@@ -0,0 +1,67 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file LoadGenerator.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for class LoadGenerator
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __LOADGENERATOR_H__
+#define __LOADGENERATOR_H__
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*----------------------------------------------------------------------------*/
+/*!
+\class LoadGenerator
+\date  2026-10-18
+
+A client for benchmarking a Server listening on a Unix domain socket. It opens
+a number of connections, each of which sends its requests in bursts: a burst
+of requests is sent back to back, then the responses are awaited.
+*/
+/*----------------------------------------------------------------------------*/
+class LoadGenerator
+{
+public:
+   LoadGenerator( std::string socketPath, const std::vector<std::vector<double> > &inputs, const std::vector<int> &labels );
+   ~LoadGenerator();
+
+   bool run( int nConnections, int nRequests, int burstSize );
+
+private:
+   bool runConnection( int nConnection, int nRequests, int burstSize );
+
+private:
+   std::string m_SocketPath;
+   const std::vector<std::vector<double> > &m_Inputs;
+   const std::vector<int> &m_Labels;
+
+   std::mutex m_StatsMutex;
+   std::vector<double> m_Latencies;
+   long m_nPass;
+   long m_nFail;
+   long m_nRejected;
+};
+
+#endif
@@ -0,0 +1,251 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file ModelStore.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Implementation of the class ModelStore, which publishes snapshots of a
+network with epoch-based reclamation.
+*/
+/*----------------------------------------------------------------------------*/
+#include <functional>
+#include <thread>
+
+#include "ModelStore.h"
+
+// A free reader slot. Epochs start with 1.
+#define SLOT_FREE 0
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor
+\param nn The network
+\param sequence The number of the snapshot
+*/
+/*----------------------------------------------------------------------------*/
+ModelStore::Published::Published( const NeuralNetwork &nn, uint64_t sequence ) :
+   nn( nn ),
+   sequence( sequence )
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor. Takes hold of the current snapshot.
+
+The epoch is announced before the pointer is loaded. If publish() has already
+scanned the reader slots without seeing the announcement, its pointer swap
+happened before and the pointer loaded here is the new one.
+\param store The store
+*/
+/*----------------------------------------------------------------------------*/
+ModelStore::Snapshot::Snapshot( ModelStore &store ) :
+   m_Slot( NULL ),
+   m_Published( NULL )
+{
+   // Threads start looking for a free slot at different positions
+   size_t n = std::hash<std::thread::id>()( std::this_thread::get_id() );
+   for( ;; n++ )
+   {
+      std::atomic<uint64_t> &slot = store.m_Slots[n % MODEL_STORE_MAX_READERS].epoch;
+      uint64_t expected = SLOT_FREE;
+      if( slot.load( std::memory_order_relaxed ) == SLOT_FREE &&
+          slot.compare_exchange_strong( expected, store.m_Epoch.load() ) )
+      {
+         m_Slot = &slot;
+         break;
+      }
+
+      if( n % MODEL_STORE_MAX_READERS == MODEL_STORE_MAX_READERS - 1 )
+      {
+         // All slots are taken
+         std::this_thread::yield();
+      }
+   }
+
+   m_Published = store.m_Current.load();
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Destructor. Lets go of the snapshot.
+*/
+/*----------------------------------------------------------------------------*/
+ModelStore::Snapshot::~Snapshot()
+{
+   m_Slot->store( SLOT_FREE, std::memory_order_release );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The network of the snapshot
+*/
+/*----------------------------------------------------------------------------*/
+const NeuralNetwork &ModelStore::Snapshot::network() const
+{
+   return( m_Published->nn );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of the snapshot, starting with 0 for the network passed
+to the constructor of the store
+*/
+/*----------------------------------------------------------------------------*/
+uint64_t ModelStore::Snapshot::sequence() const
+{
+   return( m_Published->sequence );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor
+\param nn The network to be published as the first snapshot
+*/
+/*----------------------------------------------------------------------------*/
+ModelStore::ModelStore( const NeuralNetwork &nn ) :
+   m_Current( new Published( nn, 0 ) ),
+   m_Epoch( 1 ),
+   m_Spare( NULL ),
+   m_nPublished( 1 )
+{
+   for( int i = 0; i < MODEL_STORE_MAX_READERS; i++ )
+   {
+      m_Slots[i].epoch.store( SLOT_FREE );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Destructor. No snapshot may be held any more.
+*/
+/*----------------------------------------------------------------------------*/
+ModelStore::~ModelStore()
+{
+   for( int i = 0; i < m_Retired.size(); i++ )
+   {
+      delete m_Retired[i].second;
+   }
+
+   delete m_Spare;
+   delete m_Current.load();
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Publish a copy of a network as the new current snapshot. The copy is made
+before the swap, so readers are never held up by it. If there's a spare
+snapshot with the same layers, the weights are copied into its storage.
+Snapshots which are no longer held by any reader are reclaimed.
+\param nn The network
+*/
+/*----------------------------------------------------------------------------*/
+void ModelStore::publish( const NeuralNetwork &nn )
+{
+   std::lock_guard<std::mutex> lock( m_PublishMutex );
+
+   Published *p = m_Spare;
+   m_Spare = NULL;
+   if( p && p->nn.copyWeightsFrom( nn ) )
+   {
+      p->sequence = m_nPublished.load( std::memory_order_relaxed );
+   } else
+   {
+      delete p;
+      p = new Published( nn, m_nPublished.load( std::memory_order_relaxed ) );
+   }
+   Published *old = m_Current.exchange( p );
+   uint64_t epoch = m_Epoch.fetch_add( 1 );
+   m_Retired.push_back( std::make_pair( epoch, old ) );
+   m_nPublished++;
+
+   reclaim();
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Reclaim all retired snapshots which can't be held by any reader. One of them
+is kept as the spare, the others are deleted. The publish mutex must be
+held.
+*/
+/*----------------------------------------------------------------------------*/
+void ModelStore::reclaim()
+{
+   // The oldest epoch announced by any reader
+   uint64_t oldest = UINT64_MAX;
+   for( int i = 0; i < MODEL_STORE_MAX_READERS; i++ )
+   {
+      uint64_t epoch = m_Slots[i].epoch.load();
+      if( epoch != SLOT_FREE && epoch < oldest )
+      {
+         oldest = epoch;
+      }
+   }
+
+   // Snapshots retired before that epoch have been replaced
+   // before any current reader announced itself
+   size_t nKept = 0;
+   for( size_t i = 0; i < m_Retired.size(); i++ )
+   {
+      if( m_Retired[i].first < oldest )
+      {
+         delete m_Spare;
+         m_Spare = m_Retired[i].second;
+      } else
+      {
+         m_Retired[nKept++] = m_Retired[i];
+      }
+   }
+   m_Retired.resize( nKept );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of snapshots published so far, including the first one
+*/
+/*----------------------------------------------------------------------------*/
+uint64_t ModelStore::numPublished() const
+{
+   return( m_nPublished.load() );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of replaced snapshots which may still be held by readers
+*/
+/*----------------------------------------------------------------------------*/
+size_t ModelStore::numRetired()
+{
+   std::lock_guard<std::mutex> lock( m_PublishMutex );
+   reclaim();
+
+   return( m_Retired.size() );
+}
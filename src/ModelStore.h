@@ -0,0 +1,127 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file ModelStore.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for class ModelStore
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __MODELSTORE_H__
+#define __MODELSTORE_H__
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "NeuralNetwork.h"
+
+// Maximum number of snapshots held at the same time
+#define MODEL_STORE_MAX_READERS 64
+
+/*----------------------------------------------------------------------------*/
+/*!
+\class ModelStore
+\date  2026-10-18
+
+Publishes immutable copies (snapshots) of a network which is being trained,
+so other threads can query a consistent model while the training continues.
+
+A reader holds on to the current snapshot with a ModelStore::Snapshot, which
+takes no lock: it announces the current epoch in a free reader slot, then
+loads the pointer to the current snapshot. publish() swaps in a new snapshot
+atomically and retires the old one with the epoch before the swap. A retired
+snapshot is deleted as soon as no reader slot holds an epoch up to its
+retirement epoch, since every reader which announced a later epoch must have
+seen the new snapshot. The last reclaimed snapshot is kept as a spare, whose
+storage takes the weights of the next one published.
+*/
+/*----------------------------------------------------------------------------*/
+class ModelStore
+{
+private:
+   struct Published
+   {
+      Published( const NeuralNetwork &nn, uint64_t sequence );
+
+      NeuralNetwork nn;
+      uint64_t sequence;
+   };
+
+public:
+   /*-------------------------------------------------------------------------*/
+   /*!
+   \class Snapshot
+   \date  2026-10-18
+
+   Holds on to the snapshot which is current when it's constructed until it's
+   destroyed. Snapshots should be short-lived, since a snapshot keeps all
+   snapshots published after it from being reclaimed.
+   */
+   /*-------------------------------------------------------------------------*/
+   class Snapshot
+   {
+   public:
+      Snapshot( ModelStore &store );
+      ~Snapshot();
+
+      const NeuralNetwork &network() const;
+      uint64_t sequence() const;
+
+   private:
+      Snapshot( const Snapshot &other );
+      Snapshot &operator=( const Snapshot &other );
+
+   private:
+      std::atomic<uint64_t> *m_Slot;
+      const Published *m_Published;
+   };
+
+public:
+   ModelStore( const NeuralNetwork &nn );
+   ~ModelStore();
+
+   void publish( const NeuralNetwork &nn );
+   uint64_t numPublished() const;
+   size_t numRetired();
+
+private:
+   void reclaim();
+
+private:
+   struct alignas( 64 ) Slot
+   {
+      std::atomic<uint64_t> epoch;
+   };
+
+   std::atomic<Published *> m_Current;
+   std::atomic<uint64_t> m_Epoch;
+   Slot m_Slots[MODEL_STORE_MAX_READERS];
+
+   std::mutex m_PublishMutex;
+   std::vector<std::pair<uint64_t, Published *> > m_Retired;
+   Published *m_Spare;
+   std::atomic<uint64_t> m_nPublished;
+};
+
+#endif
@@ -25,7 +25,33 @@
 layers and an arbitrary number of neurons in each layer.
 */
 /*----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
 #include "NeuralNetwork.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include "kernel.h"
+
+#define NN_FILE_MAGIC "NNET"
+
+// Model files of networks with layers other than dense ones
+#define NN_FILE_MAGIC_LAYERS "NNLY"
+
+// The number of samples of bytes mapped to input values and queried at a
+// time, see query( const uint8_t *, ... )
+#define BYTE_QUERY_BATCH 256
+
+// Networks with fewer weights than this are initialized by a single thread
+#define PARALLEL_INIT_MIN_WEIGHTS ( 1 << 18 )
+
+// Source of the weights versions of all networks, see weightsVersion()
+static std::atomic<uint64_t> s_WeightsVersion( 0 );
 
 /*----------------------------------------------------------------------------*/
 /*! 2023-12-12
@@ -34,254 +60,1806 @@ Constructor
 in each layer, from left (input layer) to right (output layer).
 */
 /*----------------------------------------------------------------------------*/
-NeuralNetwork::NeuralNetwork( std::vector<int> numNeurons )
+NeuralNetwork::NeuralNetwork( std::vector<int> numNeurons ) :
+   m_HalfStale( false ),
+   m_Loss( 0.0 ),
+   m_WeightsVersion( 0 ),
+   m_Cache( NULL ),
+   m_Selector( NULL ),
+   m_Profiler( NULL )
 {
+   std::vector<LayerSpec> layers;
    for( int i = 0; i < numNeurons.size(); i++ )
    {
-      std::vector<Neuron> neurons;
-      for( int j = 0; j < numNeurons[i]; j++ )
-      {
-         Neuron neuron = Neuron( i, i == 0 ? 1 : m_Network[i - 1].size() );
-         neurons.push_back( neuron );
-      }
-      m_Network.push_back( neurons );
+      layers.push_back( LayerSpec::dense( numNeurons[i] ) );
    }
 
-   randomizeWeights();
+   if( create( layers ) )
+   {
+      randomizeWeights();
+   }
 }
 
 
 /*----------------------------------------------------------------------------*/
-/*! 2023-12-12
-Destructor
+/*! 2026-10-18
+Constructor
+\param layers The description of each layer, from left (input layer) to right
+(output layer). If the layers don't fit together, the network is empty.
 */
 /*----------------------------------------------------------------------------*/
-NeuralNetwork::~NeuralNetwork()
+NeuralNetwork::NeuralNetwork( std::vector<LayerSpec> layers ) :
+   m_HalfStale( false ),
+   m_Loss( 0.0 ),
+   m_WeightsVersion( 0 ),
+   m_Cache( NULL ),
+   m_Selector( NULL ),
+   m_Profiler( NULL )
 {
+   if( create( layers ) )
+   {
+      randomizeWeights();
+   }
 }
 
 
 /*----------------------------------------------------------------------------*/
-/*! 2023-12-15
-\return The number of layers of this network
+/*! 2026-10-18
+Constructor for a network whose weights are randomized with an explicit seed
+instead of one drawn from the calling thread's random stream, see
+randomizeWeights( uint64_t ).
+\param layers The description of each layer, from left (input layer) to right
+(output layer). If the layers don't fit together, the network is empty.
+\param seed The seed of the weights
 */
 /*----------------------------------------------------------------------------*/
-int NeuralNetwork::numLayers() const
+NeuralNetwork::NeuralNetwork( std::vector<LayerSpec> layers, uint64_t seed ) :
+   m_HalfStale( false ),
+   m_Loss( 0.0 ),
+   m_WeightsVersion( 0 ),
+   m_Cache( NULL ),
+   m_Selector( NULL ),
+   m_Profiler( NULL )
 {
-   return( m_Network.size() );
+   if( create( layers ) )
+   {
+      randomizeWeights( seed );
+   }
 }
 
 
 /*----------------------------------------------------------------------------*/
-/*! 2023-12-12
-Adjust the input weights of all neurons in proportion to the error. The error
-is the difference between the network response to an input vector and the
-expected response.
+/*! 2026-10-18
+Create the neurons and the storage of all layers. The weights are zeroed;
+the constructors randomize them.
 
-\param input The input vector
-\param expectedResult The expected response of the network
-\param alpha The learning rate, ranging from 0.0 to 1.0
+Dense layers have one neuron per output, with one input weight for each
+output of the previous layer. Convolution layers have one neuron per filter,
+whose input weights are ordered like a patch of the previous layer's image:
+kernelSize rows of kernelSize pixels of all channels. That way, a row of a
+patch is contiguous both in the weights and in the image, and the weights of
+a filter are a row of the layer's WeightMatrix, which the layer kernels work
+on directly. Pooling layers have no neurons.
+
+The weights, the outputs and the errors of all layers are stored in a single
+arena, which is sized from the layers up front, see bindArena().
+
+\param layers The description of each layer
+\return true on success, false if the layers don't fit together
 */
 /*----------------------------------------------------------------------------*/
-void NeuralNetwork::train( std::vector<double> input, std::vector<double> expectedResult, double alpha )
+bool NeuralNetwork::create( std::vector<LayerSpec> layers )
 {
-   // **** 1st step: Query the network with the training sample
-   query( input );
-   std::vector<double> result = output();
-
-   // If the sizes of the expected result and the network's response
-   // are not the same, we can't train.
-   if( result.size() != expectedResult.size() )
+   if( !LayerSpec::resolve( layers ) )
    {
-      return;
+      return( false );
    }
 
-   // **** 2nd step: Determine the error of the network
-   // The error is the difference between the network response
-   // and the expected output.
-   std::vector<double> err;
-   for( int i = 0; i < result.size(); i++ )
-   {
-      err.push_back( expectedResult[i] - result[i] );
-   }
+   m_Layers = layers;
+   m_Network.resize( m_Layers.size() );
+   m_HalfWeights.resize( m_Layers.size() );
 
-   // Set the output error values in the last layer
-   for( int i = 0; i < err.size(); i++ )
+   size_t weightBytes = 0;
+   size_t valueBytes = 0;
+   for( int i = 0; i < m_Layers.size(); i++ )
    {
-      m_Network[numLayers() - 1][i].setError( err[i] );
-   }
+      int nRows, nInputs;
+      weightShape( i, nRows, nInputs );
 
-   // **** 3rd step: Successively backpropagate the error
-   // from the last to the second layer.
-   // The first (input) layer does not have an error.
-   for( int i = numLayers() - 1; i >= 2; i-- )
-   {
-      // Propagate the error from layer i to layer i - 1
-      backPropagateError( i );
+      m_Network[i].reserve( nRows );
+      for( int j = 0; j < nRows; j++ )
+      {
+         m_Network[i].emplace_back( i, nInputs );
+      }
+
+      weightBytes += WeightMatrix::storageSize( nRows, nInputs );
+      valueBytes += 2 * Arena::align( m_Layers[i].size() * sizeof( double ) );
    }
 
-   // **** 4th step: Successively adjust the input weights
-   // of all layers in proportion to their errors.
-   for( int i = numLayers() - 1; i >= 1 ; i-- )
+   m_Arena = Arena( weightBytes + valueBytes );
+   bindArena();
+
+   // The weights are touched first by the threads which use them
+   for( int i = 0; i < m_Weights.size(); i++ )
    {
-      for( int j = 0; j < m_Network[i].size(); j++ )
-      {
-         m_Network[i][j].adjustWeights( alpha );
-      }
+      m_Weights[i].clear();
    }
+   memset( (char *)m_Arena.data() + weightBytes, 0, valueBytes );
+
+   return( true );
 }
 
 
 /*----------------------------------------------------------------------------*/
-/*! 2023-12-14
-Backpropagate the error vector of a specific layer to the previous layer.
+/*! 2026-10-18
+Copy constructor, see clone(). The 16 bit weights are copied under the lock
+of the other network, so a query converting them at the same time doesn't
+leave the copy with old weights marked as up to date.
+*/
+/*----------------------------------------------------------------------------*/
+NeuralNetwork::NeuralNetwork( const NeuralNetwork &other ) :
+   m_Layers( other.m_Layers ),
+   m_Network( other.m_Network ),
+   m_HalfStale( true ),
+   m_Arena( other.m_Arena.size() ),
+   m_Loss( other.m_Loss ),
+   m_WeightsVersion( other.m_WeightsVersion ),
+   m_Cache( NULL ),
+   m_Selector( NULL ),
+   m_Profiler( NULL )
+{
+   {
+      std::lock_guard<std::mutex> lock( other.m_HalfMutex );
+      m_HalfWeights = other.m_HalfWeights;
+      m_HalfStale = other.m_HalfStale.load();
+   }
 
-The error of neuron n of layer nLayer is:
+   bindArena();
+   copyArena( other );
+}
 
-$$ e_{n,nLayer} $$
 
-The input weight i of neuron n of layer nLayer is:
+/*----------------------------------------------------------------------------*/
+/*! 2023-12-12
+Destructor
+*/
+/*----------------------------------------------------------------------------*/
+NeuralNetwork::~NeuralNetwork()
+{
+}
 
-$$ w_{i,n,nLayer} $$
 
-The error of neuron n of layer nLayer - 1 (the 'previous' layer) is then the
-weighted sum
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Assignment operator. The arena is only reallocated if the other network
+needs a different size, see copyArena(). Like the copy constructor, the 16
+bit weights are copied under the lock of the other network.
+*/
+/*----------------------------------------------------------------------------*/
+NeuralNetwork &NeuralNetwork::operator=( const NeuralNetwork &other )
+{
+   if( this != &other )
+   {
+      m_Layers = other.m_Layers;
+      m_Network = other.m_Network;
+      {
+         std::lock_guard<std::mutex> lock( other.m_HalfMutex );
+         m_HalfWeights = other.m_HalfWeights;
+         m_HalfStale = other.m_HalfStale.load();
+      }
+      if( m_Arena.size() != other.m_Arena.size() )
+      {
+         m_Arena = Arena( other.m_Arena.size() );
+      }
+      m_Loss = other.m_Loss;
+      m_WeightsVersion = other.m_WeightsVersion;
+      bindArena();
+      copyArena( other );
+   }
 
-$$ e_{n,nLayer - 1} = \sum_{k=0}^{numLayers - 1} e_{k,nLayer} * w_{n,k,nLayer} $$
+   return( *this );
+}
 
-\param nLayer The index of the layer to backpropagate to the previous layer
 
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Deep copy of the network. The weights, the outputs and the errors of all
+layers take a single allocation of an arena, which is copied by the workers
+of the ThreadPool, see copyArena(). Besides, the layer descriptions, the
+neurons of each layer and the 16 bit copies of the weights are copied, one
+allocation per layer each, and the neurons are bound to the new arena. Like
+the copy constructor, the cache, the selector and the profiler aren't passed
+on.
+\return The copy
 */
 /*----------------------------------------------------------------------------*/
-void NeuralNetwork::backPropagateError( int nLayer )
+NeuralNetwork NeuralNetwork::clone() const
 {
-   // Sanity check
-   if( nLayer >= numLayers() || nLayer < 2 )
-      return;
-   int prevLayer = nLayer - 1;
+   return( NeuralNetwork( *this ) );
+}
 
-   for( int i = 0; i < m_Network[prevLayer].size(); i++ )
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Copy the weights of another network with the same layers into the storage of
+this one, e.g. to refresh a replica. Nothing is allocated, and the outputs,
+the errors and the weight formats of this network are kept.
+\param other The network to copy the weights from
+\return true on success, false if the layers of the networks differ
+*/
+/*----------------------------------------------------------------------------*/
+bool NeuralNetwork::copyWeightsFrom( const NeuralNetwork &other )
+{
+   if( this == &other )
    {
-      double ei = 0.0;
+      return( true );
+   }
 
-      for( int j = 0; j < m_Network[nLayer].size(); j++ )
+   if( numLayers() != other.numLayers() )
+   {
+      return( false );
+   }
+   for( int i = 0; i < numLayers(); i++ )
+   {
+      const LayerSpec &a = m_Layers[i];
+      const LayerSpec &b = other.m_Layers[i];
+      if( a.type != b.type || a.width != b.width || a.height != b.height || a.channels != b.channels ||
+          a.kernelSize != b.kernelSize || a.stride != b.stride )
       {
-         ei += m_Network[nLayer][j].error() * m_Network[nLayer][j].weight( i );
+         return( false );
       }
+   }
+
+   // The weights of all layers are at the start of the arena
+   if( numLayers() > 1 )
+   {
+      size_t weightBytes = (char *)m_Outputs[0] - (char *)m_Arena.data();
+      memcpy( m_Arena.data(), other.m_Arena.data(), weightBytes );
+   }
 
-      m_Network[prevLayer][i].setError( ei );
+   // The copy has the version of the original, unless it's queried with
+   // other weight formats
+   bool sameFormats = true;
+   for( int i = 0; i < numLayers(); i++ )
+   {
+      sameFormats = sameFormats && weightFormat( i ) == other.weightFormat( i );
+   }
+   weightsChanged();
+   if( sameFormats )
+   {
+      m_WeightsVersion = other.m_WeightsVersion;
    }
+
+   return( true );
 }
 
 
 /*----------------------------------------------------------------------------*/
-/*! 2023-12-14
-\return The output vector of the last layer
+/*! 2026-10-18
+\param nLayer The index of the layer
+\param nRows Receives the number of rows of the layer's weight matrix, i.e.
+the number of neurons, or filters
+\param nInputs Receives the number of input weights of each neuron
 */
 /*----------------------------------------------------------------------------*/
-std::vector<double> NeuralNetwork::output()
+void NeuralNetwork::weightShape( int nLayer, int &nRows, int &nInputs ) const
 {
-   return( output( numLayers() - 1 ) );
+   const LayerSpec &l = m_Layers[nLayer];
+   nRows = 0;
+   nInputs = 0;
+   switch( l.type )
+   {
+      case LayerSpec::LAYER_INPUT:
+         nRows = l.size();
+         nInputs = 1;
+         break;
+      case LayerSpec::LAYER_DENSE:
+      case LayerSpec::LAYER_SOFTMAX:
+      case LayerSpec::LAYER_LINEAR:
+         nRows = l.size();
+         nInputs = m_Layers[nLayer - 1].size();
+         break;
+      case LayerSpec::LAYER_CONV:
+         nRows = l.channels;
+         nInputs = l.kernelSize * l.kernelSize * m_Layers[nLayer - 1].channels;
+         break;
+      case LayerSpec::LAYER_POOL:
+         break;
+   }
 }
 
 
 /*----------------------------------------------------------------------------*/
-/*! 2023-12-14
-Returns the output vector of a specific layer.
-\param nLayer the index of the layer
-\return The output vector of the specified layer
+/*! 2026-10-18
+Lay out the storage of all layers in the arena and bind the neurons to it.
+The arena starts with the weight matrices of all layers, so the weights can
+be copied at once, followed by the output vectors and then the error vectors
+of all layers. Each part starts on a cache line boundary. The arena isn't
+touched.
 */
 /*----------------------------------------------------------------------------*/
-std::vector<double> NeuralNetwork::output( int nLayer )
+void NeuralNetwork::bindArena()
 {
-   std::vector<double> r;
+   char *p = (char *)m_Arena.data();
+   m_Weights.clear();
+   m_Outputs.clear();
+   m_Errors.clear();
 
-   // Sanity check
-   if( nLayer >= numLayers() || nLayer < 0 )
+   for( int i = 0; i < m_Layers.size(); i++ )
    {
-      return( r );
+      int nRows, nInputs;
+      weightShape( i, nRows, nInputs );
+      m_Weights.push_back( WeightMatrix( (double *)p, nRows, nInputs ) );
+      p += WeightMatrix::storageSize( nRows, nInputs );
    }
-
-   for( int i = 0; i < m_Network[nLayer].size(); i++ )
+   for( int i = 0; i < m_Layers.size(); i++ )
+   {
+      m_Outputs.push_back( (double *)p );
+      p += Arena::align( m_Layers[i].size() * sizeof( double ) );
+   }
+   for( int i = 0; i < m_Layers.size(); i++ )
    {
-      r.push_back( m_Network[nLayer][i].output() );
+      m_Errors.push_back( (double *)p );
+      p += Arena::align( m_Layers[i].size() * sizeof( double ) );
    }
 
-   return( r );
+   bindNeurons();
 }
 
 
 /*----------------------------------------------------------------------------*/
-/*! 2023-12-14
-Feed an input vector into the input layer of the network and calculate the
-resulting ouptput of the output layer according to the input weights of all
-neurons.
-After invoking the query() method, the output() method can be used to collect
-the result from the output layer of the network.
-
-\param inputVector The input vector. Its length must be equal to the number of
-input neurons.
-\return true on success, false on failure
+/*! 2026-10-18
+Copy the arena of another network with the same layers into the arena of
+this one, which has been bound with bindArena(). Like WeightMatrix::clear(),
+each worker of the ThreadPool copies the rows of each weight matrix which
+the layer kernels assign to it, so the pages of a new arena end up on the
+NUMA node of the worker which is going to use them. The outputs and the
+errors are copied by the calling thread, which uses them.
+\param other The network to copy the arena of
 */
 /*----------------------------------------------------------------------------*/
-bool NeuralNetwork::query( std::vector<double> inputVector )
+void NeuralNetwork::copyArena( const NeuralNetwork &other )
 {
-   // Sanity checks
-   if( m_Network.size() < 1 )
+   if( m_Layers.empty() )
    {
-      return( false );
+      return;
    }
 
-   if( ( m_Network[0].size() != inputVector.size() ) ||
-       ( m_Network[0].size() < 1 ) )
+   ThreadPool &pool = ThreadPool::instance();
+   pool.run( [this, &other, &pool]( int nThread )
    {
-      return( false );
+      for( int i = 0; i < (int)m_Weights.size(); i++ )
+      {
+         int begin, end;
+         kernel::partition( m_Weights[i].rows(), pool.numThreads(), nThread, begin, end );
+         if( end > begin )
+         {
+            memcpy( m_Weights[i].row( begin ), other.m_Weights[i].row( begin ),
+                    (size_t)( end - begin ) * m_Weights[i].stride() * sizeof( double ) );
+         }
+      }
+   } );
+
+   size_t weightBytes = (char *)m_Outputs[0] - (char *)m_Arena.data();
+   memcpy( m_Outputs[0], other.m_Outputs[0], m_Arena.size() - weightBytes );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Bind each neuron to its row of the layer's weight matrix, to its slot in the
+layer's output vector and to the output vector of the previous layer as its
+inputs. The neurons of the input layer have a single input each, which is
+their own output slot: query() stores the input vector there and the input
+layer passes it through unaltered. The filters of convolution layers are
+only bound to their weights, since they're applied to many inputs.
+*/
+/*----------------------------------------------------------------------------*/
+void NeuralNetwork::bindNeurons()
+{
+   for( int i = 0; i < m_Network.size(); i++ )
+   {
+      for( int j = 0; j < m_Network[i].size(); j++ )
+      {
+         if( m_Layers[i].type == LayerSpec::LAYER_CONV )
+         {
+            m_Network[i][j].bind( m_Weights[i].row( j ), NULL, NULL );
+         } else
+         {
+            const double *inputs = i == 0 ? &m_Outputs[0][j] : m_Outputs[i - 1];
+            m_Network[i][j].bind( m_Weights[i].row( j ), inputs, &m_Outputs[i][j] );
+         }
+      }
    }
+}
 
-   // Query the first layer.
-   // By definition, each neuron of the first layer has only one input,
-   // without any weights.
-   for( int j = 0; j < inputVector.size(); j++ )
+
+/*----------------------------------------------------------------------------*/
+/*! 2023-12-15
+\return The number of layers of this network
+*/
+/*----------------------------------------------------------------------------*/
+int NeuralNetwork::numLayers() const
+{
+   return( m_Network.size() );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param nLayer The index of the layer
+\return The number of neurons in the specified layer or 0 if there is no such
+layer. For convolution and pooling layers, that's the number of outputs.
+*/
+/*----------------------------------------------------------------------------*/
+int NeuralNetwork::numNeurons( int nLayer ) const
+{
+   if( nLayer < 0 || nLayer >= numLayers() )
    {
-      if( !m_Network[0][j].query( inputVector[j] ) )
-         return( false );
+      return( 0 );
    }
 
-   for( int i = 1; i < m_Network.size(); i++ )
+   return( m_Layers[nLayer].size() );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param nLayer The index of the layer, which must exist
+\return The description of the layer
+*/
+/*----------------------------------------------------------------------------*/
+const LayerSpec &NeuralNetwork::layer( int nLayer ) const
+{
+   return( m_Layers[nLayer] );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param nLayer The index of the layer, which must exist
+\return The input weights of the layer, one row per neuron (or filter)
+*/
+/*----------------------------------------------------------------------------*/
+const WeightMatrix &NeuralNetwork::weights( int nLayer ) const
+{
+   return( m_Weights[nLayer] );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param nLayer The index of the layer
+\return The number of multiply-adds (or comparisons, for pooling layers) it
+takes to query the layer with a single sample
+*/
+/*----------------------------------------------------------------------------*/
+long NeuralNetwork::numMultiplyAdds( int nLayer ) const
+{
+   if( nLayer < 1 || nLayer >= numLayers() )
    {
-      // Collect input vector from previous layer
-      std::vector<double> input = output( i - 1 );
+      return( 0 );
+   }
 
-      // Feed that into this layer
-      for( int j = 0; j < m_Network[i].size(); j++ )
-      {
-         m_Network[i][j].query( input );
-      }
+   const LayerSpec &l = m_Layers[nLayer];
+   long n = (long)m_Weights[nLayer].rows() * m_Weights[nLayer].cols();
+   if( l.type == LayerSpec::LAYER_CONV )
+   {
+      n *= (long)l.width * l.height;
+   } else
+   if( l.type == LayerSpec::LAYER_POOL )
+   {
+      n = (long)l.size() * l.kernelSize * l.kernelSize;
    }
 
-   return( true );
+   return( n );
 }
 
 
 /*----------------------------------------------------------------------------*/
-/*! 2023-12-15
-Randomize all input weights of all neurons. The input weights will be set to
-random values ranging from
+/*! 2026-10-18
+The weights version identifies the current state of the weights. It changes
+whenever the weights change, by training, randomizing, setWeights() or
+load(), and is never reused by any other network of the process, except for
+copies, which start out with the version of the original.
+\return The current version of the weights
+*/
+/*----------------------------------------------------------------------------*/
+uint64_t NeuralNetwork::weightsVersion() const
+{
+   return( m_WeightsVersion );
+}
 
-$$ \sqrt{ -{ 1 \over numInputs } } $$
 
-to
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Draw a new weights version. The 16 bit copies of the weights are converted
+by the next query, so training many samples in a row converts them once.
+*/
+/*----------------------------------------------------------------------------*/
+void NeuralNetwork::weightsChanged()
+{
+   m_WeightsVersion = ++s_WeightsVersion;
+   m_HalfStale.store( true, std::memory_order_release );
+}
 
-$$ \sqrt{ +{ 1 \over numInputs } } $$
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Convert the weights to the 16 bit copies if they have changed since the last
+conversion. Concurrent queries convert them only once; those which find them
+up to date don't take the lock.
 */
 /*----------------------------------------------------------------------------*/
-void NeuralNetwork::randomizeWeights()
+void NeuralNetwork::updateHalfWeights() const
 {
-   for( int i = 0; i < m_Network.size(); i++ )
+   if( !m_HalfStale.load( std::memory_order_acquire ) )
    {
-      for( int j = 0; j < m_Network[i].size(); j++ )
+      return;
+   }
+
+   std::lock_guard<std::mutex> lock( m_HalfMutex );
+   if( m_HalfStale.load( std::memory_order_relaxed ) )
+   {
+      for( int i = 0; i < (int)m_HalfWeights.size(); i++ )
       {
-         m_Network[i][j].randomizeWeights();
+         m_HalfWeights[i].update( m_Weights[i] );
       }
+      m_HalfStale.store( false, std::memory_order_release );
    }
 }
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Store a copy of the weights of a layer in a 16 bit format, which is used for
+all queries. The double weights remain the master copy, which is used and
+adjusted by training; the copy is updated by the first query after the
+weights have changed. Since the outputs of the queries change with the
+format, so does the weights version. Formats aren't saved to model files.
+\param nLayer The index of a dense, softmax or convolution layer
+\param format The format, FORMAT_NONE to use the double weights again
+\return true on success, false if the layer has no weights
+*/
+/*----------------------------------------------------------------------------*/
+bool NeuralNetwork::setWeightFormat( int nLayer, HalfMatrix::Format format )
+{
+   if( nLayer < 1 || nLayer >= numLayers() || m_Weights[nLayer].rows() < 1 )
+   {
+      return( false );
+   }
+
+   if( format == HalfMatrix::FORMAT_NONE )
+   {
+      m_HalfWeights[nLayer] = HalfMatrix();
+   } else
+   {
+      m_HalfWeights[nLayer] = HalfMatrix( m_Weights[nLayer], format );
+   }
+   weightsChanged();
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param nLayer The index of a layer
+\return The format of the weights used by the queries of the layer,
+FORMAT_NONE for double
+*/
+/*----------------------------------------------------------------------------*/
+HalfMatrix::Format NeuralNetwork::weightFormat( int nLayer ) const
+{
+   if( nLayer < 0 || nLayer >= numLayers() )
+   {
+      return( HalfMatrix::FORMAT_NONE );
+   }
+
+   return( m_HalfWeights[nLayer].format() );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Use a cache for the outputs of repeated queries. Entries computed with other
+weights are never returned, since the cache is keyed by the weights version
+as well. The cache isn't owned by the network and isn't passed on to copies.
+Several networks may share a cache.
+\param cache The cache, or NULL to query without a cache
+*/
+/*----------------------------------------------------------------------------*/
+void NeuralNetwork::setCache( QueryCache *cache )
+{
+   m_Cache = cache;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Backpropagate only the training samples picked by a selector. The loss of
+each sample is determined with the forward pass as usual; if the selector
+skips the sample, the backward pass and the adjustment of the weights are
+left out. The selector isn't owned by the network and isn't passed on to
+copies.
+\param selector The selector, or NULL to backpropagate all samples
+*/
+/*----------------------------------------------------------------------------*/
+void NeuralNetwork::setSelector( BackpropSelector *selector )
+{
+   m_Selector = selector;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Record the forward pass, the backward pass and the adjustment of the weights
+of each layer with a profiler. The layer kernels must run on the thread that
+created the profiler, see Profiler. The profiler isn't owned by the network
+and isn't passed on to copies.
+\param profiler The profiler, or NULL to run without profiling
+*/
+/*----------------------------------------------------------------------------*/
+void NeuralNetwork::setProfiler( Profiler *profiler )
+{
+   m_Profiler = profiler;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Collect the input weights of all neurons beyond the input layer into a single
+vector, layer by layer and neuron by neuron.
+\param weights Receives the weights
+*/
+/*----------------------------------------------------------------------------*/
+void NeuralNetwork::getWeights( std::vector<double> &weights ) const
+{
+   weights.clear();
+   for( int i = 1; i < numLayers(); i++ )
+   {
+      for( int j = 0; j < m_Weights[i].rows(); j++ )
+      {
+         const double *w = m_Weights[i].row( j );
+         weights.insert( weights.end(), w, w + m_Weights[i].cols() );
+      }
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Set the input weights of all neurons beyond the input layer from a vector
+previously filled by getWeights() of a network with the same topology.
+\param weights The weights
+\return true on success, false if the size of the vector doesn't match
+*/
+/*----------------------------------------------------------------------------*/
+bool NeuralNetwork::setWeights( const std::vector<double> &weights )
+{
+   size_t n = 0;
+   for( int i = 1; i < numLayers(); i++ )
+   {
+      n += (size_t)m_Weights[i].rows() * m_Weights[i].cols();
+   }
+   if( n != weights.size() )
+   {
+      return( false );
+   }
+
+   const double *src = weights.data();
+   for( int i = 1; i < numLayers(); i++ )
+   {
+      for( int j = 0; j < m_Weights[i].rows(); j++ )
+      {
+         memcpy( m_Weights[i].row( j ), src, m_Weights[i].cols() * sizeof( double ) );
+         src += m_Weights[i].cols();
+      }
+   }
+
+   weightsChanged();
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2023-12-12
+Adjust the input weights of all neurons in proportion to the error. The error
+is the difference between the network response to an input vector and the
+expected response.
+
+\param input The input vector
+\param expectedResult The expected response of the network
+\param alpha The learning rate, ranging from 0.0 to 1.0
+*/
+/*----------------------------------------------------------------------------*/
+void NeuralNetwork::train( std::vector<double> input, std::vector<double> expectedResult, double alpha )
+{
+   if( feed( input, 1 ) )
+   {
+      learn( expectedResult, alpha );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Train the network with a sample of byte values, like
+train( std::vector<double> input, std::vector<double> expectedResult, double alpha ).
+The bytes are mapped to input values while they're stored in the input layer,
+so a dataset can be kept in memory as bytes.
+
+\param input The bytes of the sample, one per input neuron
+\param levels The input value of each byte value
+\param expectedResult The expected response of the network
+\param alpha The learning rate, ranging from 0.0 to 1.0
+*/
+/*----------------------------------------------------------------------------*/
+void NeuralNetwork::train( const uint8_t *input, const double *levels, const std::vector<double> &expectedResult, double alpha )
+{
+   if( feed( input, levels, 1 ) )
+   {
+      learn( expectedResult, alpha );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Train the network with the sample stored in the input layer.
+
+\param expectedResult The expected response of the network
+\param alpha The learning rate, ranging from 0.0 to 1.0
+*/
+/*----------------------------------------------------------------------------*/
+void NeuralNetwork::learn( const std::vector<double> &expectedResult, double alpha )
+{
+   int last = numLayers() - 1;
+   bool softmax = last > 0 && m_Layers[last].type == LayerSpec::LAYER_SOFTMAX;
+
+   // If the sizes of the expected result and the network's response
+   // are not the same, we can't train.
+   if( last < 1 || numNeurons( last ) != expectedResult.size() )
+   {
+      return;
+   }
+
+   // **** 1st step: Query the network with the training sample
+   // A softmax output layer is calculated along with its loss and error
+   // in the 2nd step.
+   propagate( softmax ? last : last + 1, false );
+
+   // **** 2nd step: Determine the error of the network
+   // The error is the difference between the network response
+   // and the expected output.
+   double *err = m_Errors[last];
+   double *result = m_Outputs[last];
+   if( softmax )
+   {
+      Profiler::Section section( m_Profiler, Profiler::PHASE_FORWARD, last, numMultiplyAdds( last ) );
+      weightedSums( last, m_Outputs[last - 1], 1, result, true, false );
+      m_Loss = kernel::softmaxCrossEntropy( result, expectedResult.data(), err, expectedResult.size() );
+   } else
+   {
+      m_Loss = 0.0;
+      for( int i = 0; i < expectedResult.size(); i++ )
+      {
+         err[i] = expectedResult[i] - result[i];
+         m_Loss += 0.5 * err[i] * err[i];
+      }
+   }
+
+   // The backward pass may be skipped for samples the network has already
+   // learned well (see setSelector())
+   double weight = 1.0;
+   if( m_Selector && !m_Selector->select( m_Loss, weight ) )
+   {
+      return;
+   }
+   alpha *= weight;
+
+   // **** 3rd step: Successively backpropagate the error
+   // from the last to the second layer.
+   // The first (input) layer does not have an error.
+   for( int i = numLayers() - 1; i >= 2; i-- )
+   {
+      // Propagate the error from layer i to layer i - 1
+      backPropagateError( i );
+   }
+
+   // **** 4th step: Successively adjust the input weights
+   // of all layers in proportion to their errors.
+   for( int i = numLayers() - 1; i >= 1 ; i-- )
+   {
+      adjustWeights( i, alpha );
+   }
+
+   weightsChanged();
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2023-12-14
+Backpropagate the error vector of a specific layer to the previous layer.
+
+The error of neuron n of layer nLayer is:
+
+$$ e_{n,nLayer} $$
+
+The input weight i of neuron n of layer nLayer is:
+
+$$ w_{i,n,nLayer} $$
+
+The error of neuron n of layer nLayer - 1 (the 'previous' layer) is then the
+weighted sum
+
+$$ e_{n,nLayer - 1} = \sum_{k=0}^{numLayers - 1} e_{k,nLayer} * w_{n,k,nLayer} $$
+
+For a convolution layer, the same applies to each position of each filter.
+The errors are summed per patch of the previous layer's image, which is then
+folded back into the image. A pooling layer passes the error of each output
+back to the input that was the maximum.
+
+\param nLayer The index of the layer to backpropagate to the previous layer
+
+*/
+/*----------------------------------------------------------------------------*/
+void NeuralNetwork::backPropagateError( int nLayer )
+{
+   // Sanity check
+   if( nLayer >= numLayers() || nLayer < 2 )
+      return;
+   int prevLayer = nLayer - 1;
+   Profiler::Section section( m_Profiler, Profiler::PHASE_BACKWARD, nLayer, numMultiplyAdds( nLayer ) );
+
+   const LayerSpec &l = m_Layers[nLayer];
+   const double *e = m_Errors[nLayer];
+   double *ePrev = m_Errors[prevLayer];
+
+   if( l.type == LayerSpec::LAYER_DENSE && m_Layers[prevLayer].type == LayerSpec::LAYER_LINEAR )
+   {
+      // Linear layers don't squash their outputs, so they need the gradient
+      // with respect to their outputs including the derivative of the sigmoid
+      static thread_local std::vector<double> deltas;
+      const double *o = m_Outputs[nLayer];
+      deltas.resize( l.size() );
+      for( int n = 0; n < l.size(); n++ )
+      {
+         deltas[n] = e[n] * o[n] * ( 1.0 - o[n] );
+      }
+      kernel::transposedSums( m_Weights[nLayer], deltas.data(), 1, ePrev );
+   } else
+   if( l.type == LayerSpec::LAYER_DENSE || l.type == LayerSpec::LAYER_SOFTMAX || l.type == LayerSpec::LAYER_LINEAR )
+   {
+      kernel::transposedSums( m_Weights[nLayer], e, 1, ePrev );
+   } else
+   if( l.type == LayerSpec::LAYER_CONV )
+   {
+      static thread_local std::vector<double> columns;
+      int nPixels = l.width * l.height;
+      columns.resize( (size_t)nPixels * m_Weights[nLayer].cols() );
+
+      kernel::transposedSums( m_Weights[nLayer], e, nPixels, columns.data() );
+      fromColumns( nLayer, columns.data(), ePrev );
+   } else
+   if( l.type == LayerSpec::LAYER_POOL )
+   {
+      const LayerSpec &p = m_Layers[prevLayer];
+      const double *in = m_Outputs[prevLayer];
+      std::fill( ePrev, ePrev + p.size(), 0.0 );
+
+      for( int y = 0; y < l.height; y++ )
+      {
+         for( int x = 0; x < l.width; x++ )
+         {
+            for( int c = 0; c < l.channels; c++ )
+            {
+               int n = ( y * l.width + x ) * l.channels + c;
+               for( int ky = 0; ky < l.kernelSize; ky++ )
+               {
+                  int row = ( ( y * l.kernelSize + ky ) * p.width + x * l.kernelSize ) * p.channels + c;
+                  int kx = 0;
+                  while( kx < l.kernelSize && in[row + kx * p.channels] != m_Outputs[nLayer][n] )
+                  {
+                     kx++;
+                  }
+                  if( kx < l.kernelSize )
+                  {
+                     ePrev[row + kx * p.channels] += e[n];
+                     break;
+                  }
+               }
+            }
+         }
+      }
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Adjust the input weights of all neurons of a layer in proportion to their
+errors. The filters of a convolution layer are adjusted by the mean of the
+gradients at all n positions, so a filter learns at the same rate as a
+neuron of a dense layer:
+
+$$ w_{k} = w_{k} + { \alpha \over n } \sum_{p,o_{p} > 0} e_{p} i_{p,k} $$
+
+whereby p are the positions of the filter and i_{p,k} the patch of the
+previous layer's image at position p. The rectifier only passes the error
+where the output is positive.
+
+For a softmax layer, the error already is the negative gradient of the
+cross-entropy loss with respect to the weighted sums, and a linear layer has
+no activation function, so for both there's no derivative:
+
+$$ w_{k} = w_{k} + \alpha e i_{k} $$
+
+\param nLayer The index of the layer
+\param alpha The learning rate
+*/
+/*----------------------------------------------------------------------------*/
+void NeuralNetwork::adjustWeights( int nLayer, double alpha )
+{
+   const LayerSpec &l = m_Layers[nLayer];
+
+   // Pooling layers don't have weights to adjust
+   Profiler::Section section( l.type == LayerSpec::LAYER_POOL ? NULL : m_Profiler, Profiler::PHASE_ADJUST, nLayer, numMultiplyAdds( nLayer ) );
+
+   if( l.type == LayerSpec::LAYER_DENSE )
+   {
+      for( int j = 0; j < m_Network[nLayer].size(); j++ )
+      {
+         m_Network[nLayer][j].setError( m_Errors[nLayer][j] );
+         m_Network[nLayer][j].adjustWeights( alpha );
+      }
+   } else
+   if( l.type == LayerSpec::LAYER_SOFTMAX || l.type == LayerSpec::LAYER_LINEAR )
+   {
+      kernel::addOuterProducts( m_Weights[nLayer], m_Errors[nLayer], m_Outputs[nLayer - 1], 1, alpha );
+   } else
+   if( l.type == LayerSpec::LAYER_CONV )
+   {
+      static thread_local std::vector<double> columns;
+      static thread_local std::vector<double> deltas;
+      int nPixels = l.width * l.height;
+      columns.resize( (size_t)nPixels * m_Weights[nLayer].cols() );
+      deltas.resize( l.size() );
+
+      const double *o = m_Outputs[nLayer];
+      for( int n = 0; n < l.size(); n++ )
+      {
+         deltas[n] = o[n] > 0.0 ? m_Errors[nLayer][n] : 0.0;
+      }
+
+      toColumns( nLayer, m_Outputs[nLayer - 1], columns.data() );
+      kernel::addOuterProducts( m_Weights[nLayer], deltas.data(), columns.data(), nPixels, alpha / nPixels );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2023-12-14
+\return The output vector of the last layer
+*/
+/*----------------------------------------------------------------------------*/
+std::vector<double> NeuralNetwork::output()
+{
+   return( output( numLayers() - 1 ) );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The loss of the last sample passed to train(): the cross-entropy if
+the output layer is a softmax layer, otherwise half the squared error
+*/
+/*----------------------------------------------------------------------------*/
+double NeuralNetwork::loss() const
+{
+   return( m_Loss );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2023-12-14
+Returns the output vector of a specific layer.
+\param nLayer the index of the layer
+\return The output vector of the specified layer
+*/
+/*----------------------------------------------------------------------------*/
+std::vector<double> NeuralNetwork::output( int nLayer )
+{
+   std::vector<double> r;
+
+   // Sanity check
+   if( nLayer >= numLayers() || nLayer < 0 )
+   {
+      return( r );
+   }
+
+   r.assign( m_Outputs[nLayer], m_Outputs[nLayer] + numNeurons( nLayer ) );
+
+   return( r );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2023-12-14
+Feed an input vector into the input layer of the network and calculate the
+resulting ouptput of the output layer according to the input weights of all
+neurons.
+After invoking the query() method, the output() method can be used to collect
+the result from the output layer of the network.
+If a cache is set (see setCache()) and the input vector is found in it, only
+the output of the output layer is updated.
+
+\param inputVector The input vector. Its length must be equal to the number of
+input neurons.
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool NeuralNetwork::query( std::vector<double> inputVector )
+{
+   int last = numLayers() - 1;
+   if( m_Cache && last > 0 && inputVector.size() == numNeurons( 0 ) &&
+       m_Cache->lookup( inputVector.data(), inputVector.size(), m_WeightsVersion, m_Outputs[last], numNeurons( last ) ) )
+   {
+      return( true );
+   }
+
+   if( !feed( inputVector, numLayers() ) )
+   {
+      return( false );
+   }
+
+   if( m_Cache )
+   {
+      m_Cache->insert( inputVector.data(), inputVector.size(), m_WeightsVersion, m_Outputs[last], numNeurons( last ) );
+   }
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Feed an input vector into the input layer of the network and calculate the
+outputs of the first nLayers layers.
+
+\param inputVector The input vector. Its length must be equal to the number of
+input neurons.
+\param nLayers The number of layers to calculate
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool NeuralNetwork::feed( const std::vector<double> &inputVector, int nLayers )
+{
+   // Sanity checks
+   if( m_Network.size() < 1 )
+   {
+      return( false );
+   }
+
+   if( ( m_Network[0].size() != inputVector.size() ) ||
+       ( m_Network[0].size() < 1 ) )
+   {
+      return( false );
+   }
+
+   // Query the first layer.
+   // By definition, each neuron of the first layer has only one input,
+   // without any weights, so it passes its input through unaltered.
+   std::copy( inputVector.begin(), inputVector.end(), m_Outputs[0] );
+   propagate( nLayers, true );
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Feed a sample of byte values into the input layer of the network, mapping
+each byte to its input value, and calculate the outputs of the first nLayers
+layers.
+
+\param input The bytes of the sample, one per input neuron
+\param levels The input value of each byte value
+\param nLayers The number of layers to calculate
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool NeuralNetwork::feed( const uint8_t *input, const double *levels, int nLayers )
+{
+   // Sanity checks
+   if( m_Network.size() < 1 || m_Network[0].size() < 1 )
+   {
+      return( false );
+   }
+
+   double *in = m_Outputs[0];
+   for( int i = 0; i < m_Layers[0].size(); i++ )
+   {
+      in[i] = levels[input[i]];
+   }
+   propagate( nLayers, true );
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Calculate the outputs of the layers 1 to nLayers - 1 from the output of the
+input layer.
+
+\param nLayers The number of layers to calculate
+\param halfWeights If true, the layers use the weights in their format,
+otherwise the double weights
+*/
+/*----------------------------------------------------------------------------*/
+void NeuralNetwork::propagate( int nLayers, bool halfWeights )
+{
+   for( int i = 1; i < nLayers; i++ )
+   {
+      // Feed the output of the previous layer into this layer. The layer
+      // kernel stores the weighted sums of the inputs of all neurons in the
+      // output vector, then the neurons apply their activation function.
+      forward( i, m_Outputs[i - 1], 1, m_Outputs[i], true, halfWeights );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2023-12-15
+Randomize all input weights of all neurons. The input weights will be set to
+random values ranging from
+
+$$ \sqrt{ -{ 1 \over numInputs } } $$
+
+to
+
+$$ \sqrt{ +{ 1 \over numInputs } } $$
+
+The seed is drawn from the calling thread's random stream, so networks
+created one after another get different weights while the whole run is still
+reproducible from the global seed.
+*/
+/*----------------------------------------------------------------------------*/
+void NeuralNetwork::randomizeWeights()
+{
+   randomizeWeights( Random::threadLocal().next64() );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Randomize all input weights of all neurons like randomizeWeights(), but
+based on an explicit seed.
+
+Each neuron draws its weights from its own random stream, numbered by its
+position within the network. Large networks are initialized by the workers of
+the ThreadPool, each of which writes the rows of each layer which it touched
+first, see WeightMatrix::clear(). That yields exactly the same weights as a
+single thread would.
+
+\param seed The seed
+*/
+/*----------------------------------------------------------------------------*/
+void NeuralNetwork::randomizeWeights( uint64_t seed )
+{
+   long nWeights = 0;
+   for( int i = 0; i < m_Network.size(); i++ )
+   {
+      nWeights += (long)m_Network[i].size() * ( m_Network[i].empty() ? 0 : m_Network[i][0].numInputs() );
+   }
+
+   ThreadPool &pool = ThreadPool::instance();
+   std::function<void( int nThread )> init = [this, seed, &pool]( int nThread )
+   {
+      for( int i = 0; i < (int)m_Network.size(); i++ )
+      {
+         int begin, end;
+         kernel::partition( m_Network[i].size(), pool.numThreads(), nThread, begin, end );
+         for( int j = begin; j < end; j++ )
+         {
+            Random rng( seed, ( (uint64_t)i << 32 ) | (uint64_t)j );
+            m_Network[i][j].randomizeWeights( rng );
+         }
+      }
+   };
+
+   if( nWeights < PARALLEL_INIT_MIN_WEIGHTS )
+   {
+      for( int t = 0; t < pool.numThreads(); t++ )
+      {
+         init( t );
+      }
+   } else
+   {
+      pool.run( init );
+   }
+
+   weightsChanged();
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Feed a whole batch of input vectors through the network in one pass. Unlike
+query( std::vector<double> ), this doesn't store any state in the neurons, so
+the network can be shared by several threads as long as nobody trains it at
+the same time. If a cache is set (see setCache()), only the samples which
+aren't found in it are calculated.
+
+The batch is processed layer by layer by the layer kernels, which apply each
+block of input weights to all samples of the batch while it's in the cache.
+That way, the input weights are fetched from memory once per batch instead
+of once per sample.
+
+\param inputVectors The input vectors. Each one's length must be equal to the
+number of input neurons.
+\param outputVectors Receives one output vector of the last layer for each
+input vector
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool NeuralNetwork::query( const std::vector<std::vector<double> > &inputVectors, std::vector<std::vector<double> > &outputVectors ) const
+{
+   outputVectors.clear();
+
+   // Sanity checks
+   if( m_Network.size() < 1 || m_Network[0].size() < 1 )
+   {
+      return( false );
+   }
+
+   for( int s = 0; s < inputVectors.size(); s++ )
+   {
+      if( inputVectors[s].size() != m_Network[0].size() )
+      {
+         return( false );
+      }
+   }
+
+   // Samples found in the cache are taken from there, the others are
+   // calculated and added to the cache.
+   int nOutputs = numNeurons( numLayers() - 1 );
+   outputVectors.resize( inputVectors.size() );
+   std::vector<int> misses;
+   for( int s = 0; s < inputVectors.size(); s++ )
+   {
+      outputVectors[s].resize( nOutputs );
+      if( !m_Cache || !m_Cache->lookup( inputVectors[s].data(), inputVectors[s].size(), m_WeightsVersion, outputVectors[s].data(), nOutputs ) )
+      {
+         misses.push_back( s );
+      }
+   }
+
+   // The input layer passes its input through unaltered (its weights are 1.0).
+   // The input vectors of each layer are stored one after another.
+   int nSamples = misses.size();
+   if( nSamples < 1 )
+   {
+      return( true );
+   }
+
+   std::vector<double> cur;
+   std::vector<double> next;
+   cur.reserve( (size_t)nSamples * m_Network[0].size() );
+   for( int s = 0; s < nSamples; s++ )
+   {
+      const std::vector<double> &in = inputVectors[misses[s]];
+      cur.insert( cur.end(), in.begin(), in.end() );
+   }
+
+   for( int i = 1; i < m_Network.size(); i++ )
+   {
+      next.resize( (size_t)nSamples * numNeurons( i ) );
+      forward( i, cur.data(), nSamples, next.data(), true, true );
+      cur.swap( next );
+   }
+
+   for( int s = 0; s < nSamples; s++ )
+   {
+      const double *out = cur.data() + (size_t)s * nOutputs;
+      outputVectors[misses[s]].assign( out, out + nOutputs );
+      if( m_Cache )
+      {
+         m_Cache->insert( inputVectors[misses[s]].data(), m_Network[0].size(), m_WeightsVersion, out, nOutputs );
+      }
+   }
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Feed samples of byte values through the network, like the batch version of
+query() for input vectors of doubles. The bytes are mapped to input values
+BYTE_QUERY_BATCH samples at a time, and each batch is queried before the
+next one is mapped into the same buffer, so a whole dataset can be queried
+while it's kept in memory as bytes.
+
+\param inputs The bytes of the samples, one per input neuron, one sample
+after another
+\param nSamples The number of samples
+\param levels The input value of each byte value
+\param outputVectors Receives one output vector of the last layer for each
+sample
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool NeuralNetwork::query( const uint8_t *inputs, int nSamples, const double *levels, std::vector<std::vector<double> > &outputVectors ) const
+{
+   outputVectors.clear();
+   if( m_Network.size() < 1 )
+   {
+      return( false );
+   }
+
+   int nInputs = numNeurons( 0 );
+   std::vector<std::vector<double> > batch;
+   std::vector<std::vector<double> > batchOutputs;
+   outputVectors.reserve( nSamples );
+   for( int first = 0; first < nSamples; first += BYTE_QUERY_BATCH )
+   {
+      batch.resize( std::min( BYTE_QUERY_BATCH, nSamples - first ), std::vector<double>( nInputs ) );
+      for( int s = 0; s < (int)batch.size(); s++ )
+      {
+         const uint8_t *p = inputs + (size_t)( first + s ) * nInputs;
+         for( int i = 0; i < nInputs; i++ )
+         {
+            batch[s][i] = levels[p[i]];
+         }
+      }
+
+      if( !query( batch, batchOutputs ) )
+      {
+         outputVectors.clear();
+         return( false );
+      }
+      for( int s = 0; s < (int)batchOutputs.size(); s++ )
+      {
+         outputVectors.push_back( std::move( batchOutputs[s] ) );
+      }
+   }
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Feed an input vector into a single layer and calculate its output vector.
+Like the batch version of query(), this doesn't store any state in the
+neurons. The calculation is done entirely in the calling thread, so several
+threads can work on different layers at the same time.
+
+\param nLayer The index of the layer, starting with 1
+\param inputVector The output vector of the previous layer
+\param outputVector Receives the output vector of the layer
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool NeuralNetwork::queryLayer( int nLayer, const std::vector<double> &inputVector, std::vector<double> &outputVector ) const
+{
+   // Sanity checks
+   if( nLayer < 1 || nLayer >= numLayers() || inputVector.size() != numNeurons( nLayer - 1 ) )
+   {
+      return( false );
+   }
+
+   outputVector.resize( numNeurons( nLayer ) );
+   forward( nLayer, inputVector.data(), 1, outputVector.data(), false, true );
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Calculate the outputs of a layer for a batch of samples from the outputs of
+the previous layer.
+
+A convolution layer is lowered to a dense layer by copying the patch of the
+previous layer's image at each position into a row of a matrix (im2col).
+Then each position is just another sample for the layer kernel, and the
+weighted sums come out pixel by pixel with all channels of a pixel next to
+each other, which is the layout of the layer's image.
+
+Convolution layers use the rectifier max( 0, x ) as activation function. With
+the logistic function, their outputs would all be close to 0.5, which keeps
+the following dense layers from learning.
+
+\param nLayer The index of the layer, starting with 1
+\param in The output vectors of the previous layer, one after another
+\param nSamples The number of samples
+\param out Receives the output vectors of the layer, one after another
+\param parallel If true, the layer kernels may use the ThreadPool
+\param halfWeights If true, the layer uses the weights in its format,
+otherwise the double weights
+*/
+/*----------------------------------------------------------------------------*/
+void NeuralNetwork::forward( int nLayer, const double *in, int nSamples, double *out, bool parallel, bool halfWeights ) const
+{
+   const LayerSpec &l = m_Layers[nLayer];
+   const LayerSpec &p = m_Layers[nLayer - 1];
+   const WeightMatrix &w = m_Weights[nLayer];
+   Profiler::Section section( m_Profiler, Profiler::PHASE_FORWARD, nLayer, numMultiplyAdds( nLayer ) * nSamples );
+
+   if( l.type == LayerSpec::LAYER_DENSE || l.type == LayerSpec::LAYER_SOFTMAX || l.type == LayerSpec::LAYER_LINEAR )
+   {
+      weightedSums( nLayer, in, nSamples, out, parallel, halfWeights );
+      activate( nLayer, out, nSamples );
+   } else
+   if( l.type == LayerSpec::LAYER_CONV )
+   {
+      static thread_local std::vector<double> columns;
+      int nPixels = l.width * l.height;
+      size_t sampleColumns = (size_t)nPixels * w.cols();
+      columns.resize( nSamples * sampleColumns );
+
+      for( int s = 0; s < nSamples; s++ )
+      {
+         toColumns( nLayer, in + (size_t)s * p.size(), columns.data() + s * sampleColumns );
+      }
+
+      weightedSums( nLayer, columns.data(), nSamples * nPixels, out, parallel, halfWeights );
+      activate( nLayer, out, nSamples );
+   } else
+   if( l.type == LayerSpec::LAYER_POOL )
+   {
+      for( int s = 0; s < nSamples; s++ )
+      {
+         const double *img = in + (size_t)s * p.size();
+         double *o = out + (size_t)s * l.size();
+
+         for( int y = 0; y < l.height; y++ )
+         {
+            for( int x = 0; x < l.width; x++ )
+            {
+               for( int c = 0; c < l.channels; c++ )
+               {
+                  double m = -std::numeric_limits<double>::infinity();
+                  for( int ky = 0; ky < l.kernelSize; ky++ )
+                  {
+                     const double *row = img + ( ( y * l.kernelSize + ky ) * p.width + x * l.kernelSize ) * p.channels + c;
+                     for( int kx = 0; kx < l.kernelSize; kx++ )
+                     {
+                        m = std::max( m, row[kx * p.channels] );
+                     }
+                  }
+                  o[( y * l.width + x ) * l.channels + c] = m;
+               }
+            }
+         }
+      }
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Calculate the weighted sums of a layer with the weights in the layer's
+format, or with the double weights.
+
+\param nLayer The index of a dense, softmax or convolution layer
+\param in The input vectors of the layer kernel, one after another
+\param nSamples The number of input vectors
+\param out Receives the weighted sums
+\param parallel If true, the layer kernel may use the ThreadPool
+\param halfWeights If true, the weights in the layer's format are used,
+otherwise the double weights
+*/
+/*----------------------------------------------------------------------------*/
+void NeuralNetwork::weightedSums( int nLayer, const double *in, int nSamples, double *out, bool parallel, bool halfWeights ) const
+{
+   const WeightMatrix &w = m_Weights[nLayer];
+   const HalfMatrix &h = m_HalfWeights[nLayer];
+
+   if( halfWeights && h.format() != HalfMatrix::FORMAT_NONE )
+   {
+      updateHalfWeights();
+      if( parallel )
+      {
+         kernel::weightedSums( h, in, nSamples, out );
+      } else
+      {
+         kernel::weightedSums( h, in, nSamples, out, 0, h.rows() );
+      }
+   } else
+   {
+      if( parallel )
+      {
+         kernel::weightedSums( w, in, nSamples, out );
+      } else
+      {
+         kernel::weightedSums( w, in, nSamples, out, 0, w.rows() );
+      }
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Apply the activation function of a layer to its weighted sums: the logistic
+function for dense layers, the softmax function for softmax layers and the
+rectifier for convolution layers. The outputs of linear layers are their
+weighted sums.
+
+\param nLayer The index of the layer
+\param v The weighted sums of a batch of samples, replaced by the outputs
+\param nSamples The number of samples
+*/
+/*----------------------------------------------------------------------------*/
+void NeuralNetwork::activate( int nLayer, double *v, int nSamples ) const
+{
+   const LayerSpec &l = m_Layers[nLayer];
+   size_t n = (size_t)nSamples * l.size();
+
+   if( l.type == LayerSpec::LAYER_DENSE )
+   {
+      for( size_t i = 0; i < n; i++ )
+      {
+         v[i] = m_Network[nLayer][i % l.size()].activate( v[i] );
+      }
+   } else
+   if( l.type == LayerSpec::LAYER_SOFTMAX )
+   {
+      for( int s = 0; s < nSamples; s++ )
+      {
+         kernel::softmax( v + (size_t)s * l.size(), l.size() );
+      }
+   } else
+   if( l.type == LayerSpec::LAYER_CONV )
+   {
+      for( size_t i = 0; i < n; i++ )
+      {
+         v[i] = std::max( v[i], 0.0 );
+      }
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Copy the patch of the previous layer's image at each position of the filters
+of a convolution layer into a row of a matrix (im2col). The rows are ordered
+like the layer's pixels, and each row is ordered like the filters' weights.
+
+\param nLayer The index of the convolution layer
+\param in The image of the previous layer
+\param columns Receives width x height rows of numInputs() doubles each
+*/
+/*----------------------------------------------------------------------------*/
+void NeuralNetwork::toColumns( int nLayer, const double *in, double *columns ) const
+{
+   const LayerSpec &l = m_Layers[nLayer];
+   const LayerSpec &p = m_Layers[nLayer - 1];
+   int patchRow = l.kernelSize * p.channels;
+
+   for( int y = 0; y < l.height; y++ )
+   {
+      for( int x = 0; x < l.width; x++ )
+      {
+         for( int ky = 0; ky < l.kernelSize; ky++ )
+         {
+            const double *src = in + ( ( y * l.stride + ky ) * p.width + x * l.stride ) * p.channels;
+            memcpy( columns, src, patchRow * sizeof( double ) );
+            columns += patchRow;
+         }
+      }
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+The reverse of toColumns() (col2im): sum the rows of a matrix into the
+previous layer's image, each at the position of its patch. Where patches
+overlap, their values are added.
+
+\param nLayer The index of the convolution layer
+\param columns width x height rows of numInputs() doubles each
+\param in Receives the image of the previous layer
+*/
+/*----------------------------------------------------------------------------*/
+void NeuralNetwork::fromColumns( int nLayer, const double *columns, double *in ) const
+{
+   const LayerSpec &l = m_Layers[nLayer];
+   const LayerSpec &p = m_Layers[nLayer - 1];
+   int patchRow = l.kernelSize * p.channels;
+
+   memset( in, 0, p.size() * sizeof( double ) );
+   for( int y = 0; y < l.height; y++ )
+   {
+      for( int x = 0; x < l.width; x++ )
+      {
+         for( int ky = 0; ky < l.kernelSize; ky++ )
+         {
+            double *dst = in + ( ( y * l.stride + ky ) * p.width + x * l.stride ) * p.channels;
+            for( int k = 0; k < patchRow; k++ )
+            {
+               dst[k] += columns[k];
+            }
+            columns += patchRow;
+         }
+      }
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Apply the activation function of a dense, softmax or linear layer to weighted sums of
+its inputs which have been calculated elsewhere, for example from the
+weights().
+
+\param nLayer The index of the layer, starting with 1
+\param sums The weighted sums
+\param outputVector Receives the output vector of the layer
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool NeuralNetwork::activateLayer( int nLayer, const std::vector<double> &sums, std::vector<double> &outputVector ) const
+{
+   // Sanity checks
+   if( nLayer < 1 || nLayer >= numLayers() || sums.size() != numNeurons( nLayer ) ||
+       ( m_Layers[nLayer].type != LayerSpec::LAYER_DENSE && m_Layers[nLayer].type != LayerSpec::LAYER_SOFTMAX &&
+         m_Layers[nLayer].type != LayerSpec::LAYER_LINEAR ) )
+   {
+      return( false );
+   }
+
+   outputVector = sums;
+   activate( nLayer, outputVector.data(), 1 );
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Save the topology and all input weights of the network to a binary file. The
+file consists of the magic "NNET", the number of layers and the number of
+neurons in each layer as 32 bit integers, followed by the input weights of
+all neurons beyond the input layer as doubles, layer by layer and neuron by
+neuron.
+
+If the network has layers other than dense ones, or its input is an image,
+the magic is "NNLY" and each layer is described by its type, width, height,
+channels, kernel size and stride instead of just the number of neurons.
+
+\param filename The name of the file
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool NeuralNetwork::save( std::string filename ) const
+{
+   FILE *f = fopen( filename.c_str(), "wb" );
+   if( !f )
+   {
+      return( false );
+   }
+
+   bool dense = true;
+   for( int i = 0; i < numLayers(); i++ )
+   {
+      dense = dense && m_Layers[i].height == 1 && m_Layers[i].channels == 1 &&
+              ( i == 0 || m_Layers[i].type == LayerSpec::LAYER_DENSE );
+   }
+
+   bool ok = fwrite( dense ? NN_FILE_MAGIC : NN_FILE_MAGIC_LAYERS, 1, 4, f ) == 4;
+
+   int32_t n = numLayers();
+   ok = ok && fwrite( &n, sizeof( n ), 1, f ) == 1;
+   for( int i = 0; i < numLayers(); i++ )
+   {
+      const LayerSpec &l = m_Layers[i];
+      int32_t desc[6] = { l.type, l.width, l.height, l.channels, l.kernelSize, l.stride };
+      if( dense )
+      {
+         ok = ok && fwrite( &desc[1], sizeof( int32_t ), 1, f ) == 1;
+      } else
+      {
+         ok = ok && fwrite( desc, sizeof( int32_t ), 6, f ) == 6;
+      }
+   }
+
+   for( int i = 1; ok && i < numLayers(); i++ )
+   {
+      const WeightMatrix &w = m_Weights[i];
+      for( int j = 0; ok && j < w.rows(); j++ )
+      {
+         ok = fwrite( w.row( j ), sizeof( double ), w.cols(), f ) == w.cols();
+      }
+   }
+
+   if( fclose( f ) != 0 )
+   {
+      ok = false;
+   }
+
+   return( ok );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Replace the network by one previously stored with save(). The network keeps
+its current state if the file can't be read.
+
+\param filename The name of the file
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool NeuralNetwork::load( std::string filename )
+{
+   FILE *f = fopen( filename.c_str(), "rb" );
+   if( !f )
+   {
+      return( false );
+   }
+
+   char magic[4];
+   int32_t nLayers = 0;
+   bool ok = fread( magic, 1, 4, f ) == 4 &&
+             ( memcmp( magic, NN_FILE_MAGIC, 4 ) == 0 || memcmp( magic, NN_FILE_MAGIC_LAYERS, 4 ) == 0 ) &&
+             fread( &nLayers, sizeof( nLayers ), 1, f ) == 1 &&
+             nLayers > 0;
+   bool dense = memcmp( magic, NN_FILE_MAGIC, 4 ) == 0;
+
+   std::vector<LayerSpec> layers;
+   for( int i = 0; ok && i < nLayers; i++ )
+   {
+      int32_t desc[6] = { 0, 0, 0, 0, 0, 0 };
+      if( dense )
+      {
+         ok = fread( &desc[1], sizeof( int32_t ), 1, f ) == 1 && desc[1] > 0;
+         layers.push_back( LayerSpec::dense( desc[1] ) );
+      } else
+      {
+         ok = fread( desc, sizeof( int32_t ), 6, f ) == 6 &&
+              desc[0] >= LayerSpec::LAYER_INPUT && desc[0] <= LayerSpec::LAYER_LINEAR;
+         LayerSpec l = { (LayerSpec::LayerType)desc[0], desc[1], desc[2], desc[3], desc[4], desc[5] };
+         layers.push_back( l );
+      }
+   }
+
+   NeuralNetwork nn( layers );
+   ok = ok && nn.numLayers() == nLayers;
+   for( int i = 0; ok && !dense && i < nLayers; i++ )
+   {
+      // The shapes stored in the file must match the resolved ones
+      ok = nn.m_Layers[i].size() == layers[i].size();
+   }
+
+   for( int i = 1; ok && i < nn.numLayers(); i++ )
+   {
+      WeightMatrix &w = nn.m_Weights[i];
+      for( int j = 0; ok && j < w.rows(); j++ )
+      {
+         ok = fread( w.row( j ), sizeof( double ), w.cols(), f ) == w.cols();
+      }
+   }
+
+   fclose( f );
+
+   if( ok )
+   {
+      // The neurons stay bound to the storage, which is swapped along
+      m_Layers.swap( nn.m_Layers );
+      m_Network.swap( nn.m_Network );
+      m_Weights.swap( nn.m_Weights );
+      m_HalfWeights.swap( nn.m_HalfWeights );
+      std::swap( m_Arena, nn.m_Arena );
+      m_Outputs.swap( nn.m_Outputs );
+      m_Errors.swap( nn.m_Errors );
+      weightsChanged();
+   }
+
+   return( ok );
+}
@@ -27,35 +27,119 @@
 #ifndef __NEURALNETWORK_H__
 #define __NEURALNETWORK_H__
 
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
 #include <vector>
 
+#include "Arena.h"
+#include "BackpropSelector.h"
+#include "HalfMatrix.h"
+#include "LayerSpec.h"
 #include "Neuron.h"
+#include "QueryCache.h"
+#include "WeightMatrix.h"
+
+class Profiler;
 
 /*----------------------------------------------------------------------------*/
 /*!
 \class NeuralNetwork
 \date  2023-12-12
+
+Besides fully connected (dense) layers, a network may contain convolution
+and max pooling layers, as described by LayerSpec. The neurons of a
+convolution layer are its filters, whose weights are shared by all pixels.
 */
 /*----------------------------------------------------------------------------*/
 class NeuralNetwork
 {
 public:
    NeuralNetwork( std::vector<int> numNeurons );
+   NeuralNetwork( std::vector<LayerSpec> layers );
+   NeuralNetwork( std::vector<LayerSpec> layers, uint64_t seed );
+   NeuralNetwork( const NeuralNetwork &other );
    ~NeuralNetwork();
 
+   NeuralNetwork &operator=( const NeuralNetwork &other );
+   NeuralNetwork clone() const;
+   bool copyWeightsFrom( const NeuralNetwork &other );
+
    void train( std::vector<double> input, std::vector<double> expectedResult, double alpha );
+   void train( const uint8_t *input, const double *levels, const std::vector<double> &expectedResult, double alpha );
    bool query( std::vector<double> inputVector );
+   bool query( const std::vector<std::vector<double> > &inputVectors, std::vector<std::vector<double> > &outputVectors ) const;
+   bool query( const uint8_t *inputs, int nSamples, const double *levels, std::vector<std::vector<double> > &outputVectors ) const;
+   bool queryLayer( int nLayer, const std::vector<double> &inputVector, std::vector<double> &outputVector ) const;
+   bool activateLayer( int nLayer, const std::vector<double> &sums, std::vector<double> &outputVector ) const;
 
    std::vector<double> output();
+   double loss() const;
    void randomizeWeights();
+   void randomizeWeights( uint64_t seed );
    int numLayers() const;
+   int numNeurons( int nLayer ) const;
+   const LayerSpec &layer( int nLayer ) const;
+   const WeightMatrix &weights( int nLayer ) const;
+   long numMultiplyAdds( int nLayer ) const;
+   uint64_t weightsVersion() const;
+   bool setWeightFormat( int nLayer, HalfMatrix::Format format );
+   HalfMatrix::Format weightFormat( int nLayer ) const;
+   void setCache( QueryCache *cache );
+   void setSelector( BackpropSelector *selector );
+   void setProfiler( Profiler *profiler );
+
+   void getWeights( std::vector<double> &weights ) const;
+   bool setWeights( const std::vector<double> &weights );
+
+   bool save( std::string filename ) const;
+   bool load( std::string filename );
 
 private:
+   bool create( std::vector<LayerSpec> layers );
+   void weightShape( int nLayer, int &nRows, int &nInputs ) const;
+   void bindArena();
+   void copyArena( const NeuralNetwork &other );
+   bool feed( const std::vector<double> &inputVector, int nLayers );
+   bool feed( const uint8_t *input, const double *levels, int nLayers );
+   void propagate( int nLayers, bool halfWeights );
+   void learn( const std::vector<double> &expectedResult, double alpha );
    std::vector<double> output( int nLayer );
+   void forward( int nLayer, const double *in, int nSamples, double *out, bool parallel, bool halfWeights ) const;
+   void weightedSums( int nLayer, const double *in, int nSamples, double *out, bool parallel, bool halfWeights ) const;
+   void activate( int nLayer, double *v, int nSamples ) const;
+   void toColumns( int nLayer, const double *in, double *columns ) const;
+   void fromColumns( int nLayer, const double *columns, double *in ) const;
    void backPropagateError( int nLayer );
+   void adjustWeights( int nLayer, double alpha );
+   void bindNeurons();
+   void weightsChanged();
+   void updateHalfWeights() const;
 
 private:
+   std::vector<LayerSpec> m_Layers;
    std::vector<std::vector<Neuron> > m_Network;
+
+   // The 16 bit copies of the weights used by queries. They're converted
+   // from the weights by the first query after the weights have changed, see
+   // updateHalfWeights().
+   mutable std::vector<HalfMatrix> m_HalfWeights;
+   mutable std::atomic<bool> m_HalfStale;
+   mutable std::mutex m_HalfMutex;
+
+   // The storage of the weights, the outputs and the errors of all layers,
+   // and views of it, see bindArena()
+   Arena m_Arena;
+   std::vector<WeightMatrix> m_Weights;
+   std::vector<double *> m_Outputs;
+   std::vector<double *> m_Errors;
+   double m_Loss;
+   uint64_t m_WeightsVersion;
+   QueryCache *m_Cache;
+   BackpropSelector *m_Selector;
+   Profiler *m_Profiler;
 };
 
 #endif
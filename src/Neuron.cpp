@@ -27,7 +27,6 @@
 #include <math.h>
 
 #include "Neuron.h"
-#include "util.h"
 
 
 /*----------------------------------------------------------------------------*/
@@ -39,13 +38,13 @@ network
 */
 /*----------------------------------------------------------------------------*/
 Neuron::Neuron( int layer, int nInputs ) :
-   m_nLayer( layer ),
-   m_numInputs( nInputs ),
+   m_Weights( NULL ),
+   m_Inputs( NULL ),
+   m_Output( NULL ),
    m_Error( 0.0 ),
-   m_Output( 0.0 )
+   m_numInputs( nInputs ),
+   m_nLayer( layer )
 {
-   m_Weights.resize( m_numInputs );
-   m_Inputs.resize( m_numInputs );
 }
 
 
@@ -60,6 +59,24 @@ Neuron::~Neuron()
 }
 
 
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Bind the neuron to its storage. The neuron must be bound before it can be
+used.
+\param weights The numInputs() input weights
+\param inputs The numInputs() input values, usually the outputs of the
+previous layer
+\param output Where the output is stored
+*/
+/*----------------------------------------------------------------------------*/
+void Neuron::bind( double *weights, const double *inputs, double *output )
+{
+   m_Weights = weights;
+   m_Inputs = inputs;
+   m_Output = output;
+}
+
+
 /*----------------------------------------------------------------------------*/
 /*! 2023-12-15
 Set the output error (the difference betweeb the output and the expected output).
@@ -85,101 +102,33 @@ double Neuron::error() const
 
 /*----------------------------------------------------------------------------*/
 /*! 2023-12-15
-\return The output, after the input has been processed with query()
+\return The output, after the NeuralNetwork has calculated the layer
 */
 /*----------------------------------------------------------------------------*/
 double Neuron::output() const
 {
-   return( m_Output );
-}
-
-
-/*----------------------------------------------------------------------------*/
-/*! 2023-12-15
-Feed the neuron with an input vector and calculate the output. The size of the
-input vector must be equal to the number of inputs of the neuron.
-
-The output is calculated with:
-
-$$ o = { 1 \over { 1 + e ^ { - \sum_{k=0}^{numInputs-1} { w_k i_k } } } } $$
-
-Whereby
-
-$$ w_k $$
-
-are the input weights and
-
-$$ i_k $$
-
-are the input values.
-
-After the query, the resulting output can be acquired with the output() function.
-
-\return true on success or false on failure
-*/
-/*----------------------------------------------------------------------------*/
-bool Neuron::query( std::vector<double> inputVector )
-{
-   if( m_Inputs.size() != inputVector.size() )
-   {
-      return( false );
-   }
-
-   for( int i = 0; i < inputVector.size(); i++ )
-   {
-      m_Inputs[i] = inputVector[i];
-   }
-
-   return( query() );
+   return( *m_Output );
 }
 
 
 /*----------------------------------------------------------------------------*/
-/*! 2023-12-15
-Convenience function for the special case where the input vector's length is 1.
-\return true on success
+/*! 2026-10-18
+Apply the activation function to a weighted sum of inputs.
+\param v The weighted sum
+\return The activated output
 */
 /*----------------------------------------------------------------------------*/
-bool Neuron::query( double v )
+double Neuron::activate( double v ) const
 {
-   std::vector<double> inputVector = std::vector<double>( { v } );
-   return( query( inputVector ) );
-}
-
-
-/*----------------------------------------------------------------------------*/
-/*! 2023-12-15
-Process the internally stored input values and store the result internally.
-\return true on success
-*/
-/*----------------------------------------------------------------------------*/
-bool Neuron::query()
-{
-   double v = 0.0;
-
-   // Sanity check
-   if( m_Weights.size() != m_Inputs.size() )
-   {
-      return( false );
-   }
-
-   // Calculate the weighted sum of the inputs
-   for( int i = 0; i < m_Inputs.size(); i++ )
-   {
-      v += m_Inputs[i] * m_Weights[i];
-   }
-
    // If this neuron is part of the input layer within the network, don't
    // apply the activation function.
    if( m_nLayer == 0 )
    {
-      m_Output = v;
+      return( v );
    } else
    {
-      m_Output = 1.0 / ( 1.0 + exp( -v ) );
+      return( 1.0 / ( 1.0 + exp( -v ) ) );
    }
-
-   return( true );
 }
 
 
@@ -193,18 +142,20 @@ $$ \sqrt{ -{ 1 \over numInputs } } $$
 to
 
 $$ \sqrt{ +{ 1 \over numInputs } } $$
+
+\param rng The random number generator to draw the weights from
 */
 /*----------------------------------------------------------------------------*/
-void Neuron::randomizeWeights()
+void Neuron::randomizeWeights( Random &rng )
 {
-   for( int i = 0; i < m_Weights.size(); i++ )
+   for( int i = 0; i < m_numInputs; i++ )
    {
       if( m_nLayer == 0 )
       {
          m_Weights[i] = 1.0;
       } else
       {
-         m_Weights[i] = util::randomValue( -1.0 / sqrt( m_numInputs ), 1.0 / sqrt( m_numInputs ) );
+         m_Weights[i] = rng.uniform( -1.0 / sqrt( m_numInputs ), 1.0 / sqrt( m_numInputs ) );
       }
    }
 }
@@ -213,7 +164,8 @@ void Neuron::randomizeWeights()
 /*----------------------------------------------------------------------------*/
 /*! 2023-12-15
 This is the implementation of the "learning" process. Call this function after
-using query() followed by setError() to adjust the input weights according to
+the NeuralNetwork has calculated the output and setError() to adjust the input
+weights according to
 
 - The current input weights
 - The output
@@ -225,7 +177,7 @@ using query() followed by setError() to adjust the input weights according to
 /*----------------------------------------------------------------------------*/
 void Neuron::adjustWeights( double alpha )
 {
-   for( int i = 0; i < m_Weights.size(); i++ )
+   for( int i = 0; i < m_numInputs; i++ )
    {
       // gradient
       double gradient = - m_Error * output() * ( 1.0 - output() ) * m_Inputs[i];
@@ -256,7 +208,7 @@ Retrieve a specific input weight of this neuron.
 /*----------------------------------------------------------------------------*/
 double Neuron::weight( int n ) const
 {
-   if( n < 0 || n >= m_Weights.size() )
+   if( n < 0 || n >= m_numInputs )
       return( NAN );
    else
       return( m_Weights[n] );
@@ -29,10 +29,16 @@
 
 #include <vector>
 
+#include "Random.h"
+
 /*----------------------------------------------------------------------------*/
 /*!
 \class Neuron
 \date  2023-12-12
+
+A neuron doesn't own any storage for its input weights, its inputs and its
+output. These live in the WeightMatrix and the output vectors of the layers
+of the NeuralNetwork, which binds them to the neuron with bind().
 */
 /*----------------------------------------------------------------------------*/
 class Neuron
@@ -41,25 +47,22 @@ public:
    Neuron( int layer, int nInputs );
    ~Neuron();
 
+   void bind( double *weights, const double *inputs, double *output );
    void setError( double e );
    void adjustWeights( double alpha );
    double error() const;
    double weight( int n ) const;
    int numInputs() const;
    double output() const;
-   bool query( double v );
-   bool query( std::vector<double> inputVector );
-   void randomizeWeights();
-
-private:
-   bool query();
+   double activate( double v ) const;
+   void randomizeWeights( Random &rng );
 
 private:
-   std::vector<double> m_Weights;
-   std::vector<double> m_Inputs;
+   double *m_Weights;
+   const double *m_Inputs;
+   double *m_Output;
 
    double m_Error;
-   double m_Output;
 
    int m_numInputs;
    int m_nLayer;
@@ -0,0 +1,280 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file Pipeline.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Implementation of the class Pipeline, layer-pipelined streaming
+inference.
+*/
+/*----------------------------------------------------------------------------*/
+#include <limits.h>
+
+#include <algorithm>
+
+#include "Pipeline.h"
+
+// The capacity of the queue in front of each stage
+#define STAGE_QUEUE_CAPACITY 64
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor. Splits the layers of the network into contiguous stages such
+that the number of floating point operations of the most expensive stage is
+as small as possible, then starts one thread per stage.
+
+\param nn The network. It must not be modified while the pipeline exists.
+\param nStages The desired number of stages. It's limited to the number of
+layers beyond the input layer.
+*/
+/*----------------------------------------------------------------------------*/
+Pipeline::Pipeline( const NeuralNetwork &nn, int nStages ) :
+   m_NeuralNetwork( nn ),
+   m_Finished( false ),
+   m_Drained( false )
+{
+   int nLayers = nn.numLayers() - 1;
+   nStages = std::max( 1, std::min( nStages, nLayers ) );
+
+   // The cost of layer i is the number of multiply-adds of layer i + 1
+   std::vector<long> prefix( nLayers + 1, 0 );
+   for( int i = 0; i < nLayers; i++ )
+   {
+      prefix[i + 1] = prefix[i] + nn.numMultiplyAdds( i + 1 );
+   }
+
+   // best[k][i]: the minimum cost of the most expensive stage when the first
+   // i layers are split into k stages; split[k][i]: where the last of these
+   // stages begins
+   std::vector<std::vector<long> > best( nStages + 1, std::vector<long>( nLayers + 1, LONG_MAX ) );
+   std::vector<std::vector<int> > split( nStages + 1, std::vector<int>( nLayers + 1, 0 ) );
+   best[0][0] = 0;
+   for( int k = 1; k <= nStages; k++ )
+   {
+      for( int i = k; i <= nLayers; i++ )
+      {
+         for( int j = k - 1; j < i; j++ )
+         {
+            if( best[k - 1][j] == LONG_MAX )
+            {
+               continue;
+            }
+
+            long cost = std::max( best[k - 1][j], prefix[i] - prefix[j] );
+            if( cost < best[k][i] )
+            {
+               best[k][i] = cost;
+               split[k][i] = j;
+            }
+         }
+      }
+   }
+
+   m_FirstLayer.resize( nStages + 1 );
+   m_FirstLayer[nStages] = nLayers + 1;
+   for( int k = nStages, i = nLayers; k > 0; k-- )
+   {
+      i = split[k][i];
+      m_FirstLayer[k - 1] = i + 1;
+   }
+
+   // Queue n feeds stage n, the last queue holds the outputs
+   for( int k = 0; k <= nStages; k++ )
+   {
+      m_Queues.push_back( std::unique_ptr<Queue>( new Queue( STAGE_QUEUE_CAPACITY ) ) );
+   }
+
+   for( int k = 0; k < nStages; k++ )
+   {
+      m_Threads.push_back( std::thread( &Pipeline::runStage, this, k ) );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Destructor. Waits for all samples to pass through the pipeline and discards
+the outputs which haven't been received. If finish() hasn't been called, the
+outputs are discarded while the end of the stream is fed in, so a full
+pipeline can't block the destructor.
+*/
+/*----------------------------------------------------------------------------*/
+Pipeline::~Pipeline()
+{
+   std::vector<double> v;
+   if( !m_Finished )
+   {
+      std::vector<double> end;
+      while( !m_Queues[0]->tryPush( end ) )
+      {
+         if( !m_Queues.back()->tryPop( v ) )
+         {
+            std::this_thread::yield();
+         }
+      }
+      m_Finished = true;
+   }
+
+   // The end marker is the only empty vector
+   while( !m_Drained )
+   {
+      m_Queues.back()->pop( v );
+      m_Drained = v.size() < 1;
+   }
+
+   for( int i = 0; i < (int)m_Threads.size(); i++ )
+   {
+      m_Threads[i].join();
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of stages
+*/
+/*----------------------------------------------------------------------------*/
+int Pipeline::numStages() const
+{
+   return( m_Threads.size() );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param nStage The index of a stage
+\return The index of the first layer of the stage
+*/
+/*----------------------------------------------------------------------------*/
+int Pipeline::firstLayer( int nStage ) const
+{
+   return( m_FirstLayer[nStage] );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param nStage The index of a stage
+\return The index of the last layer of the stage
+*/
+/*----------------------------------------------------------------------------*/
+int Pipeline::lastLayer( int nStage ) const
+{
+   return( m_FirstLayer[nStage + 1] - 1 );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Feed an input vector into the pipeline. Waits while the first stage's queue
+is full.
+\param inputVector The input vector
+\return true on success, false if the size of the input vector doesn't match
+the number of input neurons or finish() has already been called
+*/
+/*----------------------------------------------------------------------------*/
+bool Pipeline::submit( std::vector<double> inputVector )
+{
+   if( m_Finished || inputVector.size() != m_NeuralNetwork.numNeurons( 0 ) )
+   {
+      return( false );
+   }
+
+   m_Queues[0]->push( inputVector );
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Signal that no more samples will be submitted. After all outputs have been
+received, receive() returns false. Like submit(), it waits while the first
+stage's queue is full, and it must be called by the thread which submits the
+samples.
+*/
+/*----------------------------------------------------------------------------*/
+void Pipeline::finish()
+{
+   if( !m_Finished )
+   {
+      // An empty vector marks the end of the stream
+      std::vector<double> end;
+      m_Queues[0]->push( end );
+      m_Finished = true;
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Collect the output vector of the next sample, waiting until it's available.
+\param outputVector Receives the output vector
+\return true on success, false if finish() has been called and all outputs
+have been received
+*/
+/*----------------------------------------------------------------------------*/
+bool Pipeline::receive( std::vector<double> &outputVector )
+{
+   if( m_Drained )
+   {
+      return( false );
+   }
+
+   m_Queues.back()->pop( outputVector );
+   m_Drained = outputVector.size() < 1;
+
+   return( !m_Drained );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+The thread of a stage. It runs each vector from its queue through its layers
+and passes the result on to the next queue.
+\param nStage The index of the stage
+*/
+/*----------------------------------------------------------------------------*/
+void Pipeline::runStage( int nStage )
+{
+   Queue &in = *m_Queues[nStage];
+   Queue &out = *m_Queues[nStage + 1];
+   std::vector<double> v;
+   std::vector<double> next;
+
+   for( ;; )
+   {
+      in.pop( v );
+      if( v.size() < 1 )
+      {
+         out.push( v );
+         break;
+      }
+
+      // submit() has already checked the size of the input vector
+      for( int i = firstLayer( nStage ); i <= lastLayer( nStage ); i++ )
+      {
+         m_NeuralNetwork.queryLayer( i, v, next );
+         v.swap( next );
+      }
+
+      out.push( v );
+   }
+}
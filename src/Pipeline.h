@@ -0,0 +1,87 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file Pipeline.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for class Pipeline
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "NeuralNetwork.h"
+#include "SpscQueue.h"
+
+/*----------------------------------------------------------------------------*/
+/*!
+\class Pipeline
+\date  2026-10-18
+
+Streams samples through a NeuralNetwork with the layers split into stages,
+each running on its own thread. The stages are connected by SpscQueues, so
+while one sample is in the second stage, the next one can already be in the
+first stage.
+
+Samples are submitted by one thread with submit() and finish() and their
+output vectors are collected, in the same order, by one thread with
+receive(). Since the queues are bounded, the thread collecting the outputs
+must not be the one submitting the samples, unless it never submits more
+than the queues can hold before receiving. Idle stages block instead of
+spinning.
+
+The pipeline may be destroyed at any time by the thread which submits the
+samples, as long as no other thread submits or receives any more.
+*/
+/*----------------------------------------------------------------------------*/
+class Pipeline
+{
+public:
+   Pipeline( const NeuralNetwork &nn, int nStages );
+   ~Pipeline();
+
+   int numStages() const;
+   int firstLayer( int nStage ) const;
+   int lastLayer( int nStage ) const;
+
+   bool submit( std::vector<double> inputVector );
+   bool receive( std::vector<double> &outputVector );
+   void finish();
+
+private:
+   void runStage( int nStage );
+
+private:
+   typedef SpscQueue<std::vector<double> > Queue;
+
+   const NeuralNetwork &m_NeuralNetwork;
+   std::vector<int> m_FirstLayer;
+   std::vector<std::unique_ptr<Queue> > m_Queues;
+   std::vector<std::thread> m_Threads;
+   std::atomic<bool> m_Finished;
+   bool m_Drained;
+};
+
+#endif
@@ -0,0 +1,463 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+/*----------------------------------------------------------------------------*/
+/*!
+\file Profiler.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Implementation of the class Profiler, which collects hardware
+performance counters for the forward pass, the backward pass and the
+adjustment of the weights of each layer of a network.
+*/
+/*----------------------------------------------------------------------------*/
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+#include <algorithm>
+
+#include "NeuralNetwork.h"
+#include "Profiler.h"
+#include "Random.h"
+#include "WeightMatrix.h"
+#include "kernel.h"
+
+// The peak throughput of each layer shape is measured for at least this long
+#define PROFILER_PEAK_S 0.2
+
+// A pass achieving at least this fraction of the peak is compute bound
+#define PROFILER_COMPUTE_BOUND 0.5
+
+// A pass with at least this many LLC or dTLB misses per 1000 instructions
+// is memory bound
+#define PROFILER_MEMORY_BOUND_MPKI 1.0
+
+// The hardware events of the counters
+static const uint32_t s_Types[] =
+{
+   PERF_TYPE_HARDWARE,
+   PERF_TYPE_HARDWARE,
+   PERF_TYPE_HW_CACHE,
+   PERF_TYPE_HARDWARE,
+   PERF_TYPE_HW_CACHE
+};
+
+static const uint64_t s_Configs[] =
+{
+   PERF_COUNT_HW_CPU_CYCLES,
+   PERF_COUNT_HW_INSTRUCTIONS,
+   PERF_COUNT_HW_CACHE_L1D | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 ),
+   PERF_COUNT_HW_CACHE_MISSES,
+   PERF_COUNT_HW_CACHE_DTLB | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 )
+};
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Start recording a pass over a layer.
+\param profiler The profiler, or NULL
+\param phase The phase of the pass
+\param nLayer The index of the layer
+\param multiplyAdds The number of multiply-adds of the pass
+*/
+/*----------------------------------------------------------------------------*/
+Profiler::Section::Section( Profiler *profiler, Phase phase, int nLayer, long multiplyAdds ) :
+   m_Profiler( profiler ),
+   m_Phase( phase ),
+   m_nLayer( nLayer ),
+   m_MultiplyAdds( multiplyAdds )
+{
+   if( m_Profiler )
+   {
+      m_Profiler->begin();
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Finish recording the pass.
+*/
+/*----------------------------------------------------------------------------*/
+Profiler::Section::~Section()
+{
+   if( m_Profiler )
+   {
+      m_Profiler->end( m_Phase, m_nLayer, m_MultiplyAdds );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor. Opens the counters for the calling thread as a single group, so
+they are always scheduled together. Counters the CPU doesn't support are
+left out.
+*/
+/*----------------------------------------------------------------------------*/
+Profiler::Profiler() :
+   m_Leader( -1 ),
+   m_nOpen( 0 )
+{
+   for( int c = 0; c < NUM_COUNTERS; c++ )
+   {
+      struct perf_event_attr attr;
+      memset( &attr, 0, sizeof( attr ) );
+      attr.size = sizeof( attr );
+      attr.type = s_Types[c];
+      attr.config = s_Configs[c];
+      attr.disabled = m_Leader < 0;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+      m_Fds[c] = syscall( SYS_perf_event_open, &attr, 0, -1, m_Leader, 0 );
+      m_Slots[c] = -1;
+      if( m_Fds[c] < 0 )
+      {
+         if( m_Error.empty() )
+         {
+            m_Error = strerror( errno );
+         }
+         continue;
+      }
+
+      if( m_Leader < 0 )
+      {
+         m_Leader = m_Fds[c];
+      }
+      m_Slots[c] = m_nOpen++;
+   }
+
+   if( m_Leader >= 0 )
+   {
+      ioctl( m_Leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP );
+      ioctl( m_Leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Destructor
+*/
+/*----------------------------------------------------------------------------*/
+Profiler::~Profiler()
+{
+   for( int c = 0; c < NUM_COUNTERS; c++ )
+   {
+      if( m_Fds[c] >= 0 )
+      {
+         close( m_Fds[c] );
+      }
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return True if any counter is available
+*/
+/*----------------------------------------------------------------------------*/
+bool Profiler::available() const
+{
+   return( m_nOpen > 0 );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param counter A counter
+\return True if the counter is available
+*/
+/*----------------------------------------------------------------------------*/
+bool Profiler::available( Counter counter ) const
+{
+   return( m_Slots[counter] >= 0 );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The reason why the first unavailable counter couldn't be opened, or
+an empty string if all counters are available
+*/
+/*----------------------------------------------------------------------------*/
+const std::string &Profiler::error() const
+{
+   return( m_Error );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Start recording a pass. The time is taken after reading the counters, and at
+the end before reading them, so the time doesn't include the system calls.
+*/
+/*----------------------------------------------------------------------------*/
+void Profiler::begin()
+{
+   read( m_Start );
+   m_StartTime = std::chrono::steady_clock::now();
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Finish recording a pass and add it to the statistics of its phase and layer.
+\param phase The phase of the pass
+\param nLayer The index of the layer
+\param multiplyAdds The number of multiply-adds of the pass
+*/
+/*----------------------------------------------------------------------------*/
+void Profiler::end( Phase phase, int nLayer, long multiplyAdds )
+{
+   std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now();
+   uint64_t values[NUM_COUNTERS];
+   bool counted = read( values );
+
+   std::vector<Stats> &stats = m_Stats[phase];
+   if( stats.size() <= nLayer )
+   {
+      Stats empty;
+      memset( &empty, 0, sizeof( empty ) );
+      stats.resize( nLayer + 1, empty );
+   }
+
+   Stats &s = stats[nLayer];
+   s.calls++;
+   s.seconds += std::chrono::duration<double>( endTime - m_StartTime ).count();
+   s.multiplyAdds += multiplyAdds;
+   for( int c = 0; counted && c < NUM_COUNTERS; c++ )
+   {
+      s.counts[c] += (double)( values[c] - m_Start[c] );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Clear the statistics of all phases and layers.
+*/
+/*----------------------------------------------------------------------------*/
+void Profiler::reset()
+{
+   for( int p = 0; p < NUM_PHASES; p++ )
+   {
+      m_Stats[p].clear();
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Print a table of the recorded passes by layer and phase: the time, the
+throughput in GFLOP/s and in percent of the peak, the instructions per
+cycle and the misses per 1000 instructions. A pass is classified as compute
+bound if it achieves at least half of the peak, as memory bound if it misses
+the last level cache or the data TLB at least once per 1000 instructions,
+and as overhead bound otherwise, i.e. the pass is too small to keep the
+kernel busy.
+\param nn The profiled network
+\param peakGflops The peak throughput of the layer kernel, see measurePeak(),
+or 0 if it is unknown
+*/
+/*----------------------------------------------------------------------------*/
+void Profiler::print( const NeuralNetwork &nn, double peakGflops ) const
+{
+   printf( "%5s %-14s %-8s %8s %9s %8s %6s %5s %8s %8s %8s  %s\n",
+      "layer", "type", "phase", "calls", "ms", "GFLOP/s", "%peak", "IPC", "L1 MPKI", "LLC MPKI", "TLB MPKI", "bound" );
+
+   for( int l = 1; l < nn.numLayers(); l++ )
+   {
+      for( int p = 0; p < NUM_PHASES; p++ )
+      {
+         if( l >= m_Stats[p].size() || m_Stats[p][l].calls == 0 )
+         {
+            continue;
+         }
+
+         const Stats &s = m_Stats[p][l];
+         double gflops = s.seconds > 0.0 ? 2.0 * s.multiplyAdds / s.seconds * 1e-9 : 0.0;
+         double instructions = s.counts[COUNTER_INSTRUCTIONS];
+         char columns[4][16];
+         const int misses[3] = { COUNTER_L1D_MISSES, COUNTER_LLC_MISSES, COUNTER_DTLB_MISSES };
+
+         if( available( COUNTER_CYCLES ) && available( COUNTER_INSTRUCTIONS ) && s.counts[COUNTER_CYCLES] > 0.0 )
+         {
+            snprintf( columns[0], sizeof( columns[0] ), "%5.2f", instructions / s.counts[COUNTER_CYCLES] );
+         } else
+         {
+            snprintf( columns[0], sizeof( columns[0] ), "%5s", "-" );
+         }
+
+         bool memoryBound = false;
+         for( int m = 0; m < 3; m++ )
+         {
+            if( available( COUNTER_INSTRUCTIONS ) && available( (Counter)misses[m] ) && instructions > 0.0 )
+            {
+               double mpki = s.counts[misses[m]] / instructions * 1000.0;
+               snprintf( columns[m + 1], sizeof( columns[m + 1] ), "%8.2f", mpki );
+               memoryBound |= misses[m] != COUNTER_L1D_MISSES && mpki >= PROFILER_MEMORY_BOUND_MPKI;
+            } else
+            {
+               snprintf( columns[m + 1], sizeof( columns[m + 1] ), "%8s", "-" );
+            }
+         }
+
+         // Without a measured peak, the share of it is unknown
+         char share[16];
+         if( peakGflops > 0.0 )
+         {
+            snprintf( share, sizeof( share ), "%6.1f", gflops / peakGflops * 100.0 );
+         } else
+         {
+            snprintf( share, sizeof( share ), "%6s", "n/a" );
+         }
+
+         const char *bound = "-";
+         if( peakGflops > 0.0 && gflops >= PROFILER_COMPUTE_BOUND * peakGflops )
+         {
+            bound = "compute";
+         } else
+         if( memoryBound )
+         {
+            bound = "memory";
+         } else
+         if( available( COUNTER_LLC_MISSES ) || available( COUNTER_DTLB_MISSES ) )
+         {
+            bound = "overhead";
+         }
+
+         printf( "%5d %-14s %-8s %8ld %9.2f %8.2f %s %s %s %s %s  %s\n",
+            l, nn.layer( l ).toString().c_str(), phaseName( (Phase)p ), s.calls, s.seconds * 1e3,
+            gflops, share, columns[0], columns[1], columns[2], columns[3], bound );
+      }
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Measure the peak throughput of the layer kernel on a single thread: the best
+throughput for a batch of samples with square layers whose weights fit into
+the L1 or L2 cache.
+\return The peak in GFLOP/s
+*/
+/*----------------------------------------------------------------------------*/
+double Profiler::measurePeak()
+{
+   const int nSamples = 32;
+   double peak = 0.0;
+   Random rng( 0, 0 );
+
+   for( int width = 64; width <= 256; width *= 2 )
+   {
+      WeightMatrix w( width, width );
+      for( int r = 0; r < width; r++ )
+      {
+         for( int c = 0; c < width; c++ )
+         {
+            w.row( r )[c] = rng.uniform( -0.1, 0.1 );
+         }
+      }
+
+      std::vector<double> in( width * nSamples );
+      std::vector<double> out( width * nSamples );
+      for( size_t i = 0; i < in.size(); i++ )
+      {
+         in[i] = rng.uniform();
+      }
+
+      // Warm up
+      kernel::weightedSums( w, in.data(), nSamples, out.data(), 0, width );
+
+      long n = 0;
+      double elapsed = 0.0;
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      while( elapsed < PROFILER_PEAK_S )
+      {
+         kernel::weightedSums( w, in.data(), nSamples, out.data(), 0, width );
+         n++;
+         elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+      }
+
+      peak = std::max( peak, 2.0 * width * width * nSamples * n / elapsed * 1e-9 );
+   }
+
+   return( peak );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param phase A phase
+\return The name of the phase
+*/
+/*----------------------------------------------------------------------------*/
+const char *Profiler::phaseName( Phase phase )
+{
+   switch( phase )
+   {
+      case PHASE_FORWARD:
+         return( "forward" );
+      case PHASE_BACKWARD:
+         return( "backward" );
+      case PHASE_ADJUST:
+         return( "adjust" );
+      default:
+         return( "unknown" );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Read the counters. If the counters had to share the hardware with other
+groups, their values are extrapolated to the whole time they were enabled.
+\param values Receives the values of the counters, 0 for counters which are
+not available
+\return False if no counter is available or the counters couldn't be read
+*/
+/*----------------------------------------------------------------------------*/
+bool Profiler::read( uint64_t *values ) const
+{
+   if( m_Leader < 0 )
+   {
+      return( false );
+   }
+
+   // The number of counters, the time enabled, the time running and the values
+   uint64_t buffer[3 + NUM_COUNTERS];
+   ssize_t size = ( 3 + m_nOpen ) * sizeof( uint64_t );
+   if( ::read( m_Leader, buffer, sizeof( buffer ) ) < size )
+   {
+      return( false );
+   }
+
+   double scale = buffer[2] > 0 ? (double)buffer[1] / buffer[2] : 0.0;
+   for( int c = 0; c < NUM_COUNTERS; c++ )
+   {
+      values[c] = m_Slots[c] >= 0 ? (uint64_t)( buffer[3 + m_Slots[c]] * scale ) : 0;
+   }
+
+   return( true );
+}
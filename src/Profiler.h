@@ -0,0 +1,138 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+/*----------------------------------------------------------------------------*/
+/*!
+\file Profiler.h
+\author Christian Nowak <chnowak@web.de>
+\brief Header for the class Profiler, which collects hardware performance
+counters for the forward pass, the backward pass and the adjustment of the
+weights of each layer of a network.
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <stdint.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+class NeuralNetwork;
+
+/*----------------------------------------------------------------------------*/
+/*!
+\class Profiler
+\date  2026-10-18
+
+Counts cycles, instructions, L1 data cache misses, last level cache misses
+and data TLB misses with the Linux perf_event_open() interface around each
+pass over a layer (see NeuralNetwork::setProfiler()). The counters belong to
+the thread that creates the profiler and only count in user space, so the
+layer kernels have to run on that thread, with kernel::Config::maxThreads
+set to 1.
+
+If the counters are not available, e.g. in a virtual machine or because of
+/proc/sys/kernel/perf_event_paranoid, only the time and the throughput of
+each pass are recorded.
+*/
+/*----------------------------------------------------------------------------*/
+class Profiler
+{
+public:
+   typedef enum
+   {
+      PHASE_FORWARD,
+      PHASE_BACKWARD,
+      PHASE_ADJUST,
+      NUM_PHASES
+   } Phase;
+
+   typedef enum
+   {
+      COUNTER_CYCLES,
+      COUNTER_INSTRUCTIONS,
+      COUNTER_L1D_MISSES,
+      COUNTER_LLC_MISSES,
+      COUNTER_DTLB_MISSES,
+      NUM_COUNTERS
+   } Counter;
+
+   /*----------------------------------------------------------------------------*/
+   /*!
+   \class Section
+   \date  2026-10-18
+   Records the pass over a layer from its construction to its destruction.
+   Does nothing without a profiler.
+   */
+   /*----------------------------------------------------------------------------*/
+   class Section
+   {
+   public:
+      Section( Profiler *profiler, Phase phase, int nLayer, long multiplyAdds );
+      ~Section();
+
+   private:
+      Profiler *m_Profiler;
+      Phase m_Phase;
+      int m_nLayer;
+      long m_MultiplyAdds;
+   };
+
+public:
+   Profiler();
+   ~Profiler();
+
+   bool available() const;
+   bool available( Counter counter ) const;
+   const std::string &error() const;
+   void begin();
+   void end( Phase phase, int nLayer, long multiplyAdds );
+   void reset();
+   void print( const NeuralNetwork &nn, double peakGflops ) const;
+
+   static double measurePeak();
+   static const char *phaseName( Phase phase );
+
+private:
+   bool read( uint64_t *values ) const;
+
+private:
+   struct Stats
+   {
+      long calls;
+      double seconds;
+      double multiplyAdds;
+      double counts[NUM_COUNTERS];
+   };
+
+   // The file descriptors of the counters, or -1 for counters which are not
+   // available. The counters are read as a group through the leader, in
+   // which a counter's value is at its slot.
+   int m_Fds[NUM_COUNTERS];
+   int m_Slots[NUM_COUNTERS];
+   int m_Leader;
+   int m_nOpen;
+   std::string m_Error;
+
+   uint64_t m_Start[NUM_COUNTERS];
+   std::chrono::steady_clock::time_point m_StartTime;
+   std::vector<Stats> m_Stats[NUM_PHASES];
+};
+
+#endif
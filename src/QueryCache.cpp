@@ -0,0 +1,334 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file QueryCache.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Implementation of the class QueryCache, a sharded LRU cache of the
+output vectors of a network.
+*/
+/*----------------------------------------------------------------------------*/
+#include <string.h>
+
+#include "QueryCache.h"
+#include "util.h"
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor
+\param maxBytes The maximum amount of memory used by the entries
+\param nShards The number of shards
+*/
+/*----------------------------------------------------------------------------*/
+QueryCache::QueryCache( size_t maxBytes, int nShards )
+{
+   if( nShards < 1 )
+   {
+      nShards = 1;
+   }
+
+   for( int i = 0; i < nShards; i++ )
+   {
+      std::unique_ptr<Shard> s( new Shard );
+      s->bytes = 0;
+      s->version = 0;
+      s->nHits = 0;
+      s->nMisses = 0;
+      s->nEvictions = 0;
+      s->nInvalidations = 0;
+      m_Shards.push_back( std::move( s ) );
+   }
+
+   m_MaxShardBytes = maxBytes / nShards;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Destructor
+*/
+/*----------------------------------------------------------------------------*/
+QueryCache::~QueryCache()
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param nInputs The length of the input vector
+\param nOutputs The length of the output vector
+\return The approximate amount of memory used by an entry, including the
+list node and the index
+*/
+/*----------------------------------------------------------------------------*/
+size_t QueryCache::entryBytes( int nInputs, int nOutputs )
+{
+   return( sizeof( Entry ) + ( nInputs + nOutputs ) * sizeof( double ) + 64 );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param hash The hash of an input vector
+\return The shard holding the input vector
+*/
+/*----------------------------------------------------------------------------*/
+QueryCache::Shard &QueryCache::shard( uint64_t hash )
+{
+   // The low bits select the bucket of the index within the shard
+   return( *m_Shards[( hash >> 48 ) % m_Shards.size()] );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Drop all entries of a shard if they belong to another version of the
+weights. The shard's mutex must be held.
+\param s The shard
+\param version The current version of the weights
+*/
+/*----------------------------------------------------------------------------*/
+void QueryCache::invalidate( Shard &s, uint64_t version )
+{
+   if( s.version != version )
+   {
+      s.nInvalidations += s.lru.size();
+      s.lru.clear();
+      s.index.clear();
+      s.bytes = 0;
+      s.version = version;
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Look up the output vector of an input vector.
+\param input The input vector
+\param nInputs The length of the input vector
+\param version The version of the weights of the network
+\param output Receives the output vector on a hit
+\param nOutputs The length of the output vector
+\return true on a hit, false on a miss
+*/
+/*----------------------------------------------------------------------------*/
+bool QueryCache::lookup( const double *input, int nInputs, uint64_t version, double *output, int nOutputs )
+{
+   uint64_t hash = util::xxHash64( input, nInputs * sizeof( double ), 0 );
+   Shard &s = shard( hash );
+   std::lock_guard<std::mutex> lock( s.mutex );
+
+   invalidate( s, version );
+
+   auto it = s.index.find( hash );
+   if( it == s.index.end() ||
+       it->second->input.size() != nInputs || it->second->output.size() != nOutputs ||
+       memcmp( it->second->input.data(), input, nInputs * sizeof( double ) ) != 0 )
+   {
+      s.nMisses++;
+      return( false );
+   }
+
+   // Move the entry to the front of the LRU list
+   s.lru.splice( s.lru.begin(), s.lru, it->second );
+   memcpy( output, it->second->output.data(), nOutputs * sizeof( double ) );
+   s.nHits++;
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Store the output vector of an input vector, evicting the least recently used
+entries of its shard as necessary. An entry with the same hash is replaced.
+\param input The input vector
+\param nInputs The length of the input vector
+\param version The version of the weights of the network
+\param output The output vector
+\param nOutputs The length of the output vector
+*/
+/*----------------------------------------------------------------------------*/
+void QueryCache::insert( const double *input, int nInputs, uint64_t version, const double *output, int nOutputs )
+{
+   size_t bytes = entryBytes( nInputs, nOutputs );
+   if( bytes > m_MaxShardBytes )
+   {
+      return;
+   }
+
+   uint64_t hash = util::xxHash64( input, nInputs * sizeof( double ), 0 );
+   Shard &s = shard( hash );
+   std::lock_guard<std::mutex> lock( s.mutex );
+
+   invalidate( s, version );
+
+   auto it = s.index.find( hash );
+   if( it != s.index.end() )
+   {
+      s.bytes -= entryBytes( it->second->input.size(), it->second->output.size() );
+      s.lru.erase( it->second );
+      s.index.erase( it );
+   }
+
+   while( s.bytes + bytes > m_MaxShardBytes && s.lru.size() > 0 )
+   {
+      const Entry &e = s.lru.back();
+      s.bytes -= entryBytes( e.input.size(), e.output.size() );
+      s.index.erase( e.hash );
+      s.lru.pop_back();
+      s.nEvictions++;
+   }
+
+   Entry e;
+   e.hash = hash;
+   e.input.assign( input, input + nInputs );
+   e.output.assign( output, output + nOutputs );
+   s.lru.push_front( std::move( e ) );
+   s.index[hash] = s.lru.begin();
+   s.bytes += bytes;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Drop all entries
+*/
+/*----------------------------------------------------------------------------*/
+void QueryCache::clear()
+{
+   for( int i = 0; i < m_Shards.size(); i++ )
+   {
+      Shard &s = *m_Shards[i];
+      std::lock_guard<std::mutex> lock( s.mutex );
+      s.lru.clear();
+      s.index.clear();
+      s.bytes = 0;
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of lookups which found their input vector
+*/
+/*----------------------------------------------------------------------------*/
+long QueryCache::numHits() const
+{
+   long n = 0;
+   for( int i = 0; i < m_Shards.size(); i++ )
+   {
+      std::lock_guard<std::mutex> lock( m_Shards[i]->mutex );
+      n += m_Shards[i]->nHits;
+   }
+
+   return( n );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of lookups which didn't find their input vector
+*/
+/*----------------------------------------------------------------------------*/
+long QueryCache::numMisses() const
+{
+   long n = 0;
+   for( int i = 0; i < m_Shards.size(); i++ )
+   {
+      std::lock_guard<std::mutex> lock( m_Shards[i]->mutex );
+      n += m_Shards[i]->nMisses;
+   }
+
+   return( n );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of entries evicted to make room for new ones
+*/
+/*----------------------------------------------------------------------------*/
+long QueryCache::numEvictions() const
+{
+   long n = 0;
+   for( int i = 0; i < m_Shards.size(); i++ )
+   {
+      std::lock_guard<std::mutex> lock( m_Shards[i]->mutex );
+      n += m_Shards[i]->nEvictions;
+   }
+
+   return( n );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of entries dropped because the weights have changed
+*/
+/*----------------------------------------------------------------------------*/
+long QueryCache::numInvalidations() const
+{
+   long n = 0;
+   for( int i = 0; i < m_Shards.size(); i++ )
+   {
+      std::lock_guard<std::mutex> lock( m_Shards[i]->mutex );
+      n += m_Shards[i]->nInvalidations;
+   }
+
+   return( n );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of entries
+*/
+/*----------------------------------------------------------------------------*/
+size_t QueryCache::numEntries() const
+{
+   size_t n = 0;
+   for( int i = 0; i < m_Shards.size(); i++ )
+   {
+      std::lock_guard<std::mutex> lock( m_Shards[i]->mutex );
+      n += m_Shards[i]->lru.size();
+   }
+
+   return( n );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The approximate amount of memory used by the entries
+*/
+/*----------------------------------------------------------------------------*/
+size_t QueryCache::numBytes() const
+{
+   size_t n = 0;
+   for( int i = 0; i < m_Shards.size(); i++ )
+   {
+      std::lock_guard<std::mutex> lock( m_Shards[i]->mutex );
+      n += m_Shards[i]->bytes;
+   }
+
+   return( n );
+}
@@ -0,0 +1,105 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file QueryCache.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for class QueryCache
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __QUERYCACHE_H__
+#define __QUERYCACHE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/*----------------------------------------------------------------------------*/
+/*!
+\class QueryCache
+\date  2026-10-18
+
+Remembers the output vectors of a network for recently queried input
+vectors. The input vectors are addressed by their xxHash64 and compared in
+full, so a hash collision can't return a wrong output vector.
+
+The cache is split into shards, each with its own mutex and its own least
+recently used list, so several threads can use it at the same time. Each
+shard holds at most its share of the memory limit; when it's full, the least
+recently used entries are evicted.
+
+Each entry is tagged with the version of the weights of the network (see
+NeuralNetwork::weightsVersion()). When a shard sees a different version,
+all of its entries are dropped.
+*/
+/*----------------------------------------------------------------------------*/
+class QueryCache
+{
+public:
+   QueryCache( size_t maxBytes, int nShards );
+   ~QueryCache();
+
+   bool lookup( const double *input, int nInputs, uint64_t version, double *output, int nOutputs );
+   void insert( const double *input, int nInputs, uint64_t version, const double *output, int nOutputs );
+   void clear();
+
+   long numHits() const;
+   long numMisses() const;
+   long numEvictions() const;
+   long numInvalidations() const;
+   size_t numEntries() const;
+   size_t numBytes() const;
+
+private:
+   struct Entry
+   {
+      uint64_t hash;
+      std::vector<double> input;
+      std::vector<double> output;
+   };
+
+   struct Shard
+   {
+      std::mutex mutex;
+      std::list<Entry> lru;
+      std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+      size_t bytes;
+      uint64_t version;
+      long nHits;
+      long nMisses;
+      long nEvictions;
+      long nInvalidations;
+   };
+
+   Shard &shard( uint64_t hash );
+   void invalidate( Shard &s, uint64_t version );
+   static size_t entryBytes( int nInputs, int nOutputs );
+
+private:
+   std::vector<std::unique_ptr<Shard> > m_Shards;
+   size_t m_MaxShardBytes;
+};
+
+#endif
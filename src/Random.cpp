@@ -0,0 +1,254 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file Random.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Implementation of the class Random, a counter-based random number
+generator with independent streams.
+*/
+/*----------------------------------------------------------------------------*/
+#include <atomic>
+
+#include "Random.h"
+
+// Philox4x32 multipliers and Weyl sequence constants for the key schedule
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+static std::atomic<uint64_t> s_Seed( 0 );
+
+// Streams handed out to threads by threadLocal(). They are counted from the
+// top so that they don't collide with the small stream numbers used for
+// explicitly partitioned work.
+static std::atomic<uint64_t> s_nextThreadStream( 0 );
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor
+\param seed The seed, usually Random::seed()
+\param stream The number of the stream. Generators with the same seed and
+different streams yield independent sequences.
+*/
+/*----------------------------------------------------------------------------*/
+Random::Random( uint64_t seed, uint64_t stream ) :
+   m_Stream( stream ),
+   m_Counter( 0 ),
+   m_nUsed( 4 )
+{
+   m_Key[0] = (uint32_t)seed;
+   m_Key[1] = (uint32_t)( seed >> 32 );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Destructor
+*/
+/*----------------------------------------------------------------------------*/
+Random::~Random()
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Set the global seed which all generators derived with seed() or
+threadLocal() are based on. Call this before any random values are drawn.
+\param seed The seed
+*/
+/*----------------------------------------------------------------------------*/
+void Random::setSeed( uint64_t seed )
+{
+   s_Seed = seed;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The global seed
+*/
+/*----------------------------------------------------------------------------*/
+uint64_t Random::seed()
+{
+   return( s_Seed );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The generator of the calling thread. Each thread gets its own stream
+based on the global seed, numbered in the order in which the threads first
+call this function.
+*/
+/*----------------------------------------------------------------------------*/
+Random &Random::threadLocal()
+{
+   thread_local Random rng( s_Seed, threadStream( s_nextThreadStream++ ) );
+   return( rng );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param nThread The index of a thread in the order in which the threads first
+call threadLocal(), 0 for the main thread of a training run
+\return The number of the stream threadLocal() gives that thread
+*/
+/*----------------------------------------------------------------------------*/
+uint64_t Random::threadStream( uint64_t nThread )
+{
+   return( ~nThread );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Compute the next block of four random values by running the 128 bit counter,
+made up of the stream number and the block counter, through ten Philox
+rounds keyed with the seed.
+*/
+/*----------------------------------------------------------------------------*/
+void Random::generate()
+{
+   uint32_t c[4] = { (uint32_t)m_Counter, (uint32_t)( m_Counter >> 32 ),
+                     (uint32_t)m_Stream, (uint32_t)( m_Stream >> 32 ) };
+   uint32_t k[2] = { m_Key[0], m_Key[1] };
+
+   for( int i = 0; i < PHILOX_ROUNDS; i++ )
+   {
+      uint64_t p0 = (uint64_t)PHILOX_M0 * c[0];
+      uint64_t p1 = (uint64_t)PHILOX_M1 * c[2];
+
+      uint32_t r[4] = { (uint32_t)( p1 >> 32 ) ^ c[1] ^ k[0], (uint32_t)p1,
+                        (uint32_t)( p0 >> 32 ) ^ c[3] ^ k[1], (uint32_t)p0 };
+      c[0] = r[0];
+      c[1] = r[1];
+      c[2] = r[2];
+      c[3] = r[3];
+
+      k[0] += PHILOX_W0;
+      k[1] += PHILOX_W1;
+   }
+
+   m_Block[0] = c[0];
+   m_Block[1] = c[1];
+   m_Block[2] = c[2];
+   m_Block[3] = c[3];
+   m_nUsed = 0;
+   m_Counter++;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The next 32 bit random value of the stream
+*/
+/*----------------------------------------------------------------------------*/
+uint32_t Random::next()
+{
+   if( m_nUsed >= 4 )
+   {
+      generate();
+   }
+
+   return( m_Block[m_nUsed++] );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The next 64 bit random value of the stream
+*/
+/*----------------------------------------------------------------------------*/
+uint64_t Random::next64()
+{
+   uint64_t lo = next();
+   uint64_t hi = next();
+
+   return( ( hi << 32 ) | lo );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return A random value ranging from 0.0 (inclusive) to 1.0 (exclusive) with
+the full 53 bits of precision of a double
+*/
+/*----------------------------------------------------------------------------*/
+double Random::uniform()
+{
+   return( (double)( next64() >> 11 ) * ( 1.0 / 9007199254740992.0 ) );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param min The lower limit
+\param max The upper limit
+\return A random value ranging from min to max
+*/
+/*----------------------------------------------------------------------------*/
+double Random::uniform( double min, double max )
+{
+   return( ( uniform() * ( max - min ) ) + min );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param n The upper limit, must be greater than 0
+\return An unbiased random integer ranging from 0 to n - 1
+*/
+/*----------------------------------------------------------------------------*/
+uint32_t Random::below( uint32_t n )
+{
+   // Reject values from the incomplete last interval of size n
+   uint32_t limit = (uint32_t)( -n ) % n;
+   uint32_t v;
+   do
+   {
+      v = next();
+   } while( v < limit );
+
+   return( v % n );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Bring the elements of a vector into random order (Fisher-Yates shuffle).
+\param v The vector to be shuffled
+*/
+/*----------------------------------------------------------------------------*/
+void Random::shuffle( std::vector<int> &v )
+{
+   for( int i = (int)v.size() - 1; i > 0; i-- )
+   {
+      int j = below( i + 1 );
+      int tmp = v[i];
+      v[i] = v[j];
+      v[j] = tmp;
+   }
+}
@@ -0,0 +1,84 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file Random.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for class Random
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __RANDOM_H__
+#define __RANDOM_H__
+
+#include <stdint.h>
+
+#include <vector>
+
+// The random stream of the shuffling of the training samples in epoch 0.
+// Epoch n uses stream RANDOM_SHUFFLE_STREAM + n.
+#define RANDOM_SHUFFLE_STREAM ( 1ull << 48 )
+
+// The random stream of the choice of samples to backpropagate (see
+// BackpropSelector)
+#define RANDOM_SELECT_STREAM ( 2ull << 48 )
+
+/*----------------------------------------------------------------------------*/
+/*!
+\class Random
+\date  2026-10-18
+
+A counter-based pseudo random number generator (Philox4x32-10). Each random
+value is a pure function of a seed, a stream number and the position within
+that stream, so any number of independent streams can be derived from a
+single seed without any shared state. Work which is split across threads
+yields the same random values as long as each piece of work uses its own
+stream, no matter how many threads there are.
+*/
+/*----------------------------------------------------------------------------*/
+class Random
+{
+public:
+   Random( uint64_t seed, uint64_t stream );
+   ~Random();
+
+   uint32_t next();
+   uint64_t next64();
+   double uniform();
+   double uniform( double min, double max );
+   uint32_t below( uint32_t n );
+   void shuffle( std::vector<int> &v );
+
+   static void setSeed( uint64_t seed );
+   static uint64_t seed();
+   static Random &threadLocal();
+   static uint64_t threadStream( uint64_t nThread );
+
+private:
+   void generate();
+
+private:
+   uint32_t m_Key[2];
+   uint64_t m_Stream;
+   uint64_t m_Counter;
+   uint32_t m_Block[4];
+   int m_nUsed;
+};
+
+#endif
@@ -0,0 +1,604 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file Server.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Implementation of the class Server, a long-running inference server
+with dynamic request batching.
+*/
+/*----------------------------------------------------------------------------*/
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Server.h"
+#include "util.h"
+
+// Requests larger than this are considered garbage and the connection is closed
+#define MAX_REQUEST_BYTES ( 64 * 1024 * 1024 )
+
+// The readers stop reading requests while this many full batches are queued,
+// so a client which sends requests without reading the responses can't grow
+// the queue, and the delay of the requests behind it, without bound
+#define MAX_QUEUED_BATCHES 16
+
+// Interval between two statistics reports while serving
+#define REPORT_INTERVAL_S 10
+
+volatile sig_atomic_t Server::s_Terminate = 0;
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor
+\param fd The file descriptor which responses are written to
+\param ownsFd If true, the file descriptor is closed along with the connection
+*/
+/*----------------------------------------------------------------------------*/
+Server::Connection::Connection( int fd, bool ownsFd ) :
+   fd( fd ),
+   ownsFd( ownsFd )
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Destructor. This is invoked once the connection has been closed by the client
+and all its pending requests have been answered.
+*/
+/*----------------------------------------------------------------------------*/
+Server::Connection::~Connection()
+{
+   if( ownsFd )
+   {
+      close( fd );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor
+\param nn The network to be served. It must not be trained while the server
+is running.
+\param maxBatchSize The maximum number of requests to be run as one batch
+\param batchWindowUs The maximum time in microseconds a request waits for
+other requests to join its batch. With 0, all requests which are queued when
+the batcher becomes idle are batched, but the batcher never waits for more.
+*/
+/*----------------------------------------------------------------------------*/
+Server::Server( const NeuralNetwork &nn, int maxBatchSize, int batchWindowUs ) :
+   m_NeuralNetwork( &nn ),
+   m_Store( NULL ),
+   m_MaxBatchSize( maxBatchSize < 1 ? 1 : maxBatchSize ),
+   m_BatchWindow( batchWindowUs < 0 ? 0 : batchWindowUs ),
+   m_Stop( false ),
+   m_nRequests( 0 ),
+   m_nBatches( 0 ),
+   m_nIntervalRequests( 0 ),
+   m_nIntervalBatches( 0 )
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor
+\param store The store of the network to be served. The network may be
+trained and published while the server is running.
+\param maxBatchSize The maximum number of requests to be run as one batch
+\param batchWindowUs The maximum time in microseconds a request waits for
+other requests to join its batch
+*/
+/*----------------------------------------------------------------------------*/
+Server::Server( ModelStore &store, int maxBatchSize, int batchWindowUs ) :
+   m_NeuralNetwork( NULL ),
+   m_Store( &store ),
+   m_MaxBatchSize( maxBatchSize < 1 ? 1 : maxBatchSize ),
+   m_BatchWindow( batchWindowUs < 0 ? 0 : batchWindowUs ),
+   m_Stop( false ),
+   m_nRequests( 0 ),
+   m_nBatches( 0 ),
+   m_nIntervalRequests( 0 ),
+   m_nIntervalBatches( 0 )
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Destructor
+*/
+/*----------------------------------------------------------------------------*/
+Server::~Server()
+{
+   stopBatcher();
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Signal handler for SIGINT and SIGTERM. Makes serveSocket() shut down
+gracefully.
+*/
+/*----------------------------------------------------------------------------*/
+void Server::handleSignal( int )
+{
+   s_Terminate = 1;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Read exactly n bytes from a file descriptor.
+\return true on success, false on error or end of file
+*/
+/*----------------------------------------------------------------------------*/
+bool Server::readFully( int fd, void *buf, size_t n )
+{
+   char *p = (char *)buf;
+   while( n > 0 )
+   {
+      ssize_t r = read( fd, p, n );
+      if( r < 0 && errno == EINTR )
+      {
+         continue;
+      }
+      if( r <= 0 )
+      {
+         return( false );
+      }
+      p += r;
+      n -= r;
+   }
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Write exactly n bytes to a file descriptor.
+\return true on success, false on error
+*/
+/*----------------------------------------------------------------------------*/
+bool Server::writeFully( int fd, const void *buf, size_t n )
+{
+   const char *p = (const char *)buf;
+   while( n > 0 )
+   {
+      ssize_t r = write( fd, p, n );
+      if( r < 0 && errno == EINTR )
+      {
+         continue;
+      }
+      if( r <= 0 )
+      {
+         return( false );
+      }
+      p += r;
+      n -= r;
+   }
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Serve requests from a single input stream, e.g. stdin, and write the responses
+to an output stream, e.g. stdout, in the order of the requests. Returns when
+the input stream reaches end of file and all requests have been answered.
+
+\param inFd The file descriptor to read requests from
+\param outFd The file descriptor to write responses to
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool Server::serveStream( int inFd, int outFd )
+{
+   startBatcher();
+
+   readRequests( std::make_shared<Connection>( outFd, false ), inFd );
+
+   stopBatcher();
+   printStatistics( true );
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Listen on a Unix domain socket and serve requests from any number of clients
+until SIGINT or SIGTERM is received (see handleSignal()). Each client
+connection gets its own reader thread, whereas all requests are processed by
+a single batcher thread.
+
+\param socketPath The file system path of the socket. An existing file of
+that name is removed.
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool Server::serveSocket( std::string socketPath )
+{
+   struct sockaddr_un addr;
+   memset( &addr, 0, sizeof( addr ) );
+   addr.sun_family = AF_UNIX;
+   if( socketPath.size() >= sizeof( addr.sun_path ) )
+   {
+      fprintf( stderr, "Socket path '%s' is too long.\n", socketPath.c_str() );
+      return( false );
+   }
+   strcpy( addr.sun_path, socketPath.c_str() );
+
+   int listenFd = socket( AF_UNIX, SOCK_STREAM, 0 );
+   if( listenFd < 0 )
+   {
+      perror( "socket" );
+      return( false );
+   }
+
+   unlink( socketPath.c_str() );
+   if( bind( listenFd, (struct sockaddr *)&addr, sizeof( addr ) ) < 0 ||
+       listen( listenFd, 128 ) < 0 )
+   {
+      perror( socketPath.c_str() );
+      close( listenFd );
+      return( false );
+   }
+
+   startBatcher();
+
+   struct Reader
+   {
+      std::thread thread;
+      std::shared_ptr<Connection> conn;
+      std::shared_ptr<bool> done;
+   };
+   std::vector<Reader> readers;
+   std::mutex doneMutex;
+
+   fprintf( stderr, "Listening on %s\n", socketPath.c_str() );
+   while( !s_Terminate )
+   {
+      // Wake up regularly to check whether we're supposed to terminate
+      struct pollfd pfd;
+      pfd.fd = listenFd;
+      pfd.events = POLLIN;
+      if( poll( &pfd, 1, 200 ) > 0 )
+      {
+         int fd = accept( listenFd, NULL, NULL );
+         if( fd >= 0 )
+         {
+            Reader reader;
+            reader.conn = std::make_shared<Connection>( fd, true );
+            reader.done = std::make_shared<bool>( false );
+
+            std::shared_ptr<Connection> conn = reader.conn;
+            std::shared_ptr<bool> done = reader.done;
+            reader.thread = std::thread( [this, conn, done, &doneMutex]()
+            {
+               readRequests( conn, conn->fd );
+               std::lock_guard<std::mutex> lock( doneMutex );
+               *done = true;
+            } );
+            readers.push_back( std::move( reader ) );
+         }
+      }
+
+      // Reap the reader threads of closed connections
+      std::lock_guard<std::mutex> lock( doneMutex );
+      for( int i = readers.size() - 1; i >= 0; i-- )
+      {
+         if( *readers[i].done )
+         {
+            readers[i].thread.join();
+            readers.erase( readers.begin() + i );
+         }
+      }
+   }
+
+   fprintf( stderr, "Shutting down..\n" );
+   close( listenFd );
+   unlink( socketPath.c_str() );
+
+   // Unblock all readers, then answer the remaining requests
+   for( int i = 0; i < readers.size(); i++ )
+   {
+      shutdown( readers[i].conn->fd, SHUT_RD );
+   }
+   for( int i = 0; i < readers.size(); i++ )
+   {
+      readers[i].thread.join();
+   }
+   readers.clear();
+
+   stopBatcher();
+   printStatistics( true );
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Read requests from a file descriptor and queue them for the batcher until the
+peer closes the connection or sends a malformed request. While the queue is
+full, no more requests are read, so the peer is held back by its socket
+buffer filling up, and the responses stay in the order of the requests.
+
+\param conn The connection the responses are to be sent to
+\param inFd The file descriptor to read the requests from
+*/
+/*----------------------------------------------------------------------------*/
+void Server::readRequests( std::shared_ptr<Connection> conn, int inFd )
+{
+   for( ;; )
+   {
+      uint32_t len;
+      if( !readFully( inFd, &len, sizeof( len ) ) )
+      {
+         break;
+      }
+
+      if( ( len % sizeof( double ) ) != 0 || len > MAX_REQUEST_BYTES )
+      {
+         fprintf( stderr, "Malformed request of %u bytes, closing connection.\n", len );
+         break;
+      }
+
+      Request req;
+      req.conn = conn;
+      req.input.resize( len / sizeof( double ) );
+      if( !readFully( inFd, req.input.data(), len ) )
+      {
+         break;
+      }
+      req.arrival = std::chrono::steady_clock::now();
+
+      std::unique_lock<std::mutex> lock( m_QueueMutex );
+      while( m_Queue.size() >= (size_t)m_MaxBatchSize * MAX_QUEUED_BATCHES )
+      {
+         m_SpaceCond.wait( lock );
+      }
+      m_Queue.push_back( std::move( req ) );
+      m_QueueCond.notify_one();
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Start the batcher thread
+*/
+/*----------------------------------------------------------------------------*/
+void Server::startBatcher()
+{
+   m_Stop = false;
+   m_StartTime = std::chrono::steady_clock::now();
+   m_ReportTime = m_StartTime;
+   m_Batcher = std::thread( &Server::runBatcher, this );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Stop the batcher thread after all queued requests have been processed.
+*/
+/*----------------------------------------------------------------------------*/
+void Server::stopBatcher()
+{
+   if( !m_Batcher.joinable() )
+   {
+      return;
+   }
+
+   {
+      std::lock_guard<std::mutex> lock( m_QueueMutex );
+      m_Stop = true;
+      m_QueueCond.notify_one();
+   }
+
+   m_Batcher.join();
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+The batcher thread. It waits for the first request of a batch, then waits for
+more requests until either the batch is full or the oldest request in the
+queue has waited for the batch window. Requests which queued up while the
+previous batch was being processed have usually used up their window already,
+so under load, batches are formed without any additional delay while a lone
+request waits for at most the batch window.
+*/
+/*----------------------------------------------------------------------------*/
+void Server::runBatcher()
+{
+   std::vector<Request> batch;
+
+   for( ;; )
+   {
+      {
+         std::unique_lock<std::mutex> lock( m_QueueMutex );
+         while( !m_Stop && m_Queue.empty() )
+         {
+            m_QueueCond.wait( lock );
+         }
+
+         if( m_Queue.empty() )
+         {
+            // m_Stop is set and there's nothing left to do
+            break;
+         }
+
+         std::chrono::steady_clock::time_point deadline = m_Queue.front().arrival + m_BatchWindow;
+         while( !m_Stop && m_Queue.size() < m_MaxBatchSize &&
+                std::chrono::steady_clock::now() < deadline )
+         {
+            m_QueueCond.wait_until( lock, deadline );
+         }
+
+         while( !m_Queue.empty() && batch.size() < m_MaxBatchSize )
+         {
+            batch.push_back( std::move( m_Queue.front() ) );
+            m_Queue.pop_front();
+         }
+         m_SpaceCond.notify_all();
+      }
+
+      processBatch( batch );
+      batch.clear();
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Run a batch of requests through the network and send the responses.
+\param batch The requests
+*/
+/*----------------------------------------------------------------------------*/
+void Server::processBatch( std::vector<Request> &batch )
+{
+   // The whole batch is run through the same snapshot, which is let go
+   // before the responses are sent
+   std::unique_ptr<ModelStore::Snapshot> snapshot;
+   const NeuralNetwork *nn = m_NeuralNetwork;
+   if( m_Store )
+   {
+      snapshot.reset( new ModelStore::Snapshot( *m_Store ) );
+      nn = &snapshot->network();
+   }
+
+   // Requests with an input vector of the wrong size are answered with an
+   // empty response. All other requests are run as one batch.
+   std::vector<std::vector<double> > inputs;
+   std::vector<int> index( batch.size(), -1 );
+   for( int i = 0; i < batch.size(); i++ )
+   {
+      if( batch[i].input.size() == nn->numNeurons( 0 ) )
+      {
+         index[i] = inputs.size();
+         inputs.push_back( std::move( batch[i].input ) );
+      }
+   }
+
+   std::vector<std::vector<double> > outputs;
+   if( inputs.size() > 0 && !nn->query( inputs, outputs ) )
+   {
+      outputs.clear();
+   }
+   snapshot.reset();
+
+   std::chrono::steady_clock::time_point now;
+   std::vector<double> latencies;
+   std::vector<char> frame;
+   for( int i = 0; i < batch.size(); i++ )
+   {
+      uint32_t len = 0;
+      const double *payload = NULL;
+      if( index[i] >= 0 && index[i] < outputs.size() )
+      {
+         len = outputs[index[i]].size() * sizeof( double );
+         payload = outputs[index[i]].data();
+      }
+
+      frame.resize( sizeof( len ) + len );
+      memcpy( frame.data(), &len, sizeof( len ) );
+      if( len > 0 )
+      {
+         memcpy( frame.data() + sizeof( len ), payload, len );
+      }
+
+      Connection *conn = batch[i].conn.get();
+      {
+         // A failing write means that the client has gone away, which is
+         // detected by the connection's reader.
+         std::lock_guard<std::mutex> lock( conn->writeMutex );
+         writeFully( conn->fd, frame.data(), frame.size() );
+      }
+
+      now = std::chrono::steady_clock::now();
+      latencies.push_back( std::chrono::duration<double, std::micro>( now - batch[i].arrival ).count() );
+   }
+
+   bool report;
+   {
+      std::lock_guard<std::mutex> lock( m_StatsMutex );
+      m_Latencies.insert( m_Latencies.end(), latencies.begin(), latencies.end() );
+      m_nIntervalRequests += batch.size();
+      m_nIntervalBatches++;
+      report = now - m_ReportTime >= std::chrono::seconds( REPORT_INTERVAL_S );
+   }
+
+   if( report )
+   {
+      printStatistics( false );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Print the request latency and throughput since the last report to stderr.
+\param final If true, also print the totals since the server was started
+*/
+/*----------------------------------------------------------------------------*/
+void Server::printStatistics( bool final )
+{
+   std::lock_guard<std::mutex> lock( m_StatsMutex );
+
+   std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+   double interval = std::chrono::duration<double>( now - m_ReportTime ).count();
+
+   if( m_nIntervalRequests > 0 )
+   {
+      fprintf( stderr, "%ld requests in %ld batches (avg. batch size %0.1f), %0.0f requests/s, "
+                       "latency p50 = %0.0f us, p99 = %0.0f us\n",
+         m_nIntervalRequests, m_nIntervalBatches,
+         (double)m_nIntervalRequests / (double)m_nIntervalBatches,
+         m_nIntervalRequests / interval,
+         util::percentile( m_Latencies, 50.0 ),
+         util::percentile( m_Latencies, 99.0 ) );
+   }
+
+   m_nRequests += m_nIntervalRequests;
+   m_nBatches += m_nIntervalBatches;
+   m_nIntervalRequests = 0;
+   m_nIntervalBatches = 0;
+   m_Latencies.clear();
+   m_ReportTime = now;
+
+   if( final )
+   {
+      double total = std::chrono::duration<double>( now - m_StartTime ).count();
+      fprintf( stderr, "Total: %ld requests in %ld batches in %0.1f s, %0.0f requests/s\n",
+         m_nRequests, m_nBatches, total, total > 0.0 ? m_nRequests / total : 0.0 );
+   }
+}
@@ -0,0 +1,129 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file Server.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for class Server
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+#include <signal.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ModelStore.h"
+#include "NeuralNetwork.h"
+
+/*----------------------------------------------------------------------------*/
+/*!
+\class Server
+\date  2026-10-18
+
+Serves classification requests for a trained NeuralNetwork, either over a Unix
+domain socket or over stdin/stdout.
+
+Requests and responses share the same length-prefixed binary format: a 32 bit
+unsigned integer holding the payload length in bytes, followed by the payload,
+which is a vector of doubles. A request carries the input vector, the response
+carries the output vector of the network. A response with an empty payload
+indicates that the request was rejected. Integers and doubles are transferred
+in the host's native byte order.
+
+Requests that arrive within a short window are collected by a dynamic batcher
+and run through the network as one batch. When serving from a ModelStore,
+each batch is run through the snapshot which is current at its start.
+*/
+/*----------------------------------------------------------------------------*/
+class Server
+{
+public:
+   Server( const NeuralNetwork &nn, int maxBatchSize, int batchWindowUs );
+   Server( ModelStore &store, int maxBatchSize, int batchWindowUs );
+   ~Server();
+
+   bool serveSocket( std::string socketPath );
+   bool serveStream( int inFd, int outFd );
+
+   static void handleSignal( int sig );
+
+   static bool readFully( int fd, void *buf, size_t n );
+   static bool writeFully( int fd, const void *buf, size_t n );
+
+private:
+   struct Connection
+   {
+      Connection( int fd, bool ownsFd );
+      ~Connection();
+
+      int fd;
+      bool ownsFd;
+      std::mutex writeMutex;
+   };
+
+   struct Request
+   {
+      std::shared_ptr<Connection> conn;
+      std::vector<double> input;
+      std::chrono::steady_clock::time_point arrival;
+   };
+
+   void readRequests( std::shared_ptr<Connection> conn, int inFd );
+   void runBatcher();
+   void processBatch( std::vector<Request> &batch );
+   void startBatcher();
+   void stopBatcher();
+   void printStatistics( bool final );
+
+private:
+   const NeuralNetwork *m_NeuralNetwork;
+   ModelStore *m_Store;
+   int m_MaxBatchSize;
+   std::chrono::microseconds m_BatchWindow;
+
+   std::deque<Request> m_Queue;
+   std::mutex m_QueueMutex;
+   std::condition_variable m_QueueCond;
+   std::condition_variable m_SpaceCond;
+   bool m_Stop;
+   std::thread m_Batcher;
+
+   std::mutex m_StatsMutex;
+   std::vector<double> m_Latencies;
+   std::chrono::steady_clock::time_point m_StartTime;
+   std::chrono::steady_clock::time_point m_ReportTime;
+   long m_nRequests;
+   long m_nBatches;
+   long m_nIntervalRequests;
+   long m_nIntervalBatches;
+
+   static volatile sig_atomic_t s_Terminate;
+};
+
+#endif
@@ -0,0 +1,244 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file SpscQueue.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for the template class SpscQueue
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __SPSCQUEUE_H__
+#define __SPSCQUEUE_H__
+
+#include <stddef.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// The number of times push() and pop() retry before they block
+#define SPSCQUEUE_SPINS 256
+
+/*----------------------------------------------------------------------------*/
+/*!
+\class SpscQueue
+\date  2026-10-18
+
+A bounded lock-free queue for exactly one producer thread and one consumer
+thread. The producer only writes the head index and the consumer only writes
+the tail index, each on its own cache line.
+
+push() and pop() retry a few times when the queue is full or empty and then
+block on a condition variable, so an idle queue doesn't keep a CPU busy. The
+mutex is only taken by a thread which blocks and by the other thread if it
+has to wake it.
+*/
+/*----------------------------------------------------------------------------*/
+template<class T> class SpscQueue
+{
+public:
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Constructor
+   \param capacity The capacity, rounded up to a power of two
+   */
+   /*----------------------------------------------------------------------------*/
+   SpscQueue( size_t capacity ) :
+      m_nWaiting( 0 ),
+      m_Head( 0 ),
+      m_Tail( 0 )
+   {
+      size_t n = 1;
+      while( n < capacity )
+      {
+         n *= 2;
+      }
+      m_Slots.resize( n );
+      m_Mask = n - 1;
+   }
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Append an element unless the queue is full. Producer only.
+   \return true on success, false if the queue is full
+   */
+   /*----------------------------------------------------------------------------*/
+   bool tryPush( T &v )
+   {
+      if( !put( v ) )
+      {
+         return( false );
+      }
+
+      wake();
+      return( true );
+   }
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Remove the first element unless the queue is empty. Consumer only.
+   \return true on success, false if the queue is empty
+   */
+   /*----------------------------------------------------------------------------*/
+   bool tryPop( T &v )
+   {
+      if( !take( v ) )
+      {
+         return( false );
+      }
+
+      wake();
+      return( true );
+   }
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Append an element, waiting while the queue is full. Producer only.
+   */
+   /*----------------------------------------------------------------------------*/
+   void push( T &v )
+   {
+      for( int i = 0; !put( v ); i++ )
+      {
+         if( i >= SPSCQUEUE_SPINS )
+         {
+            await( [&]() { return( put( v ) ); } );
+            break;
+         }
+         std::this_thread::yield();
+      }
+
+      wake();
+   }
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Remove the first element, waiting while the queue is empty. Consumer only.
+   */
+   /*----------------------------------------------------------------------------*/
+   void pop( T &v )
+   {
+      for( int i = 0; !take( v ); i++ )
+      {
+         if( i >= SPSCQUEUE_SPINS )
+         {
+            await( [&]() { return( take( v ) ); } );
+            break;
+         }
+         std::this_thread::yield();
+      }
+
+      wake();
+   }
+
+private:
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Append an element unless the queue is full, without waking the consumer.
+   \return true on success, false if the queue is full
+   */
+   /*----------------------------------------------------------------------------*/
+   bool put( T &v )
+   {
+      size_t head = m_Head.load( std::memory_order_relaxed );
+      if( head - m_Tail.load( std::memory_order_acquire ) > m_Mask )
+      {
+         return( false );
+      }
+
+      m_Slots[head & m_Mask] = std::move( v );
+      m_Head.store( head + 1, std::memory_order_release );
+
+      return( true );
+   }
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Remove the first element unless the queue is empty, without waking the
+   producer.
+   \return true on success, false if the queue is empty
+   */
+   /*----------------------------------------------------------------------------*/
+   bool take( T &v )
+   {
+      size_t tail = m_Tail.load( std::memory_order_relaxed );
+      if( tail == m_Head.load( std::memory_order_acquire ) )
+      {
+         return( false );
+      }
+
+      v = std::move( m_Slots[tail & m_Mask] );
+      m_Tail.store( tail + 1, std::memory_order_release );
+
+      return( true );
+   }
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Block until an operation succeeds. The waiting count is published before
+   the operation is retried, and wake() checks it after changing an index,
+   both behind full fences, so at least one of the two threads sees the
+   other's change and no wakeup is lost.
+   \param ready The operation, returning true on success
+   */
+   /*----------------------------------------------------------------------------*/
+   template<class Ready> void await( Ready ready )
+   {
+      std::unique_lock<std::mutex> lock( m_Mutex );
+      m_nWaiting.fetch_add( 1 );
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+      while( !ready() )
+      {
+         m_Cond.wait( lock );
+      }
+      m_nWaiting.fetch_sub( 1 );
+   }
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Wake the other thread if it's blocked in await().
+   */
+   /*----------------------------------------------------------------------------*/
+   void wake()
+   {
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+      if( m_nWaiting.load( std::memory_order_relaxed ) > 0 )
+      {
+         std::lock_guard<std::mutex> lock( m_Mutex );
+         m_Cond.notify_all();
+      }
+   }
+
+private:
+   std::vector<T> m_Slots;
+   size_t m_Mask;
+
+   std::mutex m_Mutex;
+   std::condition_variable m_Cond;
+   std::atomic<int> m_nWaiting;
+
+   alignas( 64 ) std::atomic<size_t> m_Head;
+   alignas( 64 ) std::atomic<size_t> m_Tail;
+};
+
+#endif
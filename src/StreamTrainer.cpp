@@ -0,0 +1,699 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file StreamTrainer.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Implementation of the class StreamTrainer, which trains a network with
+a live stream of labeled samples.
+*/
+/*----------------------------------------------------------------------------*/
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+
+#include "StreamTrainer.h"
+#include "mnist.h"
+#include "util.h"
+
+// Binary samples larger than this are considered garbage and the stream is
+// closed
+#define MAX_SAMPLE_BYTES ( 64 * 1024 * 1024 )
+
+// The number of bytes read from a stream at once
+#define READ_CHUNK_BYTES ( 64 * 1024 )
+
+// Interval between two statistics reports while training
+#define REPORT_INTERVAL_S 5
+
+volatile sig_atomic_t StreamTrainer::s_Terminate = 0;
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor
+\param nn The network to be trained. It must not be used otherwise while
+the trainer is running.
+\param alpha The learning rate
+\param maxBatchSize The maximum number of samples learned as one batch
+\param maxLatencyUs The maximum time in microseconds from the arrival of a
+sample until it has been learned, which the batching aims for
+\param windowSize The number of recent samples the success rate is
+reported for
+\param queueCapacity The maximum number of samples queued for the trainer
+before the readers stop reading
+*/
+/*----------------------------------------------------------------------------*/
+StreamTrainer::StreamTrainer( NeuralNetwork &nn, double alpha, int maxBatchSize, int maxLatencyUs, int windowSize, int queueCapacity ) :
+   m_NeuralNetwork( nn ),
+   m_Alpha( alpha ),
+   m_MaxBatchSize( maxBatchSize < 1 ? 1 : maxBatchSize ),
+   m_MaxLatency( maxLatencyUs < 0 ? 0 : maxLatencyUs ),
+   m_QueueCapacity( std::max( queueCapacity, m_MaxBatchSize ) ),
+   m_Stop( false ),
+   m_SampleSeconds( 0.0 ),
+   m_Window( windowSize < 1 ? 1 : windowSize, 0 ),
+   m_WindowPos( 0 ),
+   m_nWindowPass( 0 ),
+   m_nSamples( 0 ),
+   m_nBatches( 0 ),
+   m_nIntervalSamples( 0 ),
+   m_nIntervalBatches( 0 ),
+   m_nLate( 0 ),
+   m_nRejected( 0 ),
+   m_nStalls( 0 )
+{
+   // A softmax output layer expects probabilities, which add up to 1
+   int last = nn.numLayers() - 1;
+   bool softmax = last > 0 && nn.layer( last ).type == LayerSpec::LAYER_SOFTMAX;
+   m_FalseVal = softmax ? 0.0 : 0.01;
+   m_TrueVal = softmax ? 1.0 : 0.99;
+
+   // CSV values are mapped to the same input values as by mnist::readMNIST()
+   for( int v = 0; v < 256; v++ )
+   {
+      double dv = (double)v / 255.0;
+      m_Levels[v] = ( dv * ( 1.0 - 0.01 ) ) + 0.01;
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Destructor
+*/
+/*----------------------------------------------------------------------------*/
+StreamTrainer::~StreamTrainer()
+{
+   stopTrainer();
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Signal handler for SIGINT and SIGTERM. Makes trainStream() and trainSocket()
+stop reading and return once the queued samples have been learned.
+*/
+/*----------------------------------------------------------------------------*/
+void StreamTrainer::handleSignal( int )
+{
+   s_Terminate = 1;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param name The name of a sample format: "csv" or "binary"
+\param format Receives the format
+\return true on success, false if the name is unknown
+*/
+/*----------------------------------------------------------------------------*/
+bool StreamTrainer::parseFormat( const std::string &name, Format &format )
+{
+   if( name == "csv" )
+   {
+      format = FORMAT_CSV;
+   } else
+   if( name == "binary" )
+   {
+      format = FORMAT_BINARY;
+   } else
+   {
+      return( false );
+   }
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Train with the samples read from a single stream, e.g. stdin or a FIFO, until
+it reaches end of file or SIGINT or SIGTERM is received, and all samples read
+have been learned.
+\param inFd The file descriptor to read the samples from
+\param format The format of the samples
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool StreamTrainer::trainStream( int inFd, Format format )
+{
+   startTrainer();
+
+   readSamples( inFd, format );
+
+   stopTrainer();
+   printStatistics( true );
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Listen on a Unix domain socket and train with the samples of any number of
+clients until SIGINT or SIGTERM is received. Each client connection gets its
+own reader thread, whereas all samples are learned by a single trainer
+thread.
+\param socketPath The file system path of the socket. An existing file of
+that name is removed.
+\param format The format of the samples
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool StreamTrainer::trainSocket( std::string socketPath, Format format )
+{
+   struct sockaddr_un addr;
+   memset( &addr, 0, sizeof( addr ) );
+   addr.sun_family = AF_UNIX;
+   if( socketPath.size() >= sizeof( addr.sun_path ) )
+   {
+      fprintf( stderr, "Socket path '%s' is too long.\n", socketPath.c_str() );
+      return( false );
+   }
+   strcpy( addr.sun_path, socketPath.c_str() );
+
+   int listenFd = socket( AF_UNIX, SOCK_STREAM, 0 );
+   if( listenFd < 0 )
+   {
+      perror( "socket" );
+      return( false );
+   }
+
+   unlink( socketPath.c_str() );
+   if( bind( listenFd, (struct sockaddr *)&addr, sizeof( addr ) ) < 0 ||
+       listen( listenFd, 128 ) < 0 )
+   {
+      perror( socketPath.c_str() );
+      close( listenFd );
+      return( false );
+   }
+
+   startTrainer();
+
+   struct Reader
+   {
+      std::thread thread;
+      std::shared_ptr<bool> done;
+   };
+   std::vector<Reader> readers;
+   std::mutex doneMutex;
+
+   fprintf( stderr, "Listening on %s\n", socketPath.c_str() );
+   while( !s_Terminate )
+   {
+      // Wake up regularly to check whether we're supposed to terminate
+      struct pollfd pfd;
+      pfd.fd = listenFd;
+      pfd.events = POLLIN;
+      if( poll( &pfd, 1, 200 ) > 0 )
+      {
+         int fd = accept( listenFd, NULL, NULL );
+         if( fd >= 0 )
+         {
+            Reader reader;
+            reader.done = std::make_shared<bool>( false );
+
+            std::shared_ptr<bool> done = reader.done;
+            reader.thread = std::thread( [this, fd, format, done, &doneMutex]()
+            {
+               readSamples( fd, format );
+               close( fd );
+               std::lock_guard<std::mutex> lock( doneMutex );
+               *done = true;
+            } );
+            readers.push_back( std::move( reader ) );
+         }
+      }
+
+      // Reap the reader threads of closed connections
+      std::lock_guard<std::mutex> lock( doneMutex );
+      for( int i = readers.size() - 1; i >= 0; i-- )
+      {
+         if( *readers[i].done )
+         {
+            readers[i].thread.join();
+            readers.erase( readers.begin() + i );
+         }
+      }
+   }
+
+   fprintf( stderr, "Shutting down..\n" );
+   close( listenFd );
+   unlink( socketPath.c_str() );
+
+   // The readers notice the termination within their poll interval
+   for( int i = 0; i < readers.size(); i++ )
+   {
+      readers[i].thread.join();
+   }
+   readers.clear();
+
+   stopTrainer();
+   printStatistics( true );
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Read samples from a file descriptor and queue them for the trainer until end
+of file, a malformed binary sample or termination. Malformed CSV lines and
+samples which don't fit the network are counted and skipped.
+\param inFd The file descriptor to read the samples from
+\param format The format of the samples
+*/
+/*----------------------------------------------------------------------------*/
+void StreamTrainer::readSamples( int inFd, Format format )
+{
+   int nInputs = m_NeuralNetwork.numNeurons( 0 );
+   int nOutputs = m_NeuralNetwork.numNeurons( m_NeuralNetwork.numLayers() - 1 );
+   std::vector<char> chunk( READ_CHUNK_BYTES );
+   std::string buffer;
+   size_t pos = 0;
+   bool malformed = false;
+
+   while( !malformed && !s_Terminate )
+   {
+      // Wake up regularly to check whether we're supposed to terminate
+      struct pollfd pfd;
+      pfd.fd = inFd;
+      pfd.events = POLLIN;
+      int r = poll( &pfd, 1, 200 );
+      if( r < 0 && errno != EINTR )
+      {
+         break;
+      }
+      if( r <= 0 )
+      {
+         continue;
+      }
+
+      ssize_t n = read( inFd, chunk.data(), chunk.size() );
+      if( n < 0 && errno == EINTR )
+      {
+         continue;
+      }
+      if( n <= 0 )
+      {
+         break;
+      }
+      buffer.erase( 0, pos );
+      buffer.append( chunk.data(), n );
+      pos = 0;
+
+      for( ;; )
+      {
+         Sample sample;
+         if( format == FORMAT_CSV )
+         {
+            size_t eol = buffer.find( '\n', pos );
+            if( eol == std::string::npos )
+            {
+               break;
+            }
+
+            size_t begin = pos;
+            pos = eol + 1;
+            if( buffer.find_first_not_of( " \t\r", begin ) >= eol )
+            {
+               continue;
+            }
+            if( !parseCsv( buffer.data() + begin, eol - begin, sample ) )
+            {
+               sample.label = -1;
+            }
+         } else
+         {
+            uint32_t len;
+            if( buffer.size() - pos < sizeof( len ) )
+            {
+               break;
+            }
+            memcpy( &len, buffer.data() + pos, sizeof( len ) );
+            if( ( len % sizeof( double ) ) != 0 || len < sizeof( double ) || len > MAX_SAMPLE_BYTES )
+            {
+               fprintf( stderr, "Malformed sample of %u bytes, closing the stream.\n", len );
+               malformed = true;
+               break;
+            }
+            if( buffer.size() - pos < sizeof( len ) + len )
+            {
+               break;
+            }
+
+            std::vector<double> values( len / sizeof( double ) );
+            memcpy( values.data(), buffer.data() + pos + sizeof( len ), len );
+            pos += sizeof( len ) + len;
+            sample.label = values[0] >= 0.0 && values[0] < nOutputs ? (int)values[0] : -1;
+            sample.input.assign( values.begin() + 1, values.end() );
+         }
+
+         if( sample.label < 0 || sample.label >= nOutputs || sample.input.size() != nInputs )
+         {
+            std::lock_guard<std::mutex> lock( m_StatsMutex );
+            m_nRejected++;
+            continue;
+         }
+
+         sample.arrival = std::chrono::steady_clock::now();
+         enqueue( sample );
+      }
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Parse a line in the format of the MNIST CSV files.
+\param line The line, without the line feed
+\param len The length of the line
+\param sample Receives the label and the input vector
+\return true on success, false if the line is malformed
+*/
+/*----------------------------------------------------------------------------*/
+bool StreamTrainer::parseCsv( const char *line, size_t len, Sample &sample ) const
+{
+   const char *p = line;
+   const char *end = line + len;
+   char *next;
+
+   sample.input.clear();
+   sample.label = (int)strtol( p, &next, 10 );
+   if( next == p )
+   {
+      return( false );
+   }
+
+   for( p = next; p < end; p = next )
+   {
+      if( *p == ' ' || *p == '\t' || *p == '\r' )
+      {
+         next = (char *)p + 1;
+         continue;
+      }
+      if( *p != ',' || p + 1 >= end )
+      {
+         return( false );
+      }
+
+      long v = strtol( p + 1, &next, 10 );
+      if( next == p + 1 || next > end || v < 0 || v > 255 )
+      {
+         return( false );
+      }
+      sample.input.push_back( m_Levels[v] );
+   }
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+The queue is full when it holds more samples than can be learned within the
+maximum latency after the batch being learned, going by the time the
+previous samples took, but never less than a batch and never more than the
+queue capacity. m_QueueMutex must be held.
+\return The number of samples the queue may hold
+*/
+/*----------------------------------------------------------------------------*/
+size_t StreamTrainer::queueLimit() const
+{
+   double n = m_SampleSeconds > 0.0 ? std::chrono::duration<double>( m_MaxLatency ).count() / m_SampleSeconds - m_MaxBatchSize :
+              m_QueueCapacity;
+   return( (size_t)std::max( (double)m_MaxBatchSize, std::min( (double)m_QueueCapacity, n ) ) );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Queue a sample for the trainer. If the queue is full, wait until the trainer
+has taken samples from it.
+\param sample The sample, which is moved into the queue
+*/
+/*----------------------------------------------------------------------------*/
+void StreamTrainer::enqueue( Sample &sample )
+{
+   std::unique_lock<std::mutex> lock( m_QueueMutex );
+   if( m_Queue.size() >= queueLimit() )
+   {
+      std::lock_guard<std::mutex> statsLock( m_StatsMutex );
+      m_nStalls++;
+   }
+   while( !s_Terminate && m_Queue.size() >= queueLimit() )
+   {
+      m_SpaceCond.wait_for( lock, std::chrono::milliseconds( 200 ) );
+   }
+
+   m_Queue.push_back( std::move( sample ) );
+   m_QueueCond.notify_one();
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Start the trainer thread
+*/
+/*----------------------------------------------------------------------------*/
+void StreamTrainer::startTrainer()
+{
+   m_Stop = false;
+   m_StartTime = std::chrono::steady_clock::now();
+   m_ReportTime = m_StartTime;
+   m_Trainer = std::thread( &StreamTrainer::runTrainer, this );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Stop the trainer thread after all queued samples have been learned.
+*/
+/*----------------------------------------------------------------------------*/
+void StreamTrainer::stopTrainer()
+{
+   if( !m_Trainer.joinable() )
+   {
+      return;
+   }
+
+   {
+      std::lock_guard<std::mutex> lock( m_QueueMutex );
+      m_Stop = true;
+      m_QueueCond.notify_one();
+   }
+
+   m_Trainer.join();
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+The trainer thread. It waits for the first sample of a batch, then waits for
+more samples until either the batch is full or the oldest sample has to be
+learned right away to be learned within the maximum latency, estimated from
+the time the previous samples took. Samples which queued up while the
+previous batch was being learned usually have to be learned right away, so
+under load, the batches grow without any additional delay.
+*/
+/*----------------------------------------------------------------------------*/
+void StreamTrainer::runTrainer()
+{
+   std::vector<Sample> batch;
+
+   for( ;; )
+   {
+      {
+         std::unique_lock<std::mutex> lock( m_QueueMutex );
+         while( !m_Stop && m_Queue.empty() )
+         {
+            m_QueueCond.wait( lock );
+         }
+
+         if( m_Queue.empty() )
+         {
+            // m_Stop is set and there's nothing left to do
+            break;
+         }
+
+         for( ;; )
+         {
+            size_t n = std::min( m_Queue.size(), (size_t)m_MaxBatchSize );
+            std::chrono::steady_clock::time_point deadline = m_Queue.front().arrival + m_MaxLatency -
+               std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                  std::chrono::duration<double>( m_SampleSeconds * ( n + 1 ) ) );
+            if( m_Stop || n >= m_MaxBatchSize || std::chrono::steady_clock::now() >= deadline )
+            {
+               break;
+            }
+            m_QueueCond.wait_until( lock, deadline );
+         }
+
+         while( !m_Queue.empty() && batch.size() < m_MaxBatchSize )
+         {
+            batch.push_back( std::move( m_Queue.front() ) );
+            m_Queue.pop_front();
+         }
+         m_SpaceCond.notify_all();
+      }
+
+      trainBatch( batch );
+      batch.clear();
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Classify a batch of samples with the network, then learn them one after
+another.
+\param batch The samples
+*/
+/*----------------------------------------------------------------------------*/
+void StreamTrainer::trainBatch( std::vector<Sample> &batch )
+{
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+   std::vector<std::vector<double> > inputs( batch.size() );
+   for( int i = 0; i < batch.size(); i++ )
+   {
+      inputs[i].swap( batch[i].input );
+   }
+
+   // Each sample is classified before it's learned, so the success rate is
+   // that of samples the network hasn't seen yet
+   std::vector<std::vector<double> > outputs;
+   m_NeuralNetwork.query( inputs, outputs );
+
+   for( int i = 0; i < batch.size(); i++ )
+   {
+      m_NeuralNetwork.train( inputs[i], mnist::convertToExpectedOut( batch[i].label, m_FalseVal, m_TrueVal ), m_Alpha );
+   }
+
+   std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+   double seconds = std::chrono::duration<double>( now - start ).count() / batch.size();
+   {
+      std::lock_guard<std::mutex> lock( m_QueueMutex );
+      m_SampleSeconds = m_SampleSeconds > 0.0 ? 0.9 * m_SampleSeconds + 0.1 * seconds : seconds;
+   }
+
+   bool report;
+   {
+      std::lock_guard<std::mutex> lock( m_StatsMutex );
+      for( int i = 0; i < batch.size(); i++ )
+      {
+         char pass = i < outputs.size() && util::indexOfMaxValue( outputs[i] ) == batch[i].label;
+         m_nWindowPass += pass - m_Window[m_WindowPos];
+         m_Window[m_WindowPos] = pass;
+         m_WindowPos = ( m_WindowPos + 1 ) % m_Window.size();
+
+         m_Latencies.push_back( std::chrono::duration<double, std::micro>( now - batch[i].arrival ).count() );
+         m_nLate += now - batch[i].arrival > m_MaxLatency;
+      }
+      m_nIntervalSamples += batch.size();
+      m_nIntervalBatches++;
+      report = now - m_ReportTime >= std::chrono::seconds( REPORT_INTERVAL_S );
+   }
+
+   if( report )
+   {
+      printStatistics( false );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of samples learned so far
+*/
+/*----------------------------------------------------------------------------*/
+long StreamTrainer::numSamples()
+{
+   std::lock_guard<std::mutex> lock( m_StatsMutex );
+   return( m_nSamples + m_nIntervalSamples );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The success rate in percent of the classification of the recent
+samples before they were learned
+*/
+/*----------------------------------------------------------------------------*/
+double StreamTrainer::windowSuccessRate()
+{
+   std::lock_guard<std::mutex> lock( m_StatsMutex );
+   long n = std::min( (long)m_Window.size(), m_nSamples + m_nIntervalSamples );
+   return( n > 0 ? 100.0 * m_nWindowPass / n : 0.0 );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Print the throughput, the success rate over the sliding window and the
+update latency since the last report to stderr.
+\param final If true, also print the totals since the trainer was started
+*/
+/*----------------------------------------------------------------------------*/
+void StreamTrainer::printStatistics( bool final )
+{
+   std::lock_guard<std::mutex> lock( m_StatsMutex );
+
+   std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+   double interval = std::chrono::duration<double>( now - m_ReportTime ).count();
+   long nWindow = std::min( (long)m_Window.size(), m_nSamples + m_nIntervalSamples );
+
+   if( m_nIntervalSamples > 0 )
+   {
+      fprintf( stderr, "%ld samples in %ld updates (avg. batch size %0.1f), %0.0f samples/s, "
+                       "success rate %0.1f%% over the last %ld samples, latency p50 = %0.0f us, p99 = %0.0f us\n",
+         m_nIntervalSamples, m_nIntervalBatches,
+         (double)m_nIntervalSamples / (double)m_nIntervalBatches,
+         m_nIntervalSamples / interval,
+         100.0 * m_nWindowPass / nWindow, nWindow,
+         util::percentile( m_Latencies, 50.0 ),
+         util::percentile( m_Latencies, 99.0 ) );
+   }
+
+   m_nSamples += m_nIntervalSamples;
+   m_nBatches += m_nIntervalBatches;
+   m_nIntervalSamples = 0;
+   m_nIntervalBatches = 0;
+   m_Latencies.clear();
+   m_ReportTime = now;
+
+   if( final )
+   {
+      double total = std::chrono::duration<double>( now - m_StartTime ).count();
+      fprintf( stderr, "Total: %ld samples in %ld updates in %0.1f s, %0.0f samples/s, %ld over the latency limit, "
+                       "%ld rejected, %ld reader stalls\n",
+         m_nSamples, m_nBatches, total, total > 0.0 ? m_nSamples / total : 0.0, m_nLate, m_nRejected, m_nStalls );
+   }
+}
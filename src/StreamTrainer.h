@@ -0,0 +1,147 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file StreamTrainer.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for class StreamTrainer
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __STREAMTRAINER_H__
+#define __STREAMTRAINER_H__
+
+#include <signal.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "NeuralNetwork.h"
+
+/*----------------------------------------------------------------------------*/
+/*!
+\class StreamTrainer
+\date  2026-10-18
+
+Trains a NeuralNetwork with a live stream of labeled samples, read from a
+file descriptor such as stdin or a FIFO, or from the clients of a Unix
+domain socket.
+
+Samples are either lines in the format of the MNIST CSV files (the label,
+followed by one value from 0 to 255 per input) or binary records in the
+format of Server requests: a 32 bit payload length in bytes, followed by
+the payload, a vector of doubles in the host's byte order. The first double
+is the label, the others are the input vector.
+
+The readers put the samples into a bounded queue. When it holds more
+samples than the trainer can learn within the maximum update latency, they
+stop reading until the trainer has caught up, so the backpressure reaches
+the producers through the pipe or the socket. The trainer takes the queued
+samples in micro-batches. It doesn't wait for a batch to fill up beyond the
+point where the oldest sample could no longer be learned within the maximum
+update latency. Each sample of a batch is classified by the network before
+it's learned, and the success rate over a sliding window of recent samples
+is reported along with the throughput and the update latency.
+*/
+/*----------------------------------------------------------------------------*/
+class StreamTrainer
+{
+public:
+   typedef enum
+   {
+      FORMAT_CSV,
+      FORMAT_BINARY
+   } Format;
+
+public:
+   StreamTrainer( NeuralNetwork &nn, double alpha, int maxBatchSize, int maxLatencyUs, int windowSize, int queueCapacity );
+   ~StreamTrainer();
+
+   bool trainStream( int inFd, Format format );
+   bool trainSocket( std::string socketPath, Format format );
+
+   long numSamples();
+   double windowSuccessRate();
+
+   static bool parseFormat( const std::string &name, Format &format );
+   static void handleSignal( int sig );
+
+private:
+   struct Sample
+   {
+      std::vector<double> input;
+      int label;
+      std::chrono::steady_clock::time_point arrival;
+   };
+
+   void readSamples( int inFd, Format format );
+   bool parseCsv( const char *line, size_t len, Sample &sample ) const;
+   size_t queueLimit() const;
+   void enqueue( Sample &sample );
+   void runTrainer();
+   void trainBatch( std::vector<Sample> &batch );
+   void startTrainer();
+   void stopTrainer();
+   void printStatistics( bool final );
+
+private:
+   NeuralNetwork &m_NeuralNetwork;
+   double m_Alpha;
+   int m_MaxBatchSize;
+   std::chrono::microseconds m_MaxLatency;
+   int m_QueueCapacity;
+   double m_FalseVal;
+   double m_TrueVal;
+   double m_Levels[256];
+
+   std::deque<Sample> m_Queue;
+   std::mutex m_QueueMutex;
+   std::condition_variable m_QueueCond;
+   std::condition_variable m_SpaceCond;
+   bool m_Stop;
+   std::thread m_Trainer;
+
+   // The estimated seconds it takes to learn a sample, guarded by
+   // m_QueueMutex
+   double m_SampleSeconds;
+
+   std::mutex m_StatsMutex;
+   std::vector<char> m_Window;
+   size_t m_WindowPos;
+   long m_nWindowPass;
+   std::vector<double> m_Latencies;
+   std::chrono::steady_clock::time_point m_StartTime;
+   std::chrono::steady_clock::time_point m_ReportTime;
+   long m_nSamples;
+   long m_nBatches;
+   long m_nIntervalSamples;
+   long m_nIntervalBatches;
+   long m_nLate;
+   long m_nRejected;
+   long m_nStalls;
+
+   static volatile sig_atomic_t s_Terminate;
+};
+
+#endif
@@ -0,0 +1,282 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file Sweep.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Implementation of the class Sweep, which trains several variants of a
+network concurrently with one shared dataset.
+*/
+/*----------------------------------------------------------------------------*/
+#include <stdio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+#include "Random.h"
+#include "Sweep.h"
+#include "ThreadPool.h"
+#include "util.h"
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor
+\param dataset The training samples. They must stay unaltered while the
+sweep exists.
+\param nEpochs The number of epochs
+\param seed The seed of the initial weights and of the shuffling
+\param chunkSize The number of samples fed to all variants in turn
+*/
+/*----------------------------------------------------------------------------*/
+Sweep::Sweep( const mnist::Dataset &dataset, int nEpochs, uint64_t seed, int chunkSize ) :
+   m_Dataset( dataset ),
+   m_nEpochs( nEpochs ),
+   m_Seed( seed ),
+   m_ChunkSize( chunkSize < 1 ? 1 : chunkSize ),
+   m_Elapsed( 0.0 )
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Destructor
+*/
+/*----------------------------------------------------------------------------*/
+Sweep::~Sweep()
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Add a variant.
+\param name The name of the variant in the results
+\param layers The layers of the network
+\param alpha The learning rate
+\return true on success, false if the layers don't fit together or don't fit
+the dataset
+*/
+/*----------------------------------------------------------------------------*/
+bool Sweep::add( std::string name, const std::vector<LayerSpec> &layers, double alpha )
+{
+   // A training run initializes its network with the first value of the
+   // main thread's random stream
+   Variant v;
+   v.name = name;
+   v.nn.reset( new NeuralNetwork( layers, Random( m_Seed, Random::threadStream( 0 ) ).next64() ) );
+   v.alpha = alpha;
+   v.loss = 0.0;
+   v.seconds = 0.0;
+   v.successRate = 0.0;
+
+   int last = v.nn->numLayers() - 1;
+   if( last < 1 || v.nn->numNeurons( 0 ) != m_Dataset.sampleSize )
+   {
+      return( false );
+   }
+
+   // A softmax output layer expects probabilities, which add up to 1
+   bool softmax = v.nn->layer( last ).type == LayerSpec::LAYER_SOFTMAX;
+   v.falseVal = softmax ? 0.0 : 0.01;
+   v.trueVal = softmax ? 1.0 : 0.99;
+
+   m_Variants.push_back( std::move( v ) );
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Train one variant with a chunk of samples.
+\param v The variant
+\param order The shuffled indices of the samples of the epoch
+\param begin The index of the first sample of the chunk within order
+\param end The index after the last sample of the chunk within order
+*/
+/*----------------------------------------------------------------------------*/
+void Sweep::trainChunk( Variant &v, const std::vector<int> &order, int begin, int end )
+{
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+   for( int n = begin; n < end; n++ )
+   {
+      int nSample = order[n];
+      std::vector<double> expectedOutVector = mnist::convertToExpectedOut( m_Dataset.digits[nSample], v.falseVal, v.trueVal );
+      v.nn->train( m_Dataset.sample( nSample ), m_Dataset.levels, expectedOutVector, v.alpha );
+      v.loss += v.nn->loss();
+   }
+
+   v.seconds += std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Train all variants. Within a chunk, the worker threads of the ThreadPool take
+one variant after another until all variants have been trained with the
+chunk. The layer kernels of a variant run in the worker thread which trains
+it.
+*/
+/*----------------------------------------------------------------------------*/
+void Sweep::train()
+{
+   ThreadPool &pool = ThreadPool::instance();
+   int nSamples = m_Dataset.size();
+   std::vector<int> order( nSamples );
+   for( int i = 0; i < nSamples; i++ )
+   {
+      order[i] = i;
+   }
+
+   // Each epoch shuffles the order of the previous one, like a single
+   // training run does
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+   for( int epoch = 0; epoch < m_nEpochs; epoch++ )
+   {
+      Random rng( m_Seed, RANDOM_SHUFFLE_STREAM + epoch );
+      rng.shuffle( order );
+
+      for( int i = 0; i < m_Variants.size(); i++ )
+      {
+         m_Variants[i].loss = 0.0;
+      }
+
+      for( int begin = 0; begin < nSamples; begin += m_ChunkSize )
+      {
+         int end = std::min( begin + m_ChunkSize, nSamples );
+         std::atomic<int> next( 0 );
+
+         pool.run( [this, &order, begin, end, &next]( int )
+         {
+            for( int i = next++; i < (int)m_Variants.size(); i = next++ )
+            {
+               trainChunk( m_Variants[i], order, begin, end );
+            }
+         } );
+      }
+
+      printf( "Finished epoch %d.\n", epoch + 1 );
+   }
+   m_Elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+   // The loss of the last epoch
+   for( int i = 0; i < m_Variants.size(); i++ )
+   {
+      m_Variants[i].loss /= std::max( 1, nSamples );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Determine the success rate of all variants with a test dataset.
+\param dataset The test samples
+*/
+/*----------------------------------------------------------------------------*/
+void Sweep::test( const mnist::Dataset &dataset )
+{
+   for( int i = 0; i < m_Variants.size(); i++ )
+   {
+      Variant &v = m_Variants[i];
+      std::vector<std::vector<double> > outputs;
+      v.nn->query( dataset.pixels.data(), dataset.size(), dataset.levels, outputs );
+
+      int nPass = 0;
+      for( int s = 0; s < outputs.size(); s++ )
+      {
+         nPass += util::indexOfMaxValue( outputs[s] ) == dataset.digits[s];
+      }
+      v.successRate = 100.0 * nPass / std::max( (size_t)1, outputs.size() );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Print a table of the results of all variants, best success rate first.
+*/
+/*----------------------------------------------------------------------------*/
+void Sweep::printResults() const
+{
+   std::vector<int> ranking( m_Variants.size() );
+   for( int i = 0; i < ranking.size(); i++ )
+   {
+      ranking[i] = i;
+   }
+   std::stable_sort( ranking.begin(), ranking.end(), [this]( int a, int b )
+   {
+      return( m_Variants[a].successRate > m_Variants[b].successRate );
+   } );
+
+   size_t width = 8;
+   for( int i = 0; i < m_Variants.size(); i++ )
+   {
+      width = std::max( width, m_Variants[i].name.size() );
+   }
+
+   printf( "%-*s %8s %10s %10s %9s %10s\n", (int)width, "variant", "alpha", "weights", "loss", "success", "train s" );
+   for( int i = 0; i < ranking.size(); i++ )
+   {
+      const Variant &v = m_Variants[ranking[i]];
+      std::vector<double> weights;
+      v.nn->getWeights( weights );
+      printf( "%-*s %8.3f %10zu %10.4f %8.1f%% %10.2f\n", (int)width, v.name.c_str(), v.alpha,
+              weights.size(), v.loss, v.successRate, v.seconds );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of variants
+*/
+/*----------------------------------------------------------------------------*/
+int Sweep::numVariants() const
+{
+   return( m_Variants.size() );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param n The index of a variant, in the order they were added
+\return The network of the variant
+*/
+/*----------------------------------------------------------------------------*/
+const NeuralNetwork &Sweep::network( int n ) const
+{
+   return( *m_Variants[n].nn );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of samples per second all variants together trained with
+during the last call of train()
+*/
+/*----------------------------------------------------------------------------*/
+double Sweep::samplesPerSecond() const
+{
+   return( m_Elapsed > 0.0 ? (double)m_Dataset.size() * m_nEpochs * m_Variants.size() / m_Elapsed : 0.0 );
+}
@@ -0,0 +1,96 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file Sweep.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for class Sweep
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __SWEEP_H__
+#define __SWEEP_H__
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "LayerSpec.h"
+#include "NeuralNetwork.h"
+#include "mnist.h"
+
+/*----------------------------------------------------------------------------*/
+/*!
+\class Sweep
+\date  2026-10-18
+
+Trains several variants of a network (topologies, output layers, learning
+rates) at the same time with one training dataset, which is read only once
+and shared by all variants.
+
+The samples of each epoch are shuffled once for all variants and processed
+in chunks. Each chunk is fed to all variants, which are spread across the
+ThreadPool, while the chunk is in the cache. Each variant starts with the
+weights a training run with the same seed and topology starts with, and sees
+the samples in the same order, so its result is the same as that of the
+training run with its learning rate.
+*/
+/*----------------------------------------------------------------------------*/
+class Sweep
+{
+public:
+   Sweep( const mnist::Dataset &dataset, int nEpochs, uint64_t seed, int chunkSize );
+   ~Sweep();
+
+   bool add( std::string name, const std::vector<LayerSpec> &layers, double alpha );
+   void train();
+   void test( const mnist::Dataset &dataset );
+   void printResults() const;
+
+   int numVariants() const;
+   const NeuralNetwork &network( int n ) const;
+   double samplesPerSecond() const;
+
+private:
+   struct Variant
+   {
+      std::string name;
+      std::unique_ptr<NeuralNetwork> nn;
+      double alpha;
+      double falseVal;
+      double trueVal;
+      double loss;
+      double seconds;
+      double successRate;
+   };
+
+   void trainChunk( Variant &v, const std::vector<int> &order, int begin, int end );
+
+private:
+   const mnist::Dataset &m_Dataset;
+   int m_nEpochs;
+   uint64_t m_Seed;
+   int m_ChunkSize;
+   std::vector<Variant> m_Variants;
+   double m_Elapsed;
+};
+
+#endif
@@ -0,0 +1,231 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file ThreadPool.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Implementation of the class ThreadPool.
+*/
+/*----------------------------------------------------------------------------*/
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor. Worker n is pinned to the nth CPU of allowedCpus(); workers
+beyond the number of allowed CPUs aren't pinned.
+\param nThreads The number of worker threads. With 1 or less, no threads are
+started and run() executes the work in the calling thread.
+*/
+/*----------------------------------------------------------------------------*/
+ThreadPool::ThreadPool( int nThreads ) :
+   m_nPinned( 0 ),
+   m_Task( NULL ),
+   m_Generation( 0 ),
+   m_nBusy( 0 ),
+   m_Stop( false ),
+   m_Pid( getpid() )
+{
+   std::vector<int> cpus = allowedCpus();
+   for( int i = 0; nThreads > 1 && i < nThreads; i++ )
+   {
+      m_Threads.push_back( std::thread( &ThreadPool::worker, this, i ) );
+
+      // The workers don't touch any memory before their first task, so
+      // pinning them from here is early enough
+      if( i < (int)cpus.size() )
+      {
+         cpu_set_t cpu;
+         CPU_ZERO( &cpu );
+         CPU_SET( cpus[i], &cpu );
+         m_nPinned += pthread_setaffinity_np( m_Threads[i].native_handle(), sizeof( cpu ), &cpu ) == 0;
+      }
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Destructor
+*/
+/*----------------------------------------------------------------------------*/
+ThreadPool::~ThreadPool()
+{
+   {
+      std::lock_guard<std::mutex> lock( m_Mutex );
+      m_Stop = true;
+      m_WorkCond.notify_all();
+   }
+
+   for( int i = 0; i < (int)m_Threads.size(); i++ )
+   {
+      m_Threads[i].join();
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The pool shared by the whole program, with one thread per CPU the
+process may run on
+*/
+/*----------------------------------------------------------------------------*/
+ThreadPool &ThreadPool::instance()
+{
+   static ThreadPool pool( allowedCpus().size() );
+   return( pool );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The CPUs in the affinity mask of the calling thread, which it
+inherited from the process, in ascending order. If the mask can't be read,
+all CPUs reported by std::thread::hardware_concurrency().
+*/
+/*----------------------------------------------------------------------------*/
+std::vector<int> ThreadPool::allowedCpus()
+{
+   std::vector<int> cpus;
+   cpu_set_t mask;
+   if( sched_getaffinity( 0, sizeof( mask ), &mask ) == 0 )
+   {
+      for( int i = 0; i < CPU_SETSIZE; i++ )
+      {
+         if( CPU_ISSET( i, &mask ) )
+         {
+            cpus.push_back( i );
+         }
+      }
+   }
+
+   if( cpus.empty() )
+   {
+      for( int i = 0; i < (int)std::max( 1u, std::thread::hardware_concurrency() ); i++ )
+      {
+         cpus.push_back( i );
+      }
+   }
+
+   return( cpus );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of parts work is split into by run()
+*/
+/*----------------------------------------------------------------------------*/
+int ThreadPool::numThreads() const
+{
+   return( m_Threads.size() > 0 ? m_Threads.size() : 1 );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of worker threads pinned to their own CPU
+*/
+/*----------------------------------------------------------------------------*/
+int ThreadPool::numPinned() const
+{
+   return( m_nPinned );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Run a task on all worker threads and wait until all of them have finished.
+The task is invoked once with each index from 0 to numThreads() - 1.
+
+If the pool is already busy with work from another thread, or if this is a
+child process forked after the pool was created, the task is executed in the
+calling thread instead, all indices in turn.
+
+\param task The task
+*/
+/*----------------------------------------------------------------------------*/
+void ThreadPool::run( const std::function<void( int nThread )> &task )
+{
+   std::unique_lock<std::mutex> runLock( m_RunMutex, std::try_to_lock );
+   if( m_Threads.size() < 1 || !runLock.owns_lock() || getpid() != m_Pid )
+   {
+      for( int i = 0; i < numThreads(); i++ )
+      {
+         task( i );
+      }
+      return;
+   }
+
+   std::unique_lock<std::mutex> lock( m_Mutex );
+   m_Task = &task;
+   m_nBusy = m_Threads.size();
+   m_Generation++;
+   m_WorkCond.notify_all();
+
+   while( m_nBusy > 0 )
+   {
+      m_DoneCond.wait( lock );
+   }
+   m_Task = NULL;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+The worker thread
+\param nThread The index of the worker
+*/
+/*----------------------------------------------------------------------------*/
+void ThreadPool::worker( int nThread )
+{
+   unsigned long generation = 0;
+   for( ;; )
+   {
+      const std::function<void( int nThread )> *task;
+      {
+         std::unique_lock<std::mutex> lock( m_Mutex );
+         while( !m_Stop && m_Generation == generation )
+         {
+            m_WorkCond.wait( lock );
+         }
+         if( m_Stop )
+         {
+            break;
+         }
+         generation = m_Generation;
+         task = m_Task;
+      }
+
+      ( *task )( nThread );
+
+      std::lock_guard<std::mutex> lock( m_Mutex );
+      if( --m_nBusy == 0 )
+      {
+         m_DoneCond.notify_one();
+      }
+   }
+}
@@ -0,0 +1,88 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file ThreadPool.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for class ThreadPool
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+#include <sys/types.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*----------------------------------------------------------------------------*/
+/*!
+\class ThreadPool
+\date  2026-10-18
+
+A fixed set of worker threads, one per CPU the process may run on, each
+pinned to its own CPU. Work is handed to all workers at once with run(),
+which passes each worker its index. Since worker n always runs on the same
+CPU, memory which worker n touches first is placed on that CPU's NUMA node
+and stays local to worker n for all later work partitioned the same way.
+
+The CPUs are taken from the affinity mask the process inherited (e.g. from
+taskset or a cgroup cpuset). Workers which can't be pinned still work, only
+without a fixed NUMA node; numPinned() tells how many are pinned.
+
+The worker threads don't survive a fork(), so in a child process, run()
+executes all work in the calling thread.
+*/
+/*----------------------------------------------------------------------------*/
+class ThreadPool
+{
+public:
+   ThreadPool( int nThreads );
+   ~ThreadPool();
+
+   int numThreads() const;
+   int numPinned() const;
+   void run( const std::function<void( int nThread )> &task );
+
+   static ThreadPool &instance();
+   static std::vector<int> allowedCpus();
+
+private:
+   void worker( int nThread );
+
+private:
+   std::vector<std::thread> m_Threads;
+   int m_nPinned;
+   std::mutex m_RunMutex;
+
+   std::mutex m_Mutex;
+   std::condition_variable m_WorkCond;
+   std::condition_variable m_DoneCond;
+   const std::function<void( int nThread )> *m_Task;
+   unsigned long m_Generation;
+   int m_nBusy;
+   bool m_Stop;
+   pid_t m_Pid;
+};
+
+#endif
@@ -0,0 +1,571 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file Transport.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Implementation of the classes Transport, ShmTransport and
+TcpTransport.
+*/
+/*----------------------------------------------------------------------------*/
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "Transport.h"
+
+// Capacity of each shared memory ring buffer
+#define SHM_CHANNEL_BYTES ( 1 << 20 )
+
+// A peer which doesn't make any progress for this long is considered dead
+#define TRANSPORT_TIMEOUT_S 60
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor
+\param rank The index of this process within the ring
+\param nRanks The number of processes in the ring
+*/
+/*----------------------------------------------------------------------------*/
+Transport::Transport( int rank, int nRanks ) :
+   m_Rank( rank ),
+   m_nRanks( nRanks )
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Destructor
+*/
+/*----------------------------------------------------------------------------*/
+Transport::~Transport()
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The index of this process within the ring
+*/
+/*----------------------------------------------------------------------------*/
+int Transport::rank() const
+{
+   return( m_Rank );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of processes in the ring
+*/
+/*----------------------------------------------------------------------------*/
+int Transport::numRanks() const
+{
+   return( m_nRanks );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Replace a vector by the element-wise mean of that vector across all ranks
+(ring allreduce). All ranks must call this with vectors of the same size.
+
+The vector is split into one chunk per rank. In the first n - 1 steps
+(reduce-scatter), each rank passes a partial sum of one chunk on to the next
+rank, which adds its own values, so after that, each rank holds the complete
+sum of one chunk. In the next n - 1 steps (allgather), the complete sums are
+passed around the ring. Each rank sends and receives 2 * (n - 1) / n times
+the size of the vector, no matter how many ranks there are.
+
+\param v The vector
+\return true on success, false if the communication failed
+*/
+/*----------------------------------------------------------------------------*/
+bool Transport::allreduceMean( std::vector<double> &v )
+{
+   int n = m_nRanks;
+   if( n < 2 )
+   {
+      return( true );
+   }
+
+   std::vector<size_t> chunk( n + 1 );
+   for( int i = 0; i <= n; i++ )
+   {
+      chunk[i] = ( v.size() * i ) / n;
+   }
+
+   std::vector<double> buf( v.size() / n + 1 );
+
+   // Reduce-scatter
+   for( int s = 0; s < n - 1; s++ )
+   {
+      int sendChunk = ( m_Rank - s + n ) % n;
+      int recvChunk = ( m_Rank - s - 1 + n ) % n;
+      size_t nSend = chunk[sendChunk + 1] - chunk[sendChunk];
+      size_t nRecv = chunk[recvChunk + 1] - chunk[recvChunk];
+
+      if( !exchange( v.data() + chunk[sendChunk], nSend * sizeof( double ),
+                     buf.data(), nRecv * sizeof( double ) ) )
+      {
+         return( false );
+      }
+
+      for( size_t i = 0; i < nRecv; i++ )
+      {
+         v[chunk[recvChunk] + i] += buf[i];
+      }
+   }
+
+   // Allgather
+   for( int s = 0; s < n - 1; s++ )
+   {
+      int sendChunk = ( m_Rank - s + 1 + n ) % n;
+      int recvChunk = ( m_Rank - s + n ) % n;
+      size_t nSend = chunk[sendChunk + 1] - chunk[sendChunk];
+      size_t nRecv = chunk[recvChunk + 1] - chunk[recvChunk];
+
+      if( !exchange( v.data() + chunk[sendChunk], nSend * sizeof( double ),
+                     v.data() + chunk[recvChunk], nRecv * sizeof( double ) ) )
+      {
+         return( false );
+      }
+   }
+
+   for( size_t i = 0; i < v.size(); i++ )
+   {
+      v[i] /= n;
+   }
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\struct ShmTransport::Channel
+\date  2026-10-18
+A ring buffer written by one rank and read by the next one. head and tail
+count the bytes written and read so far and live on separate cache lines.
+*/
+/*----------------------------------------------------------------------------*/
+struct ShmTransport::Channel
+{
+   std::atomic<uint64_t> head;
+   char pad0[64 - sizeof( std::atomic<uint64_t> )];
+   std::atomic<uint64_t> tail;
+   char pad1[64 - sizeof( std::atomic<uint64_t> )];
+   char data[SHM_CHANNEL_BYTES];
+};
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Create the shared memory object for a ring of processes. This is done once,
+before the processes open it with the constructor.
+\param name The name of the shared memory object, starting with a slash
+\param nRanks The number of processes
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+bool ShmTransport::create( std::string name, int nRanks )
+{
+   int fd = shm_open( name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600 );
+   if( fd < 0 )
+   {
+      perror( name.c_str() );
+      return( false );
+   }
+
+   // The object is zero-filled, which is a valid initial state of all channels
+   bool ok = ftruncate( fd, (off_t)nRanks * sizeof( Channel ) ) == 0;
+   close( fd );
+
+   if( !ok )
+   {
+      shm_unlink( name.c_str() );
+   }
+
+   return( ok );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Remove the shared memory object. Processes which have opened it can still
+use it.
+\param name The name of the shared memory object
+*/
+/*----------------------------------------------------------------------------*/
+void ShmTransport::remove( std::string name )
+{
+   shm_unlink( name.c_str() );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor. Opens a shared memory object previously created with create().
+\param name The name of the shared memory object
+\param rank The index of this process within the ring
+\param nRanks The number of processes in the ring
+*/
+/*----------------------------------------------------------------------------*/
+ShmTransport::ShmTransport( std::string name, int rank, int nRanks ) :
+   Transport( rank, nRanks ),
+   m_Shm( NULL ),
+   m_Size( (size_t)nRanks * sizeof( Channel ) )
+{
+   int fd = shm_open( name.c_str(), O_RDWR, 0600 );
+   if( fd < 0 )
+   {
+      perror( name.c_str() );
+      return;
+   }
+
+   struct stat st;
+   if( fstat( fd, &st ) == 0 && st.st_size == m_Size )
+   {
+      void *p = mmap( NULL, m_Size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+      if( p != MAP_FAILED )
+      {
+         m_Shm = p;
+      }
+   }
+
+   close( fd );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Destructor
+*/
+/*----------------------------------------------------------------------------*/
+ShmTransport::~ShmTransport()
+{
+   if( m_Shm )
+   {
+      munmap( m_Shm, m_Size );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return true if the shared memory object has been opened successfully
+*/
+/*----------------------------------------------------------------------------*/
+bool ShmTransport::isOpen() const
+{
+   return( m_Shm != NULL );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param nRank The index of a rank
+\return The channel written by that rank
+*/
+/*----------------------------------------------------------------------------*/
+ShmTransport::Channel *ShmTransport::channel( int nRank )
+{
+   return( (Channel *)m_Shm + nRank );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Send a buffer to the next rank and at the same time receive a buffer from
+the previous rank. Sending and receiving are interleaved, so the ring can't
+deadlock when the buffers are larger than the channels.
+*/
+/*----------------------------------------------------------------------------*/
+bool ShmTransport::exchange( const void *sendBuf, size_t nSend, void *recvBuf, size_t nRecv )
+{
+   if( !m_Shm )
+   {
+      return( false );
+   }
+
+   Channel *out = channel( m_Rank );
+   Channel *in = channel( ( m_Rank + m_nRanks - 1 ) % m_nRanks );
+   const char *src = (const char *)sendBuf;
+   char *dst = (char *)recvBuf;
+   size_t sent = 0;
+   size_t received = 0;
+   std::chrono::steady_clock::time_point lastProgress = std::chrono::steady_clock::now();
+
+   while( sent < nSend || received < nRecv )
+   {
+      bool progress = false;
+
+      if( sent < nSend )
+      {
+         uint64_t head = out->head.load( std::memory_order_relaxed );
+         uint64_t tail = out->tail.load( std::memory_order_acquire );
+         size_t n = std::min( (size_t)( SHM_CHANNEL_BYTES - ( head - tail ) ), nSend - sent );
+         if( n > 0 )
+         {
+            size_t offset = head % SHM_CHANNEL_BYTES;
+            size_t first = std::min( n, SHM_CHANNEL_BYTES - offset );
+            memcpy( out->data + offset, src + sent, first );
+            memcpy( out->data, src + sent + first, n - first );
+            out->head.store( head + n, std::memory_order_release );
+            sent += n;
+            progress = true;
+         }
+      }
+
+      if( received < nRecv )
+      {
+         uint64_t head = in->head.load( std::memory_order_acquire );
+         uint64_t tail = in->tail.load( std::memory_order_relaxed );
+         size_t n = std::min( (size_t)( head - tail ), nRecv - received );
+         if( n > 0 )
+         {
+            size_t offset = tail % SHM_CHANNEL_BYTES;
+            size_t first = std::min( n, SHM_CHANNEL_BYTES - offset );
+            memcpy( dst + received, in->data + offset, first );
+            memcpy( dst + received + first, in->data, n - first );
+            in->tail.store( tail + n, std::memory_order_release );
+            received += n;
+            progress = true;
+         }
+      }
+
+      if( progress )
+      {
+         lastProgress = std::chrono::steady_clock::now();
+      } else
+      {
+         if( std::chrono::steady_clock::now() - lastProgress > std::chrono::seconds( TRANSPORT_TIMEOUT_S ) )
+         {
+            fprintf( stderr, "Rank %d: timeout in shared memory transport.\n", m_Rank );
+            return( false );
+         }
+         sched_yield();
+      }
+   }
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor. Listens for the connection from the previous rank and connects
+to the next rank. Returns when both connections are established, or after a
+timeout.
+\param hosts The host name of each rank
+\param basePort The port of rank 0. Rank n listens on port basePort + n.
+\param rank The index of this process within the ring
+*/
+/*----------------------------------------------------------------------------*/
+TcpTransport::TcpTransport( std::vector<std::string> hosts, int basePort, int rank ) :
+   Transport( rank, hosts.size() ),
+   m_NextFd( -1 ),
+   m_PrevFd( -1 )
+{
+   if( m_nRanks < 2 )
+   {
+      return;
+   }
+
+   int listenFd = socket( AF_INET, SOCK_STREAM, 0 );
+   int one = 1;
+   setsockopt( listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof( one ) );
+
+   struct sockaddr_in addr;
+   memset( &addr, 0, sizeof( addr ) );
+   addr.sin_family = AF_INET;
+   addr.sin_addr.s_addr = htonl( INADDR_ANY );
+   addr.sin_port = htons( basePort + m_Rank );
+   if( bind( listenFd, (struct sockaddr *)&addr, sizeof( addr ) ) < 0 || listen( listenFd, 1 ) < 0 )
+   {
+      perror( "TcpTransport" );
+      close( listenFd );
+      return;
+   }
+
+   // Connect to the next rank, which may not be listening yet
+   int next = ( m_Rank + 1 ) % m_nRanks;
+   std::string port = std::to_string( basePort + next );
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+   while( m_NextFd < 0 && std::chrono::steady_clock::now() - start < std::chrono::seconds( TRANSPORT_TIMEOUT_S ) )
+   {
+      struct addrinfo hints;
+      struct addrinfo *res = NULL;
+      memset( &hints, 0, sizeof( hints ) );
+      hints.ai_family = AF_INET;
+      hints.ai_socktype = SOCK_STREAM;
+      if( getaddrinfo( hosts[next].c_str(), port.c_str(), &hints, &res ) == 0 )
+      {
+         int fd = socket( AF_INET, SOCK_STREAM, 0 );
+         if( connect( fd, res->ai_addr, res->ai_addrlen ) == 0 )
+         {
+            m_NextFd = fd;
+         } else
+         {
+            close( fd );
+         }
+         freeaddrinfo( res );
+      }
+
+      if( m_NextFd < 0 )
+      {
+         std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+      }
+   }
+
+   struct pollfd pfd;
+   pfd.fd = listenFd;
+   pfd.events = POLLIN;
+   if( m_NextFd >= 0 && poll( &pfd, 1, TRANSPORT_TIMEOUT_S * 1000 ) > 0 )
+   {
+      m_PrevFd = accept( listenFd, NULL, NULL );
+   }
+   close( listenFd );
+
+   if( m_NextFd < 0 || m_PrevFd < 0 )
+   {
+      fprintf( stderr, "Rank %d: couldn't connect the TCP ring.\n", m_Rank );
+      return;
+   }
+
+   setsockopt( m_NextFd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof( one ) );
+   setsockopt( m_PrevFd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof( one ) );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Destructor
+*/
+/*----------------------------------------------------------------------------*/
+TcpTransport::~TcpTransport()
+{
+   if( m_NextFd >= 0 )
+   {
+      close( m_NextFd );
+   }
+   if( m_PrevFd >= 0 )
+   {
+      close( m_PrevFd );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return true if the ring is connected, or if there's only one rank
+*/
+/*----------------------------------------------------------------------------*/
+bool TcpTransport::isOpen() const
+{
+   return( m_nRanks < 2 || ( m_NextFd >= 0 && m_PrevFd >= 0 ) );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Send a buffer to the next rank and at the same time receive a buffer from
+the previous rank. Sending and receiving are interleaved, so the ring can't
+deadlock when the buffers are larger than the socket buffers.
+*/
+/*----------------------------------------------------------------------------*/
+bool TcpTransport::exchange( const void *sendBuf, size_t nSend, void *recvBuf, size_t nRecv )
+{
+   if( !isOpen() )
+   {
+      return( false );
+   }
+
+   const char *src = (const char *)sendBuf;
+   char *dst = (char *)recvBuf;
+   size_t sent = 0;
+   size_t received = 0;
+
+   while( sent < nSend || received < nRecv )
+   {
+      struct pollfd pfd[2];
+      pfd[0].fd = sent < nSend ? m_NextFd : -1;
+      pfd[0].events = POLLOUT;
+      pfd[1].fd = received < nRecv ? m_PrevFd : -1;
+      pfd[1].events = POLLIN;
+
+      int r = poll( pfd, 2, TRANSPORT_TIMEOUT_S * 1000 );
+      if( r < 0 && errno == EINTR )
+      {
+         continue;
+      }
+      if( r <= 0 )
+      {
+         fprintf( stderr, "Rank %d: timeout in TCP transport.\n", m_Rank );
+         return( false );
+      }
+
+      if( pfd[0].revents & ( POLLOUT | POLLERR | POLLHUP ) )
+      {
+         ssize_t n = send( m_NextFd, src + sent, nSend - sent, MSG_DONTWAIT | MSG_NOSIGNAL );
+         if( n < 0 && errno != EAGAIN && errno != EINTR )
+         {
+            return( false );
+         }
+         if( n > 0 )
+         {
+            sent += n;
+         }
+      }
+
+      if( pfd[1].revents & ( POLLIN | POLLERR | POLLHUP ) )
+      {
+         ssize_t n = recv( m_PrevFd, dst + received, nRecv - received, MSG_DONTWAIT );
+         if( n == 0 || ( n < 0 && errno != EAGAIN && errno != EINTR ) )
+         {
+            return( false );
+         }
+         if( n > 0 )
+         {
+            received += n;
+         }
+      }
+   }
+
+   return( true );
+}
@@ -0,0 +1,124 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file Transport.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for class Transport and its implementations
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __TRANSPORT_H__
+#define __TRANSPORT_H__
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+/*----------------------------------------------------------------------------*/
+/*!
+\class Transport
+\date  2026-10-18
+
+Connects a number of processes (ranks) in a ring, where each rank sends to
+the next rank and receives from the previous one. This is all that's needed
+for a ring allreduce, which is implemented on top of it.
+*/
+/*----------------------------------------------------------------------------*/
+class Transport
+{
+public:
+   Transport( int rank, int nRanks );
+   virtual ~Transport();
+
+   int rank() const;
+   int numRanks() const;
+   bool allreduceMean( std::vector<double> &v );
+
+protected:
+   virtual bool exchange( const void *sendBuf, size_t nSend, void *recvBuf, size_t nRecv ) = 0;
+
+protected:
+   int m_Rank;
+   int m_nRanks;
+};
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\class ShmTransport
+\date  2026-10-18
+
+A Transport between processes on the same host, based on a POSIX shared
+memory object which holds one single-producer/single-consumer ring buffer for
+each rank.
+*/
+/*----------------------------------------------------------------------------*/
+class ShmTransport : public Transport
+{
+public:
+   ShmTransport( std::string name, int rank, int nRanks );
+   virtual ~ShmTransport();
+
+   bool isOpen() const;
+
+   static bool create( std::string name, int nRanks );
+   static void remove( std::string name );
+
+protected:
+   virtual bool exchange( const void *sendBuf, size_t nSend, void *recvBuf, size_t nRecv );
+
+private:
+   struct Channel;
+
+   Channel *channel( int nRank );
+
+private:
+   void *m_Shm;
+   size_t m_Size;
+};
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\class TcpTransport
+\date  2026-10-18
+
+A Transport based on TCP connections, so the ranks may be spread across
+several hosts. Rank n listens on port basePort + n of hosts[n].
+*/
+/*----------------------------------------------------------------------------*/
+class TcpTransport : public Transport
+{
+public:
+   TcpTransport( std::vector<std::string> hosts, int basePort, int rank );
+   virtual ~TcpTransport();
+
+   bool isOpen() const;
+
+protected:
+   virtual bool exchange( const void *sendBuf, size_t nSend, void *recvBuf, size_t nRecv );
+
+private:
+   int m_NextFd;
+   int m_PrevFd;
+};
+
+#endif
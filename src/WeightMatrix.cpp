@@ -0,0 +1,274 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file WeightMatrix.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Implementation of the class WeightMatrix.
+*/
+/*----------------------------------------------------------------------------*/
+#include <string.h>
+
+#include <utility>
+
+#include "ThreadPool.h"
+#include "WeightMatrix.h"
+#include "kernel.h"
+
+// Rows are padded to a multiple of a cache line
+#define CACHE_LINE_DOUBLES ( 64 / sizeof( double ) )
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor for an empty matrix
+*/
+/*----------------------------------------------------------------------------*/
+WeightMatrix::WeightMatrix() :
+   m_Data( NULL ),
+   m_Rows( 0 ),
+   m_Cols( 0 ),
+   m_Stride( 0 )
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor
+\param rows The number of rows, i.e. neurons
+\param cols The number of columns, i.e. inputs of each neuron
+*/
+/*----------------------------------------------------------------------------*/
+WeightMatrix::WeightMatrix( int rows, int cols ) :
+   WeightMatrix()
+{
+   allocate( rows, cols );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Constructor for a view of storage owned by someone else, which must outlive
+the matrix. The storage isn't touched, see clear().
+\param data The storage, storageSize( rows, cols ) bytes starting on a cache
+line boundary
+\param rows The number of rows, i.e. neurons
+\param cols The number of columns, i.e. inputs of each neuron
+*/
+/*----------------------------------------------------------------------------*/
+WeightMatrix::WeightMatrix( double *data, int rows, int cols ) :
+   m_Data( data ),
+   m_Rows( rows ),
+   m_Cols( cols ),
+   m_Stride( storageSize( 1, cols ) / sizeof( double ) )
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Copy constructor
+*/
+/*----------------------------------------------------------------------------*/
+WeightMatrix::WeightMatrix( const WeightMatrix &other ) :
+   WeightMatrix()
+{
+   *this = other;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Move constructor
+*/
+/*----------------------------------------------------------------------------*/
+WeightMatrix::WeightMatrix( WeightMatrix &&other ) noexcept :
+   WeightMatrix()
+{
+   *this = std::move( other );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Destructor
+*/
+/*----------------------------------------------------------------------------*/
+WeightMatrix::~WeightMatrix()
+{
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Copy the weights of another matrix into newly allocated storage.
+*/
+/*----------------------------------------------------------------------------*/
+WeightMatrix &WeightMatrix::operator=( const WeightMatrix &other )
+{
+   if( this != &other )
+   {
+      allocate( other.m_Rows, other.m_Cols );
+      if( m_Rows > 0 )
+      {
+         memcpy( m_Data, other.m_Data, storageSize( m_Rows, m_Cols ) );
+      }
+   }
+
+   return( *this );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Take over the storage of another matrix, leaving the other one empty.
+*/
+/*----------------------------------------------------------------------------*/
+WeightMatrix &WeightMatrix::operator=( WeightMatrix &&other ) noexcept
+{
+   if( this != &other )
+   {
+      m_Storage = std::move( other.m_Storage );
+      m_Data = other.m_Data;
+      m_Rows = other.m_Rows;
+      m_Cols = other.m_Cols;
+      m_Stride = other.m_Stride;
+
+      other.m_Data = NULL;
+      other.m_Rows = 0;
+      other.m_Cols = 0;
+      other.m_Stride = 0;
+   }
+
+   return( *this );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Allocate zeroed storage for a matrix, see Arena and clear().
+\param rows The number of rows
+\param cols The number of columns
+*/
+/*----------------------------------------------------------------------------*/
+void WeightMatrix::allocate( int rows, int cols )
+{
+   m_Storage = Arena( storageSize( rows, cols ) );
+   m_Data = (double *)m_Storage.data();
+   m_Rows = rows;
+   m_Cols = cols;
+   m_Stride = storageSize( 1, cols ) / sizeof( double );
+   clear();
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Zero all weights. Each worker of the ThreadPool zeroes the rows which the
+layer kernels assign to it. Since the pages of an anonymous mapping are only
+allocated when they are touched first, they end up on the NUMA node of the
+worker which is going to use them.
+*/
+/*----------------------------------------------------------------------------*/
+void WeightMatrix::clear()
+{
+   ThreadPool &pool = ThreadPool::instance();
+   pool.run( [this, &pool]( int nThread )
+   {
+      int begin, end;
+      kernel::partition( m_Rows, pool.numThreads(), nThread, begin, end );
+      if( end > begin )
+      {
+         memset( row( begin ), 0, (size_t)( end - begin ) * m_Stride * sizeof( double ) );
+      }
+   } );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param rows The number of rows
+\param cols The number of columns
+\return The size in bytes of the storage of a matrix, with each row padded
+to a multiple of a cache line
+*/
+/*----------------------------------------------------------------------------*/
+size_t WeightMatrix::storageSize( int rows, int cols )
+{
+   return( (size_t)rows * ( ( cols + CACHE_LINE_DOUBLES - 1 ) / CACHE_LINE_DOUBLES ) * CACHE_LINE_DOUBLES * sizeof( double ) );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of rows
+*/
+/*----------------------------------------------------------------------------*/
+int WeightMatrix::rows() const
+{
+   return( m_Rows );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The number of columns
+*/
+/*----------------------------------------------------------------------------*/
+int WeightMatrix::cols() const
+{
+   return( m_Cols );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\return The distance between the starts of two rows in doubles
+*/
+/*----------------------------------------------------------------------------*/
+int WeightMatrix::stride() const
+{
+   return( m_Stride );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param r The index of the row
+\return A pointer to the first weight of the row
+*/
+/*----------------------------------------------------------------------------*/
+double *WeightMatrix::row( int r )
+{
+   return( m_Data + (size_t)r * m_Stride );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+\param r The index of the row
+\return A pointer to the first weight of the row
+*/
+/*----------------------------------------------------------------------------*/
+const double *WeightMatrix::row( int r ) const
+{
+   return( m_Data + (size_t)r * m_Stride );
+}
@@ -0,0 +1,82 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file WeightMatrix.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for class WeightMatrix
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __WEIGHTMATRIX_H__
+#define __WEIGHTMATRIX_H__
+
+#include <stddef.h>
+
+#include "Arena.h"
+
+/*----------------------------------------------------------------------------*/
+/*!
+\class WeightMatrix
+\date  2026-10-18
+
+The input weights of all neurons of a layer, one row per neuron. Each row
+starts on a cache line boundary. Large matrices are backed by transparent
+huge pages, and each part of the rows which the layer kernels assign to a
+worker thread of the ThreadPool is first touched by that worker, so it's
+allocated on that worker's NUMA node.
+
+A matrix either owns its storage or is a view of storage owned by someone
+else, such as the arena of a NeuralNetwork. Copies always own their storage.
+*/
+/*----------------------------------------------------------------------------*/
+class WeightMatrix
+{
+public:
+   WeightMatrix();
+   WeightMatrix( int rows, int cols );
+   WeightMatrix( double *data, int rows, int cols );
+   WeightMatrix( const WeightMatrix &other );
+   WeightMatrix( WeightMatrix &&other ) noexcept;
+   ~WeightMatrix();
+
+   WeightMatrix &operator=( const WeightMatrix &other );
+   WeightMatrix &operator=( WeightMatrix &&other ) noexcept;
+
+   int rows() const;
+   int cols() const;
+   int stride() const;
+   double *row( int r );
+   const double *row( int r ) const;
+   void clear();
+
+   static size_t storageSize( int rows, int cols );
+
+private:
+   void allocate( int rows, int cols );
+
+private:
+   Arena m_Storage;
+   double *m_Data;
+   int m_Rows;
+   int m_Cols;
+   int m_Stride;
+};
+
+#endif
@@ -0,0 +1,662 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file autotune.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Autotuning of the layer kernels for a network on the host, with the
+results kept in a profile file
+*/
+/*----------------------------------------------------------------------------*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <vector>
+
+#include "Random.h"
+#include "ThreadPool.h"
+#include "autotune.h"
+#include "util.h"
+
+// Each configuration is measured at least this long, for training and for
+// queries each
+#define AUTOTUNE_MIN_S 0.02
+
+// The fastest of this many measurements of a configuration counts
+#define AUTOTUNE_REPEATS 5
+
+// A candidate value replaces the best value so far only if it's faster by
+// at least this fraction, so measurement noise doesn't pick it
+#define AUTOTUNE_MIN_GAIN 0.03
+
+// The learning rate of the measured training. It's tiny, so the weights of
+// the measured network stay near their initial values.
+#define AUTOTUNE_ALPHA 1e-6
+
+namespace autotune
+{
+   // The tuned parameters, in the order they're tuned. The thread count is
+   // tuned for each width of a layer of the network.
+   enum Parameter
+   {
+      PARAM_ISA,
+      PARAM_WIDTH_THREADS,
+      PARAM_MIN_PARALLEL_WORK,
+      PARAM_COL_TILE,
+      PARAM_ROW_TILE,
+      PARAM_PREFETCH_DISTANCE,
+      NUM_PARAMS
+   };
+
+   static const char *s_ParameterNames[NUM_PARAMS] =
+   {
+      "isa", "threads", "minParallelWork", "colTile", "rowTile", "prefetchDistance"
+   };
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \param c A configuration
+   \param p A parameter
+   \param width The width of the layer the thread count is read for
+   \return The value of the parameter in the configuration
+   */
+   /*----------------------------------------------------------------------------*/
+   static long get( const kernel::Config &c, int p, int width )
+   {
+      switch( p )
+      {
+         case PARAM_ISA:
+            return( c.isa );
+         case PARAM_WIDTH_THREADS:
+         {
+            std::map<int, int>::const_iterator limit = c.widthThreads.find( width );
+            return( limit != c.widthThreads.end() ? limit->second : 0 );
+         }
+         case PARAM_MIN_PARALLEL_WORK:
+            return( c.minParallelWork );
+         case PARAM_COL_TILE:
+            return( c.colTile );
+         case PARAM_ROW_TILE:
+            return( c.rowTile );
+         default:
+            return( c.prefetchDistance );
+      }
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \param c A configuration
+   \param p A parameter
+   \param width The width of the layer the thread count is set for
+   \param value The new value of the parameter in the configuration. A thread
+   count of 0 removes the limit for the width.
+   */
+   /*----------------------------------------------------------------------------*/
+   static void set( kernel::Config &c, int p, int width, long value )
+   {
+      switch( p )
+      {
+         case PARAM_ISA:
+            c.isa = (kernel::Isa)value;
+            break;
+         case PARAM_WIDTH_THREADS:
+            if( value > 0 )
+            {
+               c.widthThreads[width] = value;
+            } else
+            {
+               c.widthThreads.erase( width );
+            }
+            break;
+         case PARAM_MIN_PARALLEL_WORK:
+            c.minParallelWork = value;
+            break;
+         case PARAM_COL_TILE:
+            c.colTile = value;
+            break;
+         case PARAM_ROW_TILE:
+            c.rowTile = value;
+            break;
+         default:
+            c.prefetchDistance = value;
+            break;
+      }
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \param nn The network
+   \param c The configuration the candidates are derived from
+   \param p A parameter
+   \return The candidate values of the parameter. Parameters which make no
+   difference on the host or for the network have no candidates.
+   */
+   /*----------------------------------------------------------------------------*/
+   static std::vector<long> candidates( const NeuralNetwork &nn, const kernel::Config &c, int p )
+   {
+      std::vector<long> values;
+      int nThreads = ThreadPool::instance().numThreads();
+
+      switch( p )
+      {
+         case PARAM_ISA:
+            for( int i = 1; i < nn.numLayers(); i++ )
+            {
+               if( nn.weightFormat( i ) != HalfMatrix::FORMAT_NONE )
+               {
+                  for( int isa = kernel::ISA_SCALAR; isa <= kernel::bestIsa(); isa++ )
+                  {
+                     values.push_back( isa );
+                  }
+                  break;
+               }
+            }
+            break;
+         case PARAM_WIDTH_THREADS:
+            for( int n = 1; n < nThreads && nThreads > 1; n *= 2 )
+            {
+               values.push_back( n );
+            }
+            if( nThreads > 1 )
+            {
+               values.push_back( 0 );
+            }
+            break;
+         case PARAM_MIN_PARALLEL_WORK:
+            for( long n = 1 << 12; n <= ( 1 << 20 ) && nThreads > 1; n *= 4 )
+            {
+               values.push_back( n );
+            }
+            break;
+         case PARAM_COL_TILE:
+         case PARAM_ROW_TILE:
+            // Multiples of 8, so they are multiples of a row group as well
+            for( int shift = -2; shift <= 2; shift++ )
+            {
+               long v = get( c, p, 0 );
+               v = shift < 0 ? v >> -shift : v << shift;
+               values.push_back( std::max( p == PARAM_COL_TILE ? 64L : 8L, v & ~7L ) );
+            }
+            break;
+         default:
+            values = { 0, 32, 64, 128, 256 };
+            break;
+      }
+
+      return( values );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \param nn The network
+   \param p A parameter
+   \return The widths of the layers the parameter is tuned for: each distinct
+   number of rows of the layers with weights for the thread count, a single
+   placeholder for the other parameters
+   */
+   /*----------------------------------------------------------------------------*/
+   static std::vector<int> tunedWidths( const NeuralNetwork &nn, int p )
+   {
+      std::vector<int> widths;
+      if( p != PARAM_WIDTH_THREADS )
+      {
+         widths.push_back( 0 );
+         return( widths );
+      }
+
+      for( int i = 1; i < nn.numLayers(); i++ )
+      {
+         int rows = nn.weights( i ).rows();
+         if( rows > 0 && std::find( widths.begin(), widths.end(), rows ) == widths.end() )
+         {
+            widths.push_back( rows );
+         }
+      }
+
+      return( widths );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Measure the kernels with the current configuration.
+   \param nn The network, which is trained with a tiny learning rate
+   \param batch The synthetic input vectors
+   \param expected The synthetic expected output vector
+   \return The seconds per training sample plus the seconds per sample of
+   batched queries, the fastest of several measurements
+   */
+   /*----------------------------------------------------------------------------*/
+   static double measure( NeuralNetwork &nn, const std::vector<std::vector<double> > &batch, const std::vector<double> &expected )
+   {
+      std::vector<std::vector<double> > outputs;
+      double best = INFINITY;
+
+      for( int r = 0; r < AUTOTUNE_REPEATS; r++ )
+      {
+         long nTrain = 0;
+         double trainSeconds = 0.0;
+         std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+         while( trainSeconds < AUTOTUNE_MIN_S )
+         {
+            nn.train( batch[nTrain % batch.size()], expected, AUTOTUNE_ALPHA );
+            nTrain++;
+            trainSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+         }
+
+         long nQueries = 0;
+         double querySeconds = 0.0;
+         start = std::chrono::steady_clock::now();
+         while( querySeconds < AUTOTUNE_MIN_S )
+         {
+            nn.query( batch, outputs );
+            nQueries += batch.size();
+            querySeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+         }
+
+         best = std::min( best, trainSeconds / nTrain + querySeconds / nQueries );
+      }
+
+      return( best );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \return The CPU model and the number of CPUs of the host
+   */
+   /*----------------------------------------------------------------------------*/
+   std::string hostKey()
+   {
+      std::string model = "unknown CPU";
+      std::ifstream cpuinfo( "/proc/cpuinfo" );
+      std::string line;
+      while( std::getline( cpuinfo, line ) )
+      {
+         size_t colon = line.find( ':' );
+         size_t begin = line.find_first_not_of( " \t", colon + 1 );
+         if( line.compare( 0, 10, "model name" ) == 0 && colon != std::string::npos && begin != std::string::npos )
+         {
+            model = line.substr( begin );
+            break;
+         }
+      }
+
+      return( model + ", " + std::to_string( ThreadPool::instance().numThreads() ) + " CPUs" );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \param nn A network
+   \param batchSize The number of samples per query
+   \return The layers of the network, the formats of their weights and the
+   batch size
+   */
+   /*----------------------------------------------------------------------------*/
+   std::string networkKey( const NeuralNetwork &nn, int batchSize )
+   {
+      std::string key;
+      for( int i = 0; i < nn.numLayers(); i++ )
+      {
+         key += ( i > 0 ? "," : "" ) + nn.layer( i ).toString();
+         if( i > 0 && nn.weightFormat( i ) != HalfMatrix::FORMAT_NONE )
+         {
+            key += std::string( "/" ) + HalfMatrix::formatName( nn.weightFormat( i ) );
+         }
+      }
+
+      return( key + " batch " + std::to_string( batchSize ) );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \return The name of the profile file in the home directory of the user
+   */
+   /*----------------------------------------------------------------------------*/
+   std::string defaultProfile()
+   {
+      const char *home = getenv( "HOME" );
+      return( std::string( home ? home : "." ) + "/.NeuralNetwork.profile" );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Tune the layer kernels for a network by measuring training and batched
+   queries of a copy of it with synthetic samples. Starting with the current
+   configuration, the candidate values of one parameter after another are
+   tried, and the fastest value of each parameter is kept for the following
+   ones. The thread count is tuned for one layer width after another, from
+   the first layer on. The current configuration is left unaltered.
+   \param nn The network
+   \param batchSize The number of samples per query
+   \param best Receives the fastest configuration
+   \param verbose If true, print the measurement of each candidate
+   */
+   /*----------------------------------------------------------------------------*/
+   void tune( const NeuralNetwork &nn, int batchSize, kernel::Config &best, bool verbose )
+   {
+      kernel::Config &config = kernel::config();
+      kernel::Config saved = config;
+      NeuralNetwork scratch = nn;
+
+      Random rng( 0, 0 );
+      std::vector<std::vector<double> > batch( std::max( 1, batchSize ), std::vector<double>( nn.numNeurons( 0 ) ) );
+      for( int s = 0; s < batch.size(); s++ )
+      {
+         for( int i = 0; i < batch[s].size(); i++ )
+         {
+            batch[s][i] = rng.uniform( 0.01, 1.0 );
+         }
+      }
+      std::vector<double> expected( nn.numNeurons( nn.numLayers() - 1 ), 0.01 );
+      if( !expected.empty() )
+      {
+         expected[0] = 0.99;
+      }
+
+      best = config;
+      double bestSeconds = measure( scratch, batch, expected );
+      if( verbose )
+      {
+         printf( "%-18s %10s %12s\n", "parameter", "value", "us/sample" );
+         printf( "%-18s %10s %12.2f\n", "current", "-", bestSeconds * 1e6 );
+      }
+
+      for( int p = 0; p < NUM_PARAMS; p++ )
+      {
+         std::vector<int> widths = tunedWidths( nn, p );
+         for( int w = 0; w < (int)widths.size(); w++ )
+         {
+            std::string name = s_ParameterNames[p];
+            if( p == PARAM_WIDTH_THREADS )
+            {
+               name += " width " + std::to_string( widths[w] );
+            }
+
+            std::vector<long> values = candidates( nn, best, p );
+            long bestValue = get( best, p, widths[w] );
+            for( int v = 0; v < (int)values.size(); v++ )
+            {
+               if( values[v] == bestValue )
+               {
+                  continue;
+               }
+
+               config = best;
+               set( config, p, widths[w], values[v] );
+               double seconds = measure( scratch, batch, expected );
+               if( verbose )
+               {
+                  printf( "%-18s %10s %12.2f\n", name.c_str(),
+                          p == PARAM_ISA ? kernel::isaName( (kernel::Isa)values[v] ) : std::to_string( values[v] ).c_str(),
+                          seconds * 1e6 );
+               }
+               if( seconds < bestSeconds * ( 1.0 - AUTOTUNE_MIN_GAIN ) )
+               {
+                  bestSeconds = seconds;
+                  bestValue = values[v];
+               }
+            }
+            set( best, p, widths[w], bestValue );
+         }
+      }
+
+      config = saved;
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \param widthThreads The thread counts by layer width
+   \return The thread counts as a list of width:threads, "-" if there are none
+   */
+   /*----------------------------------------------------------------------------*/
+   static std::string formatWidthThreads( const std::map<int, int> &widthThreads )
+   {
+      std::string s;
+      for( std::map<int, int>::const_iterator i = widthThreads.begin(); i != widthThreads.end(); i++ )
+      {
+         s += ( s.empty() ? "" : "," ) + std::to_string( i->first ) + ":" + std::to_string( i->second );
+      }
+
+      return( s.empty() ? "-" : s );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \param s A list of width:threads as written by formatWidthThreads()
+   \param widthThreads Receives the thread counts by layer width
+   \return true on success, false if the list is malformed
+   */
+   /*----------------------------------------------------------------------------*/
+   static bool parseWidthThreads( const std::string &s, std::map<int, int> &widthThreads )
+   {
+      widthThreads.clear();
+      if( s == "-" )
+      {
+         return( true );
+      }
+
+      std::vector<std::string> items = util::strsplit( s, ",", false );
+      for( int i = 0; i < (int)items.size(); i++ )
+      {
+         int width, threads;
+         if( sscanf( items[i].c_str(), "%d:%d", &width, &threads ) != 2 || width < 1 || threads < 1 )
+         {
+            return( false );
+         }
+         widthThreads[width] = threads;
+      }
+
+      return( true );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Load a configuration from a profile file. Each line of the file holds the
+   key of a host and a network, a tab and the configuration.
+   \param filename The name of the profile file
+   \param key The key of the host and the network
+   \param config Receives the configuration
+   \return true on success, false if the file doesn't have a configuration
+   for the key
+   */
+   /*----------------------------------------------------------------------------*/
+   bool loadProfile( std::string filename, std::string key, kernel::Config &config )
+   {
+      std::ifstream file( filename );
+      std::string line;
+      while( std::getline( file, line ) )
+      {
+         size_t tab = line.find( '\t' );
+         if( line.empty() || line[0] == '#' || tab == std::string::npos || line.substr( 0, tab ) != key )
+         {
+            continue;
+         }
+
+         // Profiles written before the thread counts were tuned by width
+         // end after the instruction set
+         kernel::Config c = config;
+         char isa[32];
+         char widthThreads[256] = "-";
+         if( sscanf( line.c_str() + tab + 1, "%d %d %d %ld %d %31s %255s", &c.colTile, &c.rowTile, &c.prefetchDistance,
+                     &c.minParallelWork, &c.maxThreads, isa, widthThreads ) < 6 || c.colTile < 8 || c.rowTile < 8 ||
+             !parseWidthThreads( widthThreads, c.widthThreads ) )
+         {
+            return( false );
+         }
+
+         c.isa = kernel::ISA_SCALAR;
+         for( int i = kernel::ISA_SCALAR; i <= kernel::bestIsa(); i++ )
+         {
+            if( std::string( isa ) == kernel::isaName( (kernel::Isa)i ) )
+            {
+               c.isa = (kernel::Isa)i;
+            }
+         }
+
+         config = c;
+         return( true );
+      }
+
+      return( false );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Save a configuration to a profile file, replacing the configuration of
+   the same key if there is one and keeping the others.
+   \param filename The name of the profile file
+   \param key The key of the host and the network
+   \param config The configuration
+   \return true on success, false if the file couldn't be written
+   */
+   /*----------------------------------------------------------------------------*/
+   bool saveProfile( std::string filename, std::string key, const kernel::Config &config )
+   {
+      std::vector<std::string> lines;
+      std::ifstream in( filename );
+      std::string line;
+      while( std::getline( in, line ) )
+      {
+         if( line.compare( 0, key.size() + 1, key + "\t" ) != 0 )
+         {
+            lines.push_back( line );
+         }
+      }
+      in.close();
+      if( lines.empty() )
+      {
+         lines.push_back( "# Kernel configurations of NeuralNetwork: host, network, batch size<TAB>"
+                          "colTile rowTile prefetchDistance minParallelWork maxThreads isa width:threads,.." );
+      }
+
+      char values[128];
+      snprintf( values, sizeof( values ), "\t%d %d %d %ld %d %s ", config.colTile, config.rowTile, config.prefetchDistance,
+                config.minParallelWork, config.maxThreads, kernel::isaName( config.isa ) );
+      lines.push_back( key + values + formatWidthThreads( config.widthThreads ) );
+
+      // Replace the file at once, so a concurrent run never reads half of it.
+      // Each run writes its own temporary file, so concurrent tunes don't
+      // write into each other's; the last one to finish wins.
+      std::vector<char> tmpname( filename.begin(), filename.end() );
+      const char *suffix = ".XXXXXX";
+      tmpname.insert( tmpname.end(), suffix, suffix + strlen( suffix ) + 1 );
+      int fd = mkstemp( tmpname.data() );
+      if( fd < 0 )
+      {
+         return( false );
+      }
+      fchmod( fd, 0644 );
+
+      FILE *out = fdopen( fd, "w" );
+      if( out == NULL )
+      {
+         close( fd );
+         unlink( tmpname.data() );
+         return( false );
+      }
+
+      bool ok = true;
+      for( int i = 0; ok && i < (int)lines.size(); i++ )
+      {
+         ok = fprintf( out, "%s\n", lines[i].c_str() ) >= 0;
+      }
+      ok = fclose( out ) == 0 && ok;
+
+      if( !ok || rename( tmpname.data(), filename.c_str() ) != 0 )
+      {
+         unlink( tmpname.data() );
+         return( false );
+      }
+
+      return( true );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Configure the layer kernels for a network on this host. If the profile
+   file has a configuration for the host and the network, it's used right
+   away. Otherwise the kernels are tuned and the result is added to the
+   profile file.
+   \param nn The network
+   \param batchSize The number of samples per query
+   \param filename The name of the profile file
+   \param verbose If true, print the measurements and the configuration
+   */
+   /*----------------------------------------------------------------------------*/
+   void configure( const NeuralNetwork &nn, int batchSize, std::string filename, bool verbose )
+   {
+      std::string key = hostKey() + ", " + networkKey( nn, batchSize );
+      kernel::Config c = kernel::config();
+
+      if( loadProfile( filename, key, c ) )
+      {
+         if( verbose )
+         {
+            printf( "Loaded kernel profile for %s from '%s'.\n", key.c_str(), filename.c_str() );
+         }
+      } else
+      {
+         if( verbose )
+         {
+            printf( "Tuning the kernels for %s..\n", key.c_str() );
+         }
+         tune( nn, batchSize, c, verbose );
+         if( !saveProfile( filename, key, c ) )
+         {
+            fprintf( stderr, "Couldn't save kernel profile '%s'.\n", filename.c_str() );
+         } else
+         if( verbose )
+         {
+            printf( "Saved kernel profile to '%s'.\n", filename.c_str() );
+         }
+      }
+
+      kernel::config() = c;
+      if( verbose )
+      {
+         printf( "Kernels: %d x %d tiles, prefetch distance %d, parallel from %ld multiplications on %d threads "
+                 "(by width: %s), %s\n",
+                 c.rowTile, c.colTile, c.prefetchDistance, c.minParallelWork,
+                 c.maxThreads > 0 ? c.maxThreads : ThreadPool::instance().numThreads(),
+                 formatWidthThreads( c.widthThreads ).c_str(), kernel::isaName( c.isa ) );
+      }
+   }
+}
@@ -0,0 +1,46 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file autotune.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for the autotuning of the layer kernels
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __AUTOTUNE_H__
+#define __AUTOTUNE_H__
+
+#include <string>
+
+#include "NeuralNetwork.h"
+#include "kernel.h"
+
+namespace autotune
+{
+   std::string hostKey();
+   std::string networkKey( const NeuralNetwork &nn, int batchSize );
+   std::string defaultProfile();
+   void tune( const NeuralNetwork &nn, int batchSize, kernel::Config &best, bool verbose );
+   bool loadProfile( std::string filename, std::string key, kernel::Config &config );
+   bool saveProfile( std::string filename, std::string key, const kernel::Config &config );
+   void configure( const NeuralNetwork &nn, int batchSize, std::string filename, bool verbose );
+}
+
+#endif
@@ -0,0 +1,160 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file bench.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Micro benchmarks of the layer kernels
+*/
+/*----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "HalfMatrix.h"
+#include "Random.h"
+#include "ThreadPool.h"
+#include "WeightMatrix.h"
+#include "bench.h"
+#include "kernel.h"
+
+// Each measurement is repeated for at least this long
+#define MIN_MEASUREMENT_S 0.2
+
+namespace bench
+{
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Measure the throughput of the layer kernel.
+   \param w The weights, either a WeightMatrix or a HalfMatrix
+   \param in The input vectors
+   \param nSamples The number of input vectors
+   \param out Receives the weighted sums
+   \return The achieved GFLOP/s
+   */
+   /*----------------------------------------------------------------------------*/
+   template<class Matrix>
+   static double measure( const Matrix &w, const std::vector<double> &in, int nSamples, std::vector<double> &out )
+   {
+      // Warm up
+      kernel::weightedSums( w, in.data(), nSamples, out.data() );
+
+      long n = 0;
+      double elapsed = 0.0;
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      while( elapsed < MIN_MEASUREMENT_S )
+      {
+         kernel::weightedSums( w, in.data(), nSamples, out.data() );
+         n++;
+         elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+      }
+
+      double flops = 2.0 * w.rows() * w.cols() * nSamples * n;
+      return( flops / elapsed * 1e-9 );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \param bytes A size in bytes
+   \return The smallest cache level the size fits into
+   */
+   /*----------------------------------------------------------------------------*/
+   static const char *cacheLevel( double bytes )
+   {
+      if( bytes <= sysconf( _SC_LEVEL2_CACHE_SIZE ) )
+      {
+         return( "L2" );
+      } else
+      if( bytes <= sysconf( _SC_LEVEL3_CACHE_SIZE ) )
+      {
+         return( "L3" );
+      } else
+      {
+         return( "DRAM" );
+      }
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Sweep square layers from 256 x 256 up to maxWidth x maxWidth and print the
+   throughput of the layer kernel for single samples and for batches, the
+   latter with and without cache blocking, and for single samples with
+   bfloat16 and half precision weights.
+   \param maxWidth The width of the largest layer
+   \param batchSize The number of samples per batch
+   */
+   /*----------------------------------------------------------------------------*/
+   void layerSweep( int maxWidth, int batchSize )
+   {
+      kernel::Config &config = kernel::config();
+      kernel::Config tiled = config;
+
+      printf( "L1d: %ld KiB, L2: %ld KiB, L3: %ld KiB, %d threads (%d pinned)\n",
+         sysconf( _SC_LEVEL1_DCACHE_SIZE ) / 1024,
+         sysconf( _SC_LEVEL2_CACHE_SIZE ) / 1024,
+         sysconf( _SC_LEVEL3_CACHE_SIZE ) / 1024,
+         ThreadPool::instance().numThreads(), ThreadPool::instance().numPinned() );
+      printf( "Tiles: %d rows x %d columns, prefetch distance %d\n",
+         tiled.rowTile, tiled.colTile, tiled.prefetchDistance );
+      printf( "Half precision: %s\n\n", kernel::isaName( std::min( tiled.isa, kernel::bestIsa() ) ) );
+      printf( "%8s %10s %6s %12s %14s %14s %10s %10s\n",
+         "width", "weights", "fits", "GFLOP/s 1", "GFLOP/s batch", "untiled batch", "bf16 1", "fp16 1" );
+
+      Random rng( 0, 0 );
+      for( int width = 256; width <= maxWidth; width *= 2 )
+      {
+         WeightMatrix w( width, width );
+         for( int r = 0; r < width; r++ )
+         {
+            for( int c = 0; c < width; c++ )
+            {
+               w.row( r )[c] = rng.uniform( -0.1, 0.1 );
+            }
+         }
+
+         std::vector<double> in( (size_t)width * batchSize );
+         for( size_t i = 0; i < in.size(); i++ )
+         {
+            in[i] = rng.uniform();
+         }
+         std::vector<double> out( (size_t)width * batchSize );
+
+         double single = measure( w, in, 1, out );
+         double batched = measure( w, in, batchSize, out );
+
+         config.rowTile = width;
+         config.colTile = width;
+         double untiled = measure( w, in, batchSize, out );
+         config = tiled;
+
+         double bf16 = measure( HalfMatrix( w, HalfMatrix::FORMAT_BF16 ), in, 1, out );
+         double fp16 = measure( HalfMatrix( w, HalfMatrix::FORMAT_FP16 ), in, 1, out );
+
+         double bytes = (double)w.rows() * w.stride() * sizeof( double );
+         printf( "%8d %8.1f MB %6s %12.2f %14.2f %14.2f %10.2f %10.2f\n",
+            width, bytes / ( 1024.0 * 1024.0 ), cacheLevel( bytes ), single, batched, untiled, bf16, fp16 );
+      }
+   }
+}
@@ -0,0 +1,1100 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file kernel.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief The layer kernels, which calculate the weighted sums of the inputs of
+all neurons of a layer for a batch of samples, and their counterparts for
+backpropagation.
+*/
+/*----------------------------------------------------------------------------*/
+#include <immintrin.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "kernel.h"
+
+// Rows are processed in groups of this size, and the rows of a layer are
+// split across threads in multiples of it
+#define ROW_GROUP 4
+
+typedef double v4d __attribute__(( vector_size( 4 * sizeof( double ) ) ));
+
+// Load 4 doubles from an address which is only aligned to a double
+typedef double v4du __attribute__(( vector_size( 4 * sizeof( double ) ), aligned( sizeof( double ) ) ));
+#define load4( p ) ( *(const v4du *)( p ) )
+#define store4( p, v ) ( *(v4du *)( p ) = ( v ) )
+
+namespace kernel
+{
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \param name The sysconf() name of a cache size
+   \param fallback The size to assume if the cache size can't be determined
+   \return The cache size in bytes
+   */
+   /*----------------------------------------------------------------------------*/
+   static long cacheSize( int name, long fallback )
+   {
+      long size = sysconf( name );
+      return( size > 0 ? size : fallback );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \return The default configuration for this host: a column block fills half
+   of L1 and a block of weights fills half of L2.
+   */
+   /*----------------------------------------------------------------------------*/
+   static Config defaultConfig()
+   {
+      Config c;
+
+      long l1 = cacheSize( _SC_LEVEL1_DCACHE_SIZE, 32 * 1024 );
+      long l2 = cacheSize( _SC_LEVEL2_CACHE_SIZE, 256 * 1024 );
+
+      c.colTile = ( l1 / 2 / sizeof( double ) ) & ~7;
+      if( c.colTile < 64 )
+      {
+         c.colTile = 64;
+      }
+
+      c.rowTile = ( ( l2 / 2 ) / ( c.colTile * sizeof( double ) ) ) & ~( ROW_GROUP - 1 );
+      if( c.rowTile < ROW_GROUP )
+      {
+         c.rowTile = ROW_GROUP;
+      }
+
+      // Waking the ThreadPool costs several microseconds, more than a single
+      // sample of a 784x100 layer (78,400 multiplications) takes on one thread
+      c.prefetchDistance = 64;
+      c.minParallelWork = 1 << 18;
+      c.maxThreads = 0;
+      c.isa = bestIsa();
+
+      return( c );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \return The best instruction set for half precision weights supported by the
+   host: AVX-512 converts 16 weights at a time, AVX2 with F16C 8 at a time.
+   */
+   /*----------------------------------------------------------------------------*/
+   Isa bestIsa()
+   {
+      static Isa isa = __builtin_cpu_supports( "avx512f" ) ? ISA_AVX512 :
+                       __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" ) &&
+                       __builtin_cpu_supports( "f16c" ) ? ISA_AVX2 : ISA_SCALAR;
+      return( isa );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \param isa An instruction set
+   \return The name of the instruction set
+   */
+   /*----------------------------------------------------------------------------*/
+   const char *isaName( Isa isa )
+   {
+      switch( isa )
+      {
+         case ISA_AVX512:
+            return( "avx512" );
+         case ISA_AVX2:
+            return( "avx2" );
+         default:
+            return( "scalar" );
+      }
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \return The configuration used by the kernels. It may be modified before
+   the kernels are used.
+   */
+   /*----------------------------------------------------------------------------*/
+   Config &config()
+   {
+      static Config c = defaultConfig();
+      return( c );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \param work The number of multiplications of a layer pass
+   \param rows The width of the layer
+   \return The number of threads of the ThreadPool to split the layer pass
+   across, at most config().maxThreads and the limit of config().widthThreads
+   for the width, or 1 if it isn't worth splitting
+   */
+   /*----------------------------------------------------------------------------*/
+   static int numParts( long work, int rows )
+   {
+      const Config &c = config();
+      int n = ThreadPool::instance().numThreads();
+      if( c.maxThreads > 0 && c.maxThreads < n )
+      {
+         n = c.maxThreads;
+      }
+
+      std::map<int, int>::const_iterator limit = c.widthThreads.find( rows );
+      if( limit != c.widthThreads.end() && limit->second > 0 && limit->second < n )
+      {
+         n = limit->second;
+      }
+
+      return( work < c.minParallelWork ? 1 : n );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Split n rows into nParts contiguous ranges of whole row groups. The first
+   touch of a WeightMatrix splits its rows into one part per thread of the
+   ThreadPool, and the kernels assign the rows by the same split, see
+   threadRows(), so each thread works on memory of its own NUMA node.
+
+   \param n The number of rows
+   \param nParts The number of parts
+   \param nPart The index of the part
+   \param begin Receives the first row of the part
+   \param end Receives the row after the last row of the part
+   */
+   /*----------------------------------------------------------------------------*/
+   void partition( int n, int nParts, int nPart, int &begin, int &end )
+   {
+      long nGroups = ( n + ROW_GROUP - 1 ) / ROW_GROUP;
+
+      begin = ( ( nGroups * nPart ) / nParts ) * ROW_GROUP;
+      end = ( ( nGroups * ( nPart + 1 ) ) / nParts ) * ROW_GROUP;
+
+      if( begin > n )
+      {
+         begin = n;
+      }
+      if( end > n )
+      {
+         end = n;
+      }
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Assign the rows of a layer pass split into nParts parts to a thread. The
+   rows are split into one part per thread of the ThreadPool, as by the first
+   touch, and each of the first nParts threads is given a run of consecutive
+   parts. Since the workers are pinned to the CPUs in order, the rows of a
+   thread stay on its own NUMA node, or on a neighbouring one, even if
+   numParts() caps the number of threads.
+
+   \param n The number of rows
+   \param nParts The number of threads the pass is split across, at most the
+   number of threads of the ThreadPool
+   \param nThread The index of the thread
+   \param begin Receives the first row of the thread
+   \param end Receives the row after the last row of the thread
+   */
+   /*----------------------------------------------------------------------------*/
+   static void threadRows( int n, int nParts, int nThread, int &begin, int &end )
+   {
+      int nThreads = ThreadPool::instance().numThreads();
+      int first = (int)( (long)nThreads * nThread / nParts );
+      int last = (int)( (long)nThreads * ( nThread + 1 ) / nParts );
+      int unused;
+
+      partition( n, nThreads, first, begin, unused );
+      partition( n, nThreads, last - 1, unused, end );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Calculate the dot products of four rows of weights with an input vector and
+   add them to sums[0..3].
+   */
+   /*----------------------------------------------------------------------------*/
+   static inline void dot4( const double *w0, const double *w1, const double *w2, const double *w3,
+                            const double *x, int n, int pf, double *sums )
+   {
+      v4d a0 = { 0.0, 0.0, 0.0, 0.0 };
+      v4d a1 = a0;
+      v4d a2 = a0;
+      v4d a3 = a0;
+
+      int k = 0;
+      for( ; k + 8 <= n; k += 8 )
+      {
+         // One cache line of each row per iteration
+         __builtin_prefetch( w0 + k + pf );
+         __builtin_prefetch( w1 + k + pf );
+         __builtin_prefetch( w2 + k + pf );
+         __builtin_prefetch( w3 + k + pf );
+
+         v4d x0 = load4( x + k );
+         v4d x1 = load4( x + k + 4 );
+         a0 += load4( w0 + k ) * x0 + load4( w0 + k + 4 ) * x1;
+         a1 += load4( w1 + k ) * x0 + load4( w1 + k + 4 ) * x1;
+         a2 += load4( w2 + k ) * x0 + load4( w2 + k + 4 ) * x1;
+         a3 += load4( w3 + k ) * x0 + load4( w3 + k + 4 ) * x1;
+      }
+
+      double s0 = ( a0[0] + a0[1] ) + ( a0[2] + a0[3] );
+      double s1 = ( a1[0] + a1[1] ) + ( a1[2] + a1[3] );
+      double s2 = ( a2[0] + a2[1] ) + ( a2[2] + a2[3] );
+      double s3 = ( a3[0] + a3[1] ) + ( a3[2] + a3[3] );
+      for( ; k < n; k++ )
+      {
+         s0 += w0[k] * x[k];
+         s1 += w1[k] * x[k];
+         s2 += w2[k] * x[k];
+         s3 += w3[k] * x[k];
+      }
+
+      sums[0] += s0;
+      sums[1] += s1;
+      sums[2] += s2;
+      sums[3] += s3;
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Calculate the dot product of a single row of weights with an input vector.
+   */
+   /*----------------------------------------------------------------------------*/
+   static inline double dot1( const double *w, const double *x, int n )
+   {
+      double s = 0.0;
+      for( int k = 0; k < n; k++ )
+      {
+         s += w[k] * x[k];
+      }
+
+      return( s );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Add a multiple of a vector to another vector: y += a * x
+   */
+   /*----------------------------------------------------------------------------*/
+   static inline void axpy( double *y, const double *x, double a, int n )
+   {
+      v4d av = { a, a, a, a };
+
+      int k = 0;
+      for( ; k + 4 <= n; k += 4 )
+      {
+         store4( y + k, load4( y + k ) + av * load4( x + k ) );
+      }
+      for( ; k < n; k++ )
+      {
+         y[k] += a * x[k];
+      }
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Calculate the weighted sums of the inputs of a range of rows (neurons) for
+   a batch of samples.
+
+   The weights are processed in blocks of config().rowTile x config().colTile.
+   While a block is in L2, the corresponding slice of each sample's input
+   vector is loaded into L1 and multiplied with all rows of the block, four
+   rows at a time. With a single sample, there's nothing to reuse, so the
+   rows are simply streamed through with prefetching.
+
+   \param w The weights, one row per neuron
+   \param in The input vectors of the samples, w.cols() doubles each, one
+   after another
+   \param nSamples The number of samples
+   \param out Receives the weighted sums, w.rows() doubles per sample, one
+   sample after another
+   \param rowBegin The first row to calculate
+   \param rowEnd The row after the last row to calculate
+   */
+   /*----------------------------------------------------------------------------*/
+   void weightedSums( const WeightMatrix &w, const double *in, int nSamples, double *out, int rowBegin, int rowEnd )
+   {
+      const Config &c = config();
+      int nRows = w.rows();
+      int nCols = w.cols();
+      int colTile = nSamples > 1 ? c.colTile : nCols;
+
+      for( int s = 0; s < nSamples; s++ )
+      {
+         for( int r = rowBegin; r < rowEnd; r++ )
+         {
+            out[(size_t)s * nRows + r] = 0.0;
+         }
+      }
+
+      for( int r0 = rowBegin; r0 < rowEnd; r0 += c.rowTile )
+      {
+         int r1 = r0 + c.rowTile < rowEnd ? r0 + c.rowTile : rowEnd;
+
+         for( int k0 = 0; k0 < nCols; k0 += colTile )
+         {
+            int nk = k0 + colTile < nCols ? colTile : nCols - k0;
+
+            for( int s = 0; s < nSamples; s++ )
+            {
+               const double *x = in + (size_t)s * nCols + k0;
+               double *sums = out + (size_t)s * nRows;
+
+               int r = r0;
+               for( ; r + ROW_GROUP <= r1; r += ROW_GROUP )
+               {
+                  dot4( w.row( r ) + k0, w.row( r + 1 ) + k0, w.row( r + 2 ) + k0, w.row( r + 3 ) + k0,
+                        x, nk, c.prefetchDistance, sums + r );
+               }
+               for( ; r < r1; r++ )
+               {
+                  sums[r] += dot1( w.row( r ) + k0, x, nk );
+               }
+            }
+         }
+      }
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Calculate the weighted sums of the inputs of all rows (neurons) for a batch
+   of samples, split across the ThreadPool if it's worth it.
+
+   \see weightedSums( const WeightMatrix &w, const double *in, int nSamples, double *out, int rowBegin, int rowEnd )
+   */
+   /*----------------------------------------------------------------------------*/
+   void weightedSums( const WeightMatrix &w, const double *in, int nSamples, double *out )
+   {
+      ThreadPool &pool = ThreadPool::instance();
+      long work = (long)w.rows() * w.cols() * nSamples;
+      int nParts = numParts( work, w.rows() );
+
+      if( nParts < 2 )
+      {
+         weightedSums( w, in, nSamples, out, 0, w.rows() );
+         return;
+      }
+
+      pool.run( [&w, in, nSamples, out, nParts]( int nThread )
+      {
+         if( nThread >= nParts )
+         {
+            return;
+         }
+
+         int begin, end;
+         threadRows( w.rows(), nParts, nThread, begin, end );
+         weightedSums( w, in, nSamples, out, begin, end );
+      } );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Load 16 half precision weights and convert them to single precision.
+   bfloat16 is converted by shifting it into the upper half of a single.
+
+   The zero-masked forms of the intrinsics compile to the same instructions;
+   the unmasked ones pass an undefined vector as the source of the masked-off
+   elements, which GCC reports as uninitialized.
+   */
+   /*----------------------------------------------------------------------------*/
+   template<bool BF16>
+   __attribute__(( target( "avx512f" ) ))
+   static inline __m512 loadHalf16( const uint16_t *p )
+   {
+      __m256i h = _mm256_loadu_si256( (const __m256i *)p );
+      if( BF16 )
+      {
+         return( _mm512_castsi512_ps( _mm512_maskz_slli_epi32( 0xffff, _mm512_maskz_cvtepu16_epi32( 0xffff, h ), 16 ) ) );
+      } else
+      {
+         return( _mm512_maskz_cvtph_ps( 0xffff, h ) );
+      }
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \return The sum of the elements of a vector. Like loadHalf16(), this avoids
+   the intrinsics with an undefined source, which _mm512_reduce_add_ps() uses.
+   */
+   /*----------------------------------------------------------------------------*/
+   __attribute__(( target( "avx512f" ) ))
+   static inline float sum16( __m512 v )
+   {
+      __m256 lo = _mm256_castpd_ps( _mm512_maskz_extractf64x4_pd( 0xf, _mm512_castps_pd( v ), 0 ) );
+      __m256 hi = _mm256_castpd_ps( _mm512_maskz_extractf64x4_pd( 0xf, _mm512_castps_pd( v ), 1 ) );
+      __m256 s8 = _mm256_add_ps( lo, hi );
+      __m128 s = _mm_add_ps( _mm256_castps256_ps128( s8 ), _mm256_extractf128_ps( s8, 1 ) );
+      s = _mm_add_ps( s, _mm_movehl_ps( s, s ) );
+      s = _mm_add_ss( s, _mm_movehdup_ps( s ) );
+      return( _mm_cvtss_f32( s ) );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Calculate the dot products of four rows of half precision weights with an
+   input vector in single precision and add them to sums[0..3]. n must be a
+   multiple of 32.
+   */
+   /*----------------------------------------------------------------------------*/
+   template<bool BF16>
+   __attribute__(( target( "avx512f" ) ))
+   static void halfDot4Avx512( const uint16_t *w0, const uint16_t *w1, const uint16_t *w2, const uint16_t *w3,
+                               const float *x, int n, int pf, double *sums )
+   {
+      __m512 a0 = _mm512_setzero_ps();
+      __m512 a1 = a0;
+      __m512 a2 = a0;
+      __m512 a3 = a0;
+
+      for( int k = 0; k < n; k += 32 )
+      {
+         // One cache line of each row per iteration
+         __builtin_prefetch( w0 + k + pf );
+         __builtin_prefetch( w1 + k + pf );
+         __builtin_prefetch( w2 + k + pf );
+         __builtin_prefetch( w3 + k + pf );
+
+         __m512 x0 = _mm512_loadu_ps( x + k );
+         __m512 x1 = _mm512_loadu_ps( x + k + 16 );
+         a0 = _mm512_fmadd_ps( loadHalf16<BF16>( w0 + k ), x0, a0 );
+         a1 = _mm512_fmadd_ps( loadHalf16<BF16>( w1 + k ), x0, a1 );
+         a2 = _mm512_fmadd_ps( loadHalf16<BF16>( w2 + k ), x0, a2 );
+         a3 = _mm512_fmadd_ps( loadHalf16<BF16>( w3 + k ), x0, a3 );
+         a0 = _mm512_fmadd_ps( loadHalf16<BF16>( w0 + k + 16 ), x1, a0 );
+         a1 = _mm512_fmadd_ps( loadHalf16<BF16>( w1 + k + 16 ), x1, a1 );
+         a2 = _mm512_fmadd_ps( loadHalf16<BF16>( w2 + k + 16 ), x1, a2 );
+         a3 = _mm512_fmadd_ps( loadHalf16<BF16>( w3 + k + 16 ), x1, a3 );
+      }
+
+      sums[0] += sum16( a0 );
+      sums[1] += sum16( a1 );
+      sums[2] += sum16( a2 );
+      sums[3] += sum16( a3 );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Load 8 half precision weights and convert them to single precision.
+   */
+   /*----------------------------------------------------------------------------*/
+   template<bool BF16>
+   __attribute__(( target( "avx2,fma,f16c" ) ))
+   static inline __m256 loadHalf8( const uint16_t *p )
+   {
+      __m128i h = _mm_loadu_si128( (const __m128i *)p );
+      if( BF16 )
+      {
+         return( _mm256_castsi256_ps( _mm256_slli_epi32( _mm256_cvtepu16_epi32( h ), 16 ) ) );
+      } else
+      {
+         return( _mm256_cvtph_ps( h ) );
+      }
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \return The sum of the elements of a vector
+   */
+   /*----------------------------------------------------------------------------*/
+   __attribute__(( target( "avx2,fma,f16c" ) ))
+   static inline float sum8( __m256 v )
+   {
+      __m128 s = _mm_add_ps( _mm256_castps256_ps128( v ), _mm256_extractf128_ps( v, 1 ) );
+      s = _mm_add_ps( s, _mm_movehl_ps( s, s ) );
+      s = _mm_add_ss( s, _mm_movehdup_ps( s ) );
+      return( _mm_cvtss_f32( s ) );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \see halfDot4Avx512()
+   */
+   /*----------------------------------------------------------------------------*/
+   template<bool BF16>
+   __attribute__(( target( "avx2,fma,f16c" ) ))
+   static void halfDot4Avx2( const uint16_t *w0, const uint16_t *w1, const uint16_t *w2, const uint16_t *w3,
+                             const float *x, int n, int pf, double *sums )
+   {
+      __m256 a0 = _mm256_setzero_ps();
+      __m256 a1 = a0;
+      __m256 a2 = a0;
+      __m256 a3 = a0;
+
+      for( int k = 0; k < n; k += 16 )
+      {
+         __builtin_prefetch( w0 + k + pf );
+         __builtin_prefetch( w1 + k + pf );
+         __builtin_prefetch( w2 + k + pf );
+         __builtin_prefetch( w3 + k + pf );
+
+         __m256 x0 = _mm256_loadu_ps( x + k );
+         __m256 x1 = _mm256_loadu_ps( x + k + 8 );
+         a0 = _mm256_fmadd_ps( loadHalf8<BF16>( w0 + k ), x0, a0 );
+         a1 = _mm256_fmadd_ps( loadHalf8<BF16>( w1 + k ), x0, a1 );
+         a2 = _mm256_fmadd_ps( loadHalf8<BF16>( w2 + k ), x0, a2 );
+         a3 = _mm256_fmadd_ps( loadHalf8<BF16>( w3 + k ), x0, a3 );
+         a0 = _mm256_fmadd_ps( loadHalf8<BF16>( w0 + k + 8 ), x1, a0 );
+         a1 = _mm256_fmadd_ps( loadHalf8<BF16>( w1 + k + 8 ), x1, a1 );
+         a2 = _mm256_fmadd_ps( loadHalf8<BF16>( w2 + k + 8 ), x1, a2 );
+         a3 = _mm256_fmadd_ps( loadHalf8<BF16>( w3 + k + 8 ), x1, a3 );
+      }
+
+      sums[0] += sum8( a0 );
+      sums[1] += sum8( a1 );
+      sums[2] += sum8( a2 );
+      sums[3] += sum8( a3 );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \return A table of the single precision values of all half precision values
+   */
+   /*----------------------------------------------------------------------------*/
+   static const float *fp16Table()
+   {
+      static std::vector<float> table;
+      static std::once_flag once;
+      std::call_once( once, []()
+      {
+         table.resize( 1 << 16 );
+         for( int h = 0; h < table.size(); h++ )
+         {
+            table[h] = HalfMatrix::fromFp16( h );
+         }
+      } );
+
+      return( table.data() );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Convert a half precision weight to single precision without any special
+   instructions.
+   */
+   /*----------------------------------------------------------------------------*/
+   template<bool BF16>
+   static inline float halfToFloat( uint16_t h, const float *table )
+   {
+      if( BF16 )
+      {
+         uint32_t u = (uint32_t)h << 16;
+         float v;
+         memcpy( &v, &u, sizeof( v ) );
+         return( v );
+      } else
+      {
+         return( table[h] );
+      }
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \see halfDot4Avx512(). The prefetch distance is ignored, since the scalar
+   conversion is far slower than the memory.
+   */
+   /*----------------------------------------------------------------------------*/
+   template<bool BF16>
+   static void halfDot4Scalar( const uint16_t *w0, const uint16_t *w1, const uint16_t *w2, const uint16_t *w3,
+                               const float *x, int n, int, double *sums )
+   {
+      const float *table = BF16 ? NULL : fp16Table();
+      float s0 = 0.0f;
+      float s1 = 0.0f;
+      float s2 = 0.0f;
+      float s3 = 0.0f;
+
+      for( int k = 0; k < n; k++ )
+      {
+         s0 += halfToFloat<BF16>( w0[k], table ) * x[k];
+         s1 += halfToFloat<BF16>( w1[k], table ) * x[k];
+         s2 += halfToFloat<BF16>( w2[k], table ) * x[k];
+         s3 += halfToFloat<BF16>( w3[k], table ) * x[k];
+      }
+
+      sums[0] += s0;
+      sums[1] += s1;
+      sums[2] += s2;
+      sums[3] += s3;
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Calculate the weighted sums of the inputs of a range of rows (neurons) for
+   a batch of samples like weightedSums( const WeightMatrix &w, ... ), but with
+   half precision weights. The input vectors are converted to single precision
+   once, the weights are converted while they're loaded into registers, and
+   the products are accumulated in single precision.
+
+   The rows are processed in blocks of as many bytes as a block of double
+   weights, so the block stays in L2 while it's multiplied with all samples.
+   A row is padded to a cache line, which is short enough to multiply without
+   column blocks.
+
+   \param w The weights, one row per neuron
+   \param in The input vectors of the samples, w.cols() doubles each, one
+   after another
+   \param nSamples The number of samples
+   \param out Receives the weighted sums, w.rows() doubles per sample, one
+   sample after another
+   \param rowBegin The first row to calculate
+   \param rowEnd The row after the last row to calculate
+   */
+   /*----------------------------------------------------------------------------*/
+   void weightedSums( const HalfMatrix &w, const double *in, int nSamples, double *out, int rowBegin, int rowEnd )
+   {
+      typedef void ( *HalfDot4 )( const uint16_t *, const uint16_t *, const uint16_t *, const uint16_t *,
+                                  const float *, int, int, double * );
+
+      const Config &c = config();
+      bool bf16 = w.format() == HalfMatrix::FORMAT_BF16;
+      HalfDot4 dot;
+      switch( std::min( c.isa, bestIsa() ) )
+      {
+         case ISA_AVX512:
+            dot = bf16 ? halfDot4Avx512<true> : halfDot4Avx512<false>;
+            break;
+         case ISA_AVX2:
+            dot = bf16 ? halfDot4Avx2<true> : halfDot4Avx2<false>;
+            break;
+         default:
+            dot = bf16 ? halfDot4Scalar<true> : halfDot4Scalar<false>;
+            break;
+      }
+
+      int nRows = w.rows();
+      int nCols = w.cols();
+      int stride = w.stride();
+      int pf = c.prefetchDistance * sizeof( double ) / sizeof( uint16_t );
+      int rowTile = (int)( ( (long)c.rowTile * c.colTile * sizeof( double ) ) /
+                           ( (long)stride * sizeof( uint16_t ) ) ) & ~( ROW_GROUP - 1 );
+      if( rowTile < ROW_GROUP )
+      {
+         rowTile = ROW_GROUP;
+      }
+
+      // The input vectors in single precision, padded with zeros like the rows
+      static thread_local std::vector<float> x;
+      x.assign( (size_t)nSamples * stride, 0.0f );
+      for( int s = 0; s < nSamples; s++ )
+      {
+         for( int k = 0; k < nCols; k++ )
+         {
+            x[(size_t)s * stride + k] = in[(size_t)s * nCols + k];
+         }
+         for( int r = rowBegin; r < rowEnd; r++ )
+         {
+            out[(size_t)s * nRows + r] = 0.0;
+         }
+      }
+
+      for( int r0 = rowBegin; r0 < rowEnd; r0 += rowTile )
+      {
+         int r1 = r0 + rowTile < rowEnd ? r0 + rowTile : rowEnd;
+
+         for( int s = 0; s < nSamples; s++ )
+         {
+            const float *xs = x.data() + (size_t)s * stride;
+            double *sums = out + (size_t)s * nRows;
+
+            int r = r0;
+            for( ; r + ROW_GROUP <= r1; r += ROW_GROUP )
+            {
+               dot( w.row( r ), w.row( r + 1 ), w.row( r + 2 ), w.row( r + 3 ), xs, stride, pf, sums + r );
+            }
+            for( ; r < r1; r++ )
+            {
+               double single[ROW_GROUP] = { 0.0, 0.0, 0.0, 0.0 };
+               dot( w.row( r ), w.row( r ), w.row( r ), w.row( r ), xs, stride, pf, single );
+               sums[r] += single[0];
+            }
+         }
+      }
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Calculate the weighted sums of the inputs of all rows (neurons) for a batch
+   of samples with half precision weights, split across the ThreadPool if it's
+   worth it.
+
+   \see weightedSums( const HalfMatrix &w, const double *in, int nSamples, double *out, int rowBegin, int rowEnd )
+   */
+   /*----------------------------------------------------------------------------*/
+   void weightedSums( const HalfMatrix &w, const double *in, int nSamples, double *out )
+   {
+      ThreadPool &pool = ThreadPool::instance();
+      long work = (long)w.rows() * w.cols() * nSamples;
+      int nParts = numParts( work, w.rows() );
+
+      if( nParts < 2 )
+      {
+         weightedSums( w, in, nSamples, out, 0, w.rows() );
+         return;
+      }
+
+      pool.run( [&w, in, nSamples, out, nParts]( int nThread )
+      {
+         if( nThread >= nParts )
+         {
+            return;
+         }
+
+         int begin, end;
+         threadRows( w.rows(), nParts, nThread, begin, end );
+         weightedSums( w, in, nSamples, out, begin, end );
+      } );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Calculate the sums of the inputs weighted by the columns instead of the
+   rows of the weights, which is what backpropagation needs: for each sample
+   s and each column c in the range,
+
+   $$ out_{s,c} = \sum_{r} w_{r,c} in_{s,r} $$
+
+   The weights are processed in the same blocks as by weightedSums(). Each row
+   of a block is scaled by one input value and added to the slice of the
+   output vector, which stays in L1. Zero inputs are skipped.
+
+   \param w The weights, one row per neuron
+   \param in The input vectors of the samples, w.rows() doubles each, one
+   after another
+   \param nSamples The number of samples
+   \param out Receives the sums, w.cols() doubles per sample, one sample after
+   another
+   \param colBegin The first column to calculate
+   \param colEnd The column after the last column to calculate
+   */
+   /*----------------------------------------------------------------------------*/
+   void transposedSums( const WeightMatrix &w, const double *in, int nSamples, double *out, int colBegin, int colEnd )
+   {
+      const Config &c = config();
+      int nRows = w.rows();
+      int nCols = w.cols();
+
+      for( int s = 0; s < nSamples; s++ )
+      {
+         for( int k = colBegin; k < colEnd; k++ )
+         {
+            out[(size_t)s * nCols + k] = 0.0;
+         }
+      }
+
+      for( int k0 = colBegin; k0 < colEnd; k0 += c.colTile )
+      {
+         int nk = k0 + c.colTile < colEnd ? c.colTile : colEnd - k0;
+
+         for( int r0 = 0; r0 < nRows; r0 += c.rowTile )
+         {
+            int r1 = r0 + c.rowTile < nRows ? r0 + c.rowTile : nRows;
+
+            for( int s = 0; s < nSamples; s++ )
+            {
+               const double *x = in + (size_t)s * nRows;
+               double *y = out + (size_t)s * nCols + k0;
+
+               for( int r = r0; r < r1; r++ )
+               {
+                  if( x[r] != 0.0 )
+                  {
+                     axpy( y, w.row( r ) + k0, x[r], nk );
+                  }
+               }
+            }
+         }
+      }
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Calculate the sums of the inputs weighted by the columns of the weights for
+   a batch of samples, with the columns split across the ThreadPool if it's
+   worth it.
+
+   \see transposedSums( const WeightMatrix &w, const double *in, int nSamples, double *out, int colBegin, int colEnd )
+   */
+   /*----------------------------------------------------------------------------*/
+   void transposedSums( const WeightMatrix &w, const double *in, int nSamples, double *out )
+   {
+      ThreadPool &pool = ThreadPool::instance();
+      long work = (long)w.rows() * w.cols() * nSamples;
+      int nParts = numParts( work, w.rows() );
+
+      if( nParts < 2 )
+      {
+         transposedSums( w, in, nSamples, out, 0, w.cols() );
+         return;
+      }
+
+      pool.run( [&w, in, nSamples, out, nParts]( int nThread )
+      {
+         if( nThread >= nParts )
+         {
+            return;
+         }
+
+         int begin, end;
+         partition( w.cols(), nParts, nThread, begin, end );
+         transposedSums( w, in, nSamples, out, begin, end );
+      } );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Add the scaled sum of the outer products of two batches of vectors to a
+   range of rows of the weights, which is the weight update of a layer:
+
+   $$ w_{r,c} = w_{r,c} + scale \sum_{s} a_{s,r} b_{s,c} $$
+
+   The weights are processed in the same blocks as by weightedSums(), so each
+   block is updated by all samples while it's in L2.
+
+   \param w The weights, one row per neuron
+   \param a The first vector of each sample, w.rows() doubles each, one after
+   another
+   \param b The second vector of each sample, w.cols() doubles each, one after
+   another
+   \param nSamples The number of samples
+   \param scale The factor applied to the sum
+   \param rowBegin The first row to update
+   \param rowEnd The row after the last row to update
+   */
+   /*----------------------------------------------------------------------------*/
+   void addOuterProducts( WeightMatrix &w, const double *a, const double *b, int nSamples, double scale, int rowBegin, int rowEnd )
+   {
+      const Config &c = config();
+      int nRows = w.rows();
+      int nCols = w.cols();
+
+      for( int r0 = rowBegin; r0 < rowEnd; r0 += c.rowTile )
+      {
+         int r1 = r0 + c.rowTile < rowEnd ? r0 + c.rowTile : rowEnd;
+
+         for( int k0 = 0; k0 < nCols; k0 += c.colTile )
+         {
+            int nk = k0 + c.colTile < nCols ? c.colTile : nCols - k0;
+
+            for( int s = 0; s < nSamples; s++ )
+            {
+               const double *x = b + (size_t)s * nCols + k0;
+               const double *f = a + (size_t)s * nRows;
+
+               for( int r = r0; r < r1; r++ )
+               {
+                  if( f[r] != 0.0 )
+                  {
+                     axpy( w.row( r ) + k0, x, scale * f[r], nk );
+                  }
+               }
+            }
+         }
+      }
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Add the scaled sum of the outer products of two batches of vectors to all
+   rows of the weights, split across the ThreadPool if it's worth it. Each
+   thread updates the rows it has touched first.
+
+   \see addOuterProducts( WeightMatrix &w, const double *a, const double *b, int nSamples, double scale, int rowBegin, int rowEnd )
+   */
+   /*----------------------------------------------------------------------------*/
+   void addOuterProducts( WeightMatrix &w, const double *a, const double *b, int nSamples, double scale )
+   {
+      ThreadPool &pool = ThreadPool::instance();
+      long work = (long)w.rows() * w.cols() * nSamples;
+      int nParts = numParts( work, w.rows() );
+
+      if( nParts < 2 )
+      {
+         addOuterProducts( w, a, b, nSamples, scale, 0, w.rows() );
+         return;
+      }
+
+      pool.run( [&w, a, b, nSamples, scale, nParts]( int nThread )
+      {
+         if( nThread >= nParts )
+         {
+            return;
+         }
+
+         int begin, end;
+         threadRows( w.rows(), nParts, nThread, begin, end );
+         addOuterProducts( w, a, b, nSamples, scale, begin, end );
+      } );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \return The largest of n values
+   */
+   /*----------------------------------------------------------------------------*/
+   static inline double maxValue( const double *v, int n )
+   {
+      double m = v[0];
+
+      int k = 0;
+      if( n >= 4 )
+      {
+         v4d m4 = load4( v );
+         for( k = 4; k + 4 <= n; k += 4 )
+         {
+            v4d x = load4( v + k );
+            m4 = x > m4 ? x : m4;
+         }
+         m = std::max( std::max( m4[0], m4[1] ), std::max( m4[2], m4[3] ) );
+      }
+      for( ; k < n; k++ )
+      {
+         m = std::max( m, v[k] );
+      }
+
+      return( m );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Replace the weighted sums of a softmax layer by the probabilities
+
+   $$ p_k = { e ^ { v_k - m } \over \sum_{j} e ^ { v_j - m } } $$
+
+   whereby m is the largest weighted sum, so no exp() can overflow.
+
+   \param v The weighted sums, replaced by the probabilities
+   \param n The number of values
+   */
+   /*----------------------------------------------------------------------------*/
+   void softmax( double *v, int n )
+   {
+      double m = maxValue( v, n );
+
+      double sum = 0.0;
+      for( int k = 0; k < n; k++ )
+      {
+         v[k] = exp( v[k] - m );
+         sum += v[k];
+      }
+
+      double inv = 1.0 / sum;
+      v4d inv4 = { inv, inv, inv, inv };
+      int k = 0;
+      for( ; k + 4 <= n; k += 4 )
+      {
+         store4( v + k, load4( v + k ) * inv4 );
+      }
+      for( ; k < n; k++ )
+      {
+         v[k] *= inv;
+      }
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Like softmax(), and in the same passes over the values, calculate the
+   cross-entropy loss
+
+   $$ L = - \sum_{k} t_k \log p_k = \sum_{k} t_k ( \log \sum_{j} e ^ { v_j - m } - ( v_k - m ) ) $$
+
+   and the error of each output, which is the negative gradient of the loss
+   with respect to the weighted sum: t_k - p_k. Taking the logarithm of the
+   sum instead of each probability keeps the loss finite even if a
+   probability underflows to zero.
+
+   \param v The weighted sums, replaced by the probabilities
+   \param target The expected probabilities
+   \param error Receives the errors
+   \param n The number of values
+   \return The loss
+   */
+   /*----------------------------------------------------------------------------*/
+   double softmaxCrossEntropy( double *v, const double *target, double *error, int n )
+   {
+      double m = maxValue( v, n );
+
+      double sum = 0.0;
+      double targetSum = 0.0;
+      double targetDot = 0.0;
+      for( int k = 0; k < n; k++ )
+      {
+         double x = v[k] - m;
+         targetSum += target[k];
+         targetDot += target[k] * x;
+         v[k] = exp( x );
+         sum += v[k];
+      }
+
+      double inv = 1.0 / sum;
+      v4d inv4 = { inv, inv, inv, inv };
+      int k = 0;
+      for( ; k + 4 <= n; k += 4 )
+      {
+         v4d p = load4( v + k ) * inv4;
+         store4( v + k, p );
+         store4( error + k, load4( target + k ) - p );
+      }
+      for( ; k < n; k++ )
+      {
+         v[k] *= inv;
+         error[k] = target[k] - v[k];
+      }
+
+      return( targetSum * log( sum ) - targetDot );
+   }
+}
@@ -0,0 +1,101 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file kernel.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for the layer kernels
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __KERNEL_H__
+#define __KERNEL_H__
+
+#include <map>
+
+#include "HalfMatrix.h"
+#include "WeightMatrix.h"
+
+namespace kernel
+{
+   // Instruction sets of the kernels for half precision weights
+   enum Isa
+   {
+      ISA_SCALAR,
+      ISA_AVX2,
+      ISA_AVX512
+   };
+
+   /*----------------------------------------------------------------------------*/
+   /*!
+   \struct Config
+   \date  2026-10-18
+   Tuning parameters of the layer kernels. The defaults are derived from the
+   cache sizes of the host.
+   */
+   /*----------------------------------------------------------------------------*/
+   struct Config
+   {
+      // Number of columns of a block of weights. The corresponding slice of
+      // an input vector is kept in L1 while it's multiplied with all rows
+      // of the block.
+      int colTile;
+
+      // Number of rows of a block of weights. The block is kept in L2 while
+      // all samples of a batch are multiplied with it.
+      int rowTile;
+
+      // Distance in doubles by which the weights are prefetched ahead of use
+      int prefetchDistance;
+
+      // Minimum number of multiplications of a layer pass which is worth
+      // splitting across the ThreadPool
+      long minParallelWork;
+
+      // Maximum number of threads a layer pass is split across, 0 for all
+      // threads of the ThreadPool
+      int maxThreads;
+
+      // Maximum number of threads a pass over a layer of a given width
+      // (number of rows) is split across, within maxThreads. Widths which
+      // aren't listed are only limited by maxThreads.
+      std::map<int, int> widthThreads;
+
+      // Instruction set of the kernels for half precision weights. Only
+      // instruction sets up to bestIsa() are used.
+      Isa isa;
+   };
+
+   Config &config();
+   Isa bestIsa();
+   const char *isaName( Isa isa );
+   void partition( int n, int nParts, int nPart, int &begin, int &end );
+   void weightedSums( const WeightMatrix &w, const double *in, int nSamples, double *out, int rowBegin, int rowEnd );
+   void weightedSums( const WeightMatrix &w, const double *in, int nSamples, double *out );
+   void weightedSums( const HalfMatrix &w, const double *in, int nSamples, double *out, int rowBegin, int rowEnd );
+   void weightedSums( const HalfMatrix &w, const double *in, int nSamples, double *out );
+   void transposedSums( const WeightMatrix &w, const double *in, int nSamples, double *out, int colBegin, int colEnd );
+   void transposedSums( const WeightMatrix &w, const double *in, int nSamples, double *out );
+   void addOuterProducts( WeightMatrix &w, const double *a, const double *b, int nSamples, double scale, int rowBegin, int rowEnd );
+   void addOuterProducts( WeightMatrix &w, const double *a, const double *b, int nSamples, double scale );
+   void softmax( double *v, int n );
+   double softmaxCrossEntropy( double *v, const double *target, double *error, int n );
+}
+
+#endif
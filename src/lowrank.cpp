@@ -0,0 +1,445 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+/*----------------------------------------------------------------------------*/
+/*!
+\file lowrank.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Implementation of the low-rank factorization of the layers of a
+network
+*/
+/*----------------------------------------------------------------------------*/
+#include <math.h>
+
+#include <algorithm>
+
+#include "lowrank.h"
+#include "util.h"
+
+// Maximum number of sweeps over all pairs of rows of the Jacobi SVD
+#define LOWRANK_MAX_SWEEPS 60
+
+// Two rows count as orthogonal if the cosine of their angle is below this
+#define LOWRANK_EPSILON 1e-12
+
+namespace lowrank
+{
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \param nn A network
+   \param nLayer The index of a layer
+   \return true if the layer is a dense, softmax or linear layer which can be
+   replaced by a factorization with fewer weights
+   */
+   /*----------------------------------------------------------------------------*/
+   bool factorizable( const NeuralNetwork &nn, int nLayer )
+   {
+      if( nLayer < 1 || nLayer >= nn.numLayers() )
+      {
+         return( false );
+      }
+
+      LayerSpec::LayerType type = nn.layer( nLayer ).type;
+      return( ( type == LayerSpec::LAYER_DENSE || type == LayerSpec::LAYER_SOFTMAX || type == LayerSpec::LAYER_LINEAR ) &&
+              !candidateRanks( nn, nLayer ).empty() );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   A factorization of rank r of a layer with n neurons and m inputs has
+   r ( n + m ) weights instead of n m.
+   \param nn A network
+   \param nLayer The index of a dense, softmax or linear layer
+   \return The powers of 2 which are ranks with fewer weights than the layer,
+   in ascending order
+   */
+   /*----------------------------------------------------------------------------*/
+   std::vector<int> candidateRanks( const NeuralNetwork &nn, int nLayer )
+   {
+      std::vector<int> ranks;
+      long n = nn.weights( nLayer ).rows();
+      long m = nn.weights( nLayer ).cols();
+      for( long r = 1; r * ( n + m ) < n * m; r *= 2 )
+      {
+         ranks.push_back( r );
+      }
+
+      return( ranks );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Calculate the singular value decomposition of a weight matrix with the
+   one-sided Jacobi method. The k = min( rows, cols ) rows of W (or columns, if
+   W has more rows than columns) are rotated in pairs until they are
+   orthogonal, W = P A. Row i of A then is s_i times the right singular vector
+   i, and column i of P is the left singular vector i.
+   \param w The weight matrix
+   \param d Receives the decomposition
+   */
+   /*----------------------------------------------------------------------------*/
+   void decompose( const WeightMatrix &w, Decomposition &d )
+   {
+      int n = w.rows();
+      int m = w.cols();
+      bool transposed = n > m;
+      int k = std::min( n, m );
+      int len = std::max( n, m );
+
+      std::vector<double> a( (size_t)k * len );
+      std::vector<double> p( (size_t)k * k, 0.0 );
+      for( int r = 0; r < n; r++ )
+      {
+         for( int c = 0; c < m; c++ )
+         {
+            a[transposed ? (size_t)c * len + r : (size_t)r * len + c] = w.row( r )[c];
+         }
+      }
+      for( int i = 0; i < k; i++ )
+      {
+         p[(size_t)i * k + i] = 1.0;
+      }
+
+      bool rotated = true;
+      for( int sweep = 0; rotated && sweep < LOWRANK_MAX_SWEEPS; sweep++ )
+      {
+         rotated = false;
+         for( int i = 0; i < k - 1; i++ )
+         {
+            for( int j = i + 1; j < k; j++ )
+            {
+               double *ai = a.data() + (size_t)i * len;
+               double *aj = a.data() + (size_t)j * len;
+               double alpha = 0.0, beta = 0.0, gamma = 0.0;
+               for( int x = 0; x < len; x++ )
+               {
+                  alpha += ai[x] * ai[x];
+                  beta += aj[x] * aj[x];
+                  gamma += ai[x] * aj[x];
+               }
+
+               if( fabs( gamma ) <= LOWRANK_EPSILON * sqrt( alpha * beta ) )
+               {
+                  continue;
+               }
+               rotated = true;
+
+               // The rotation which makes rows i and j orthogonal
+               double zeta = ( beta - alpha ) / ( 2.0 * gamma );
+               double t = ( zeta >= 0.0 ? 1.0 : -1.0 ) / ( fabs( zeta ) + sqrt( 1.0 + zeta * zeta ) );
+               double c = 1.0 / sqrt( 1.0 + t * t );
+               double s = c * t;
+
+               for( int x = 0; x < len; x++ )
+               {
+                  double vi = ai[x];
+                  double vj = aj[x];
+                  ai[x] = c * vi - s * vj;
+                  aj[x] = s * vi + c * vj;
+               }
+               for( int x = 0; x < k; x++ )
+               {
+                  double vi = p[(size_t)x * k + i];
+                  double vj = p[(size_t)x * k + j];
+                  p[(size_t)x * k + i] = c * vi - s * vj;
+                  p[(size_t)x * k + j] = s * vi + c * vj;
+               }
+            }
+         }
+      }
+
+      // Order the singular values by size
+      std::vector<double> norms( k );
+      std::vector<int> order( k );
+      for( int i = 0; i < k; i++ )
+      {
+         double sum = 0.0;
+         for( int x = 0; x < len; x++ )
+         {
+            sum += a[(size_t)i * len + x] * a[(size_t)i * len + x];
+         }
+         norms[i] = sqrt( sum );
+         order[i] = i;
+      }
+      std::sort( order.begin(), order.end(), [&norms]( int x, int y ) { return( norms[x] > norms[y] ); } );
+
+      d.rows = n;
+      d.cols = m;
+      d.u.assign( (size_t)n * k, 0.0 );
+      d.s.assign( k, 0.0 );
+      d.v.assign( (size_t)k * m, 0.0 );
+      for( int i = 0; i < k; i++ )
+      {
+         int o = order[i];
+         double sigma = norms[o];
+         double scale = sigma > 0.0 ? 1.0 / sigma : 0.0;
+         d.s[i] = sigma;
+
+         // The normalized row of A and the column of P are the singular
+         // vectors of W, or swapped if W was transposed
+         for( int x = 0; x < len; x++ )
+         {
+            double q = a[(size_t)o * len + x] * scale;
+            if( transposed )
+            {
+               d.u[(size_t)x * k + i] = q;
+            } else
+            {
+               d.v[(size_t)i * m + x] = q;
+            }
+         }
+         for( int x = 0; x < k; x++ )
+         {
+            double q = p[(size_t)x * k + o];
+            if( transposed )
+            {
+               d.v[(size_t)i * m + x] = q;
+            } else
+            {
+               d.u[(size_t)x * k + i] = q;
+            }
+         }
+      }
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \param d A decomposition
+   \param rank A rank
+   \return The fraction of the squared Frobenius norm of the weight matrix
+   which is kept by the factorization of the rank
+   */
+   /*----------------------------------------------------------------------------*/
+   double energy( const Decomposition &d, int rank )
+   {
+      double kept = 0.0, total = 0.0;
+      for( int i = 0; i < d.s.size(); i++ )
+      {
+         total += d.s[i] * d.s[i];
+         if( i < rank )
+         {
+            kept += d.s[i] * d.s[i];
+         }
+      }
+
+      return( total > 0.0 ? kept / total : 1.0 );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Replace layers of a network by their truncated singular value
+   decomposition. A layer with the weight matrix W and the rank r becomes a
+   linear layer of r neurons with the weights sqrt( S ) V, followed by a layer
+   of the original type with the weights U sqrt( S ), so its weighted sums are
+   those of the best approximation of W of rank r. A query takes two smaller
+   matrix products instead of one large one. The weight formats aren't
+   passed on.
+   \param nn The network
+   \param decompositions The decomposition of each layer which is factorized,
+   see decompose(), indexed by the layer
+   \param ranks The rank of each layer, indexed by the layer, 0 or missing to
+   keep the layer as it is
+   \param result Receives the factorized network
+   \return true on success, false if a rank is larger than the number of
+   singular values or a decomposition doesn't match its layer
+   */
+   /*----------------------------------------------------------------------------*/
+   bool factorize( const NeuralNetwork &nn, const std::vector<Decomposition> &decompositions,
+                   const std::vector<int> &ranks, NeuralNetwork &result )
+   {
+      std::vector<LayerSpec> layers;
+      for( int i = 0; i < nn.numLayers(); i++ )
+      {
+         int rank = i < ranks.size() ? ranks[i] : 0;
+         if( rank > 0 )
+         {
+            const WeightMatrix &w = nn.weights( i );
+            if( i >= decompositions.size() || decompositions[i].rows != w.rows() || decompositions[i].cols != w.cols() ||
+                rank > decompositions[i].s.size() || !factorizable( nn, i ) )
+            {
+               return( false );
+            }
+            layers.push_back( LayerSpec::linear( rank ) );
+         }
+         layers.push_back( nn.layer( i ) );
+      }
+
+      std::vector<double> weights, factored;
+      nn.getWeights( weights );
+      const double *src = weights.data();
+      for( int i = 1; i < nn.numLayers(); i++ )
+      {
+         const WeightMatrix &w = nn.weights( i );
+         size_t size = (size_t)w.rows() * w.cols();
+         int rank = i < ranks.size() ? ranks[i] : 0;
+         if( rank < 1 )
+         {
+            factored.insert( factored.end(), src, src + size );
+         } else
+         {
+            const Decomposition &d = decompositions[i];
+            int k = d.s.size();
+            for( int r = 0; r < rank; r++ )
+            {
+               double scale = sqrt( d.s[r] );
+               for( int c = 0; c < d.cols; c++ )
+               {
+                  factored.push_back( scale * d.v[(size_t)r * d.cols + c] );
+               }
+            }
+            for( int r = 0; r < d.rows; r++ )
+            {
+               for( int c = 0; c < rank; c++ )
+               {
+                  factored.push_back( d.u[(size_t)r * k + c] * sqrt( d.s[c] ) );
+               }
+            }
+         }
+         src += size;
+      }
+
+      NeuralNetwork factorized( layers );
+      if( factorized.numLayers() != layers.size() || !factorized.setWeights( factored ) )
+      {
+         return( false );
+      }
+      result = factorized;
+
+      return( true );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Choose the ranks of the layers for an accuracy budget. The layers are
+   factorized greedily, the one with the most weights first, each with the
+   smallest candidate rank which keeps the success rate of the factorized
+   network within maxLoss percentage points of the original network.
+   \param nn The network
+   \param decompositions The decomposition of each factorizable layer, indexed
+   by the layer
+   \param inputs The input vectors to measure the success rate with
+   \param labels The expected digit of each input vector
+   \param maxLoss The maximum loss of the success rate in percentage points
+   \param ranks Receives the rank of each layer, 0 for layers kept as they are
+   */
+   /*----------------------------------------------------------------------------*/
+   void chooseRanks( const NeuralNetwork &nn, const std::vector<Decomposition> &decompositions,
+                     const std::vector<std::vector<double> > &inputs, const std::vector<int> &labels,
+                     double maxLoss, std::vector<int> &ranks )
+   {
+      double minSuccess = successRate( nn, inputs, labels ) - maxLoss;
+
+      std::vector<int> order;
+      for( int i = 1; i < nn.numLayers(); i++ )
+      {
+         if( factorizable( nn, i ) && i < decompositions.size() )
+         {
+            order.push_back( i );
+         }
+      }
+      std::sort( order.begin(), order.end(), [&nn]( int a, int b )
+      {
+         return( (long)nn.weights( a ).rows() * nn.weights( a ).cols() > (long)nn.weights( b ).rows() * nn.weights( b ).cols() );
+      } );
+
+      ranks.assign( nn.numLayers(), 0 );
+      NeuralNetwork factorized = NeuralNetwork( std::vector<int>() );
+      for( int i = 0; i < order.size(); i++ )
+      {
+         std::vector<int> candidates = candidateRanks( nn, order[i] );
+         for( int c = 0; c < candidates.size(); c++ )
+         {
+            ranks[order[i]] = candidates[c];
+            if( factorize( nn, decompositions, ranks, factorized ) &&
+                successRate( factorized, inputs, labels ) >= minSuccess )
+            {
+               break;
+            }
+            ranks[order[i]] = 0;
+         }
+      }
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \param nn A network
+   \param inputs The input vectors
+   \param labels The expected digit of each input vector
+   \return The percentage of the input vectors whose highest output is the
+   expected digit
+   */
+   /*----------------------------------------------------------------------------*/
+   double successRate( const NeuralNetwork &nn, const std::vector<std::vector<double> > &inputs,
+                       const std::vector<int> &labels )
+   {
+      std::vector<std::vector<double> > outputs;
+      if( inputs.empty() || !nn.query( inputs, outputs ) )
+      {
+         return( 0.0 );
+      }
+
+      int nPass = 0;
+      for( int i = 0; i < outputs.size(); i++ )
+      {
+         nPass += util::indexOfMaxValue( outputs[i] ) == labels[i];
+      }
+
+      return( 100.0 * nPass / outputs.size() );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \param nn A network
+   \return The number of weights of all layers
+   */
+   /*----------------------------------------------------------------------------*/
+   long numParameters( const NeuralNetwork &nn )
+   {
+      long n = 0;
+      for( int i = 1; i < nn.numLayers(); i++ )
+      {
+         n += (long)nn.weights( i ).rows() * nn.weights( i ).cols();
+      }
+
+      return( n );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \param nn A network
+   \return The number of multiply-adds of a query with a single sample
+   */
+   /*----------------------------------------------------------------------------*/
+   long numMultiplyAdds( const NeuralNetwork &nn )
+   {
+      long n = 0;
+      for( int i = 1; i < nn.numLayers(); i++ )
+      {
+         n += nn.numMultiplyAdds( i );
+      }
+
+      return( n );
+   }
+}
@@ -0,0 +1,73 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+/*----------------------------------------------------------------------------*/
+/*!
+\file lowrank.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for the low-rank factorization of the layers of a network
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __LOWRANK_H__
+#define __LOWRANK_H__
+
+#include <vector>
+
+#include "NeuralNetwork.h"
+#include "WeightMatrix.h"
+
+namespace lowrank
+{
+   /*----------------------------------------------------------------------------*/
+   /*!
+   \struct Decomposition
+   \date  2026-10-18
+   The singular value decomposition W = U S V of the weight matrix of a
+   layer, with k = min( rows, cols ) singular values in descending order.
+   */
+   /*----------------------------------------------------------------------------*/
+   struct Decomposition
+   {
+      int rows;
+      int cols;
+
+      // The left singular vectors, rows x k, one column per singular value
+      std::vector<double> u;
+
+      // The singular values
+      std::vector<double> s;
+
+      // The right singular vectors, k x cols, one row per singular value
+      std::vector<double> v;
+   };
+
+   bool factorizable( const NeuralNetwork &nn, int nLayer );
+   std::vector<int> candidateRanks( const NeuralNetwork &nn, int nLayer );
+   void decompose( const WeightMatrix &w, Decomposition &d );
+   double energy( const Decomposition &d, int rank );
+   bool factorize( const NeuralNetwork &nn, const std::vector<Decomposition> &decompositions,
+                   const std::vector<int> &ranks, NeuralNetwork &result );
+   void chooseRanks( const NeuralNetwork &nn, const std::vector<Decomposition> &decompositions,
+                     const std::vector<std::vector<double> > &inputs, const std::vector<int> &labels,
+                     double maxLoss, std::vector<int> &ranks );
+   double successRate( const NeuralNetwork &nn, const std::vector<std::vector<double> > &inputs,
+                       const std::vector<int> &labels );
+   long numParameters( const NeuralNetwork &nn );
+   long numMultiplyAdds( const NeuralNetwork &nn );
+}
+
+#endif
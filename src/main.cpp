@@ -24,261 +24,1957 @@
 \brief The main program.
 */
 /*----------------------------------------------------------------------------*/
+#include <math.h>
+#include <signal.h>
+#include <fcntl.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
 #include <vector>
 #include <ctime>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <chrono>
+#include <thread>
 
+#include "Cascade.h"
+#include "DistributedTrainer.h"
+#include "IncrementalQuery.h"
+#include "LayerSpec.h"
+#include "LoadGenerator.h"
+#include "ModelStore.h"
 #include "NeuralNetwork.h"
+#include "Pipeline.h"
+#include "Profiler.h"
+#include "QueryCache.h"
+#include "Random.h"
+#include "Server.h"
+#include "StreamTrainer.h"
+#include "Sweep.h"
+#include "ThreadPool.h"
+#include "autotune.h"
+#include "bench.h"
+#include "kernel.h"
+#include "lowrank.h"
+#include "mnist.h"
 #include "util.h"
 
+// Number of independently locked shards of a QueryCache
+#define QUERY_CACHE_SHARDS 16
 
+
+/*----------------------------------------------------------------------------*/
+/*! 2023-12-15
+Print usage
+*/
 /*----------------------------------------------------------------------------*/
-/*! 2023-12-11
-This function reads a single line from the MNIST CSV file, converts the pixel
-data to a vector of 28x28 double values ranging from 0.01 to 1.0 an returns
-the marker value.
+void usage( int argc, const char *argv[] )
+{
+   fprintf( stderr, "Usage: %s [-e epochs] [-s seed] [-l topology] [-o sigmoid|softmax] [-u publishInterval] [-b all|percentile|importance] [-k keepPercent] [-T profile] mnist_train.csv mnist_test.csv [model.nn]\n", argv[0] );
+   fprintf( stderr, "       %s serve model.nn [socket|-] [maxBatchSize] [batchWindowUs] [cacheMB]\n", argv[0] );
+   fprintf( stderr, "       %s loadgen socket mnist_test.csv [connections] [requests] [burstSize]\n", argv[0] );
+   fprintf( stderr, "       %s bench [maxWidth] [batchSize]\n", argv[0] );
+   fprintf( stderr, "       %s pipeline model.nn mnist_test.csv [stages]\n", argv[0] );
+   fprintf( stderr, "       %s incremental model.nn mnist_test.csv [changedPercent] [fullInterval]\n", argv[0] );
+   fprintf( stderr, "       %s cache model.nn mnist_test.csv [repeatPercent] [cacheMB]\n", argv[0] );
+   fprintf( stderr, "       %s precision model.nn mnist_test.csv [batchSize]\n", argv[0] );
+   fprintf( stderr, "       %s tune topology|model.nn [profile] [batchSize]\n", argv[0] );
+   fprintf( stderr, "       %s cascade small.nn large.nn mnist_test.csv [maxLossPercent] [validationPercent]\n", argv[0] );
+   fprintf( stderr, "       %s profile topology|model.nn mnist_test.csv [nSamples] [batchSize]\n", argv[0] );
+   fprintf( stderr, "       %s lowrank [-r layer:rank,..] [-b maxLossPercent] [-t mnist_train.csv] [-e epochs] [-a alpha] [-s seed] model.nn mnist_test.csv [compressed.nn]\n", argv[0] );
+   fprintf( stderr, "       %s sweep [-e epochs] [-s seed] [-l topology].. [-o sigmoid|softmax].. [-a alpha,..] [-b chunkSize] mnist_train.csv mnist_test.csv\n", argv[0] );
+   fprintf( stderr, "       %s online [-l topology] [-o sigmoid|softmax] [-m model.nn] [-f csv|binary] [-a alpha] [-b maxBatchSize] [-L maxLatencyMs] [-w window] [-q queueSize] [-s seed] socket|fifo|- [model.nn]\n", argv[0] );
+   fprintf( stderr, "       %s distributed [-n workers] [-k syncInterval] [-t shm|tcp] [-p basePort] [-e epochs] [-s seed] [-l topology] [-o sigmoid|softmax] [-v] [-S] mnist_train.csv mnist_test.csv [model.nn]\n", argv[0] );
+   fprintf( stderr, "\nA topology is a comma separated list of layers, for example\n" );
+   fprintf( stderr, "'784,100,10' (the default) or '28x28x1,conv8x5,pool2,100,10'.\n" );
+}
 
-\see static int readCSV( std::ifstream &infile, std::vector<double> &values )
 
-\param infile The input file stream
-\param imin The minimum input value to be expected from the MNIST file
-\param imax The maximum input value to be expected from the MNIST file
-\param dmin The minimum output value
-\param dmax The maximum output value
-\param values The vector of doubles which will be filled with the pixel data
-\return The marker value
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Serve a trained network, loaded from a file written by the training mode,
+until interrupted with SIGINT or SIGTERM. If the socket is "-", requests are
+read from stdin and answered on stdout until stdin is closed. If cacheMB is
+greater than 0, the outputs of repeated requests are taken from a QueryCache
+of that size.
 */
 /*----------------------------------------------------------------------------*/
-static int readMNIST( std::ifstream &infile, int imin, int imax, double dmin, double dmax, std::vector<double> &values )
+static int runServer( int argc, const char *argv[] )
 {
-   std::string line;
-   int marker = -1;
-   values.clear();
+   if( argc < 3 )
+   {
+      usage( argc, argv );
+      return( -1 );
+   }
 
-   if( std::getline( infile, line ) )
+   std::string modelfname = argv[2];
+   std::string socketPath = argc > 3 ? argv[3] : "/tmp/NeuralNetwork.sock";
+   int maxBatchSize = argc > 4 ? std::stoi( argv[4] ) : 64;
+   int batchWindowUs = argc > 5 ? std::stoi( argv[5] ) : 200;
+   int cacheMB = argc > 6 ? std::stoi( argv[6] ) : 0;
+
+   NeuralNetwork nn = NeuralNetwork( std::vector<int>() );
+   if( !nn.load( modelfname ) )
    {
-      line = util::trim( line );
-      std::vector<std::string> sVals = util::strsplit( line, ",", false );
+      fprintf( stderr, "Couldn't load model file '%s'.\n", modelfname.c_str() );
+      return( -1 );
+   }
 
-      if( sVals.size() > 0 )
-      {
-         marker = std::stoi( sVals[0] );
+   // A client going away while we're writing its response
+   // must not kill the server
+   signal( SIGPIPE, SIG_IGN );
+   signal( SIGINT, Server::handleSignal );
+   signal( SIGTERM, Server::handleSignal );
 
-         for( int i = 1; i < sVals.size(); i++ )
-         {
-            int v = std::stoi( sVals[i] );
+   QueryCache cache( (size_t)cacheMB << 20, QUERY_CACHE_SHARDS );
+   if( cacheMB > 0 )
+   {
+      nn.setCache( &cache );
+   }
 
-            double dv = (double)( v - imin ) / (double)( imax - imin );
-            dv = ( dv * ( dmax - dmin ) ) + dmin;
-            values.push_back( dv );
-         }
-      }
+   Server server( nn, maxBatchSize, batchWindowUs );
+   bool ok;
+   if( socketPath == "-" )
+   {
+      ok = server.serveStream( STDIN_FILENO, STDOUT_FILENO );
+   } else
+   {
+      ok = server.serveSocket( socketPath );
+   }
+
+   if( cacheMB > 0 )
+   {
+      fprintf( stderr, "Cache: %ld hits, %ld misses, %ld evictions, %zu entries\n",
+               cache.numHits(), cache.numMisses(), cache.numEvictions(), cache.numEntries() );
    }
 
-   return( marker );
+   return( ok ? 0 : -1 );
 }
 
 
 /*----------------------------------------------------------------------------*/
-/*! 2023-12-11
-In the MNIST CSV file, each line represents a sample of a handwritten digit.
-The line begins with the marker (the actual digit as an integer value),
-followed by 784 integer values ranging from 0 to 255 representing 28x28 pixels.
+/*! 2026-10-18
+Benchmark a running server with samples from the MNIST test dataset.
+*/
+/*----------------------------------------------------------------------------*/
+static int runLoadGenerator( int argc, const char *argv[] )
+{
+   if( argc < 4 )
+   {
+      usage( argc, argv );
+      return( -1 );
+   }
+
+   std::string socketPath = argv[2];
+   std::string testfname = argv[3];
+   int nConnections = argc > 4 ? std::stoi( argv[4] ) : 4;
+   int nRequests = argc > 5 ? std::stoi( argv[5] ) : 10000;
+   int burstSize = argc > 6 ? std::stoi( argv[6] ) : 16;
+
+   std::vector<std::vector<double> > inputs;
+   std::vector<int> digits;
+   if( mnist::readMNIST( testfname, inputs, digits ) < 1 )
+   {
+      fprintf( stderr, "Couldn't read MNIST test file '%s'.\n", testfname.c_str() );
+      return( -1 );
+   }
 
-This function reads a single line from the MNIST CSV file, converts the pixel
-data to a vector of 28x28 double values ranging from 0.01 to 1.0 an returns
-the marker value.
+   signal( SIGPIPE, SIG_IGN );
 
-\param infile The input file stream
-\param values The vector of doubles which will be filled with the pixel data
-\return The marker value
+   LoadGenerator loadgen( socketPath, inputs, digits );
+   return( loadgen.run( nConnections, nRequests, burstSize ) ? 0 : -1 );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Sweep the layer kernel across layer widths from layers that fit into L2 to
+layers that only fit into DRAM.
 */
 /*----------------------------------------------------------------------------*/
-static int readMNIST( std::ifstream &infile, std::vector<double> &values )
+static int runBenchmark( int argc, const char *argv[] )
 {
-   return( readMNIST( infile, 0, 255, 0.01, 1.0, values ) );
+   int maxWidth = argc > 2 ? std::stoi( argv[2] ) : 8192;
+   int batchSize = argc > 3 ? std::stoi( argv[3] ) : 32;
+
+   bench::layerSweep( maxWidth, batchSize );
+
+   return( 0 );
 }
 
 
 /*----------------------------------------------------------------------------*/
-/*! 2023-12-12
-Our neural network has 28x28=784 input neurons for the pixel data of a
-handwritten decimal digit and 10 output neurons, each indicating the detection
-of a specific decimal digit. I.e. if neuron n (n=0..9) is close to 1.0, that
-means that decimal digit n has been detected.
-This function converts the value of a decimal digit n, given as an integer
-parameter, to an expected output vector consisting of 10 double values where
-only element #n is 'trueVal' (usually = 1.0) and all other elements are
-'falseVal' (usually = 0.0).
-
-\param digit The digit, ranging from 0 to 9
-\param falseVal The double value indicating non-detection
-\param trueVal The double value indicating detection
-\return The output vector which can be compared to the output vector of our
-neural network
+/*! 2026-10-18
+Stream the MNIST test dataset through a trained network split into pipeline
+stages and compare the throughput with querying the samples one by one.
 */
 /*----------------------------------------------------------------------------*/
-std::vector<double> convertToExpectedOut( int digit, double falseVal, double trueVal )
+static int runPipeline( int argc, const char *argv[] )
 {
-   std::vector<double> r;
+   if( argc < 4 )
+   {
+      usage( argc, argv );
+      return( -1 );
+   }
+
+   std::string modelfname = argv[2];
+   std::string testfname = argv[3];
+   int nStages = argc > 4 ? std::stoi( argv[4] ) : std::thread::hardware_concurrency();
+
+   NeuralNetwork nn = NeuralNetwork( std::vector<int>() );
+   if( !nn.load( modelfname ) )
+   {
+      fprintf( stderr, "Couldn't load model file '%s'.\n", modelfname.c_str() );
+      return( -1 );
+   }
+
+   std::vector<std::vector<double> > inputs;
+   std::vector<int> digits;
+   if( mnist::readMNIST( testfname, inputs, digits ) < 1 )
+   {
+      fprintf( stderr, "Couldn't read MNIST test file '%s'.\n", testfname.c_str() );
+      return( -1 );
+   }
+
+   // Sequential reference
+   int nCorrect = 0;
+   auto t0 = std::chrono::steady_clock::now();
+   for( int i = 0; i < inputs.size(); i++ )
+   {
+      nn.query( inputs[i] );
+      if( util::indexOfMaxValue( nn.output() ) == digits[i] )
+      {
+         nCorrect++;
+      }
+   }
+   double seqSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - t0 ).count();
+   printf( "sequential: %d/%zu correct, %.0f samples/s\n", nCorrect, inputs.size(), inputs.size() / seqSeconds );
+
+   Pipeline pipeline( nn, nStages );
+   for( int i = 0; i < pipeline.numStages(); i++ )
+   {
+      printf( "stage %d: layers %d-%d\n", i, pipeline.firstLayer( i ), pipeline.lastLayer( i ) );
+   }
+
+   nCorrect = 0;
+   t0 = std::chrono::steady_clock::now();
+   std::thread producer( [&]()
+   {
+      for( int i = 0; i < inputs.size(); i++ )
+      {
+         pipeline.submit( inputs[i] );
+      }
+      pipeline.finish();
+   } );
 
-   for( int i = 0; i < 10; i++ )
+   std::vector<double> outputVector;
+   for( int i = 0; pipeline.receive( outputVector ); i++ )
    {
-      r.push_back( i == digit ? trueVal : falseVal );
+      if( util::indexOfMaxValue( outputVector ) == digits[i] )
+      {
+         nCorrect++;
+      }
    }
+   double pipeSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - t0 ).count();
+   producer.join();
+   printf( "pipelined:  %d/%zu correct, %.0f samples/s (%.2fx)\n", nCorrect, inputs.size(),
+           inputs.size() / pipeSeconds, seqSeconds / pipeSeconds );
 
-   return( r );
+   return( 0 );
 }
 
 
 /*----------------------------------------------------------------------------*/
-/*! 2023-12-15
-Print usage
+/*! 2026-10-18
+Query a trained network with a stream of input vectors, each of which differs
+from the previous one in changedPercent percent of its values, taken from a
+random sample of the MNIST test dataset. Compare the throughput and the
+outputs of full and incremental queries.
 */
 /*----------------------------------------------------------------------------*/
-void usage( int argc, const char *argv[] )
+static int runIncremental( int argc, const char *argv[] )
 {
-   fprintf( stderr, "Usage: %s mnist_train.csv mnist_test.csv\n", argv[0] );
+   if( argc < 4 )
+   {
+      usage( argc, argv );
+      return( -1 );
+   }
+
+   std::string modelfname = argv[2];
+   std::string testfname = argv[3];
+   double changedPercent = argc > 4 ? std::stod( argv[4] ) : 2.0;
+   int fullInterval = argc > 5 ? std::stoi( argv[5] ) : 256;
+   int nQueries = 20000;
+
+   NeuralNetwork nn = NeuralNetwork( std::vector<int>() );
+   if( !nn.load( modelfname ) )
+   {
+      fprintf( stderr, "Couldn't load model file '%s'.\n", modelfname.c_str() );
+      return( -1 );
+   }
+
+   std::vector<std::vector<double> > inputs;
+   std::vector<int> digits;
+   if( mnist::readMNIST( testfname, inputs, digits ) < 1 )
+   {
+      fprintf( stderr, "Couldn't read MNIST test file '%s'.\n", testfname.c_str() );
+      return( -1 );
+   }
+
+   // The changes of each step
+   int nInputs = inputs[0].size();
+   int nChanged = std::max( 1, (int)( nInputs * changedPercent / 100.0 + 0.5 ) );
+   Random rng( Random::seed(), 0 );
+   std::vector<int> indices( (size_t)nQueries * nChanged );
+   std::vector<double> values( indices.size() );
+   for( size_t i = 0; i < indices.size(); i++ )
+   {
+      indices[i] = rng.below( nInputs );
+      values[i] = inputs[rng.below( inputs.size() )][indices[i]];
+   }
+
+   // Full queries
+   std::vector<double> v = inputs[0];
+   std::vector<double> fullOutputs( (size_t)nQueries * nn.numNeurons( nn.numLayers() - 1 ) );
+   auto t0 = std::chrono::steady_clock::now();
+   for( int q = 0; q < nQueries; q++ )
+   {
+      for( int k = 0; k < nChanged; k++ )
+      {
+         v[indices[(size_t)q * nChanged + k]] = values[(size_t)q * nChanged + k];
+      }
+      nn.query( v );
+      std::vector<double> o = nn.output();
+      std::copy( o.begin(), o.end(), fullOutputs.begin() + (size_t)q * o.size() );
+   }
+   double fullSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - t0 ).count();
+
+   // Incremental queries
+   IncrementalQuery iq( nn, fullInterval );
+   double maxDiff = 0.0;
+   v = inputs[0];
+   t0 = std::chrono::steady_clock::now();
+   for( int q = 0; q < nQueries; q++ )
+   {
+      for( int k = 0; k < nChanged; k++ )
+      {
+         v[indices[(size_t)q * nChanged + k]] = values[(size_t)q * nChanged + k];
+      }
+      iq.query( v );
+
+      const std::vector<double> &o = iq.output();
+      for( int j = 0; j < o.size(); j++ )
+      {
+         maxDiff = std::max( maxDiff, fabs( o[j] - fullOutputs[(size_t)q * o.size() + j] ) );
+      }
+   }
+   double incSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - t0 ).count();
+
+   printf( "%d queries, %d of %d inputs changed per query\n", nQueries, nChanged, nInputs );
+   printf( "full:        %.0f queries/s\n", nQueries / fullSeconds );
+   printf( "incremental: %.0f queries/s (%.2fx), %ld full, %ld incremental\n", nQueries / incSeconds,
+           fullSeconds / incSeconds, iq.numFull(), iq.numIncremental() );
+   printf( "max. difference of the outputs: %g\n", maxDiff );
+
+   return( 0 );
 }
 
 
 /*----------------------------------------------------------------------------*/
-/*! 2023-12-15
-Main program
+/*! 2026-10-18
+Compare uncached and cached queries of a stream of samples from the MNIST
+test dataset, repeatPercent percent of which repeat one of a small set of
+popular samples. The other samples are made unique by altering one input.
 */
 /*----------------------------------------------------------------------------*/
-int main( int argc, const char *argv[] )
+static int runCache( int argc, const char *argv[] )
 {
-   if( argc < 3 )
+   if( argc < 4 )
    {
       usage( argc, argv );
       return( -1 );
    }
 
-   std::string trainfname = argv[1];
-   std::string testfname = argv[2];
-
-   // Initialize the random number generator
-   std::srand( std::time( 0 ) );
+   std::string modelfname = argv[2];
+   std::string testfname = argv[3];
+   double repeatPercent = argc > 4 ? std::stod( argv[4] ) : 50.0;
+   int cacheMB = argc > 5 ? std::stoi( argv[5] ) : 64;
+   int nQueries = 20000;
+   int nPopular = 256;
 
-   // The neuronal network shall have 28x28=784 input neurons,
-   // 100 hidden neurons and 10 output neurons (1 for each possible digit 0..9)
-   NeuralNetwork nn( { 28 * 28, 100, 10 } );
-
-   // Open the input file
-   std::ifstream trainfile = std::ifstream( trainfname );
-   if( !trainfile.is_open() )
+   NeuralNetwork nn = NeuralNetwork( std::vector<int>() );
+   if( !nn.load( modelfname ) )
    {
-      fprintf( stderr, "Couldn't open training input file '%s'.\n", trainfname.c_str() );
+      fprintf( stderr, "Couldn't load model file '%s'.\n", modelfname.c_str() );
       return( -1 );
    }
 
-   std::vector<double> inVector;
-   int value;
+   std::vector<std::vector<double> > inputs;
+   std::vector<int> digits;
+   if( mnist::readMNIST( testfname, inputs, digits ) < 1 )
+   {
+      fprintf( stderr, "Couldn't read MNIST test file '%s'.\n", testfname.c_str() );
+      return( -1 );
+   }
 
-   // *** Train the neural network
-   // *** With the first nTrain annotated samples
-   printf( "Training..\n" );
-   int n;
-   for( n = 0;; n++ )
+   Random rng( Random::seed(), 0 );
+   std::vector<std::vector<double> > queries( nQueries );
+   for( int q = 0; q < nQueries; q++ )
    {
-      inVector.clear();
-      int digit = readMNIST( trainfile, inVector );
-      if( ( digit < 0 ) || ( inVector.size() != 28 * 28 ) )
+      if( rng.uniform() * 100.0 < repeatPercent )
       {
-         if( n < 10 )
-         {
-            fprintf( stderr, "Error reading MNIST file during training.\nFinished reading %d samples.\n", n );
-            trainfile.close();
-            return( -1 );
-         } else
-         {
-            break;
-         }
+         queries[q] = inputs[rng.below( std::min( nPopular, (int)inputs.size() ) )];
+      } else
+      {
+         queries[q] = inputs[rng.below( inputs.size() )];
+         queries[q][rng.below( queries[q].size() )] += 1e-3 * ( q + 1 );
       }
+   }
 
-      std::vector<double> expectedOutVector = convertToExpectedOut( digit, 0.01, 0.99 );
+   // Uncached queries
+   std::vector<std::vector<double> > outputs( nQueries );
+   auto t0 = std::chrono::steady_clock::now();
+   for( int q = 0; q < nQueries; q++ )
+   {
+      nn.query( queries[q] );
+      outputs[q] = nn.output();
+   }
+   double uncachedSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - t0 ).count();
 
-      // Here's where the training happens
-      nn.train( inVector, expectedOutVector, 0.2 );
+   // Cached queries
+   QueryCache cache( (size_t)cacheMB << 20, QUERY_CACHE_SHARDS );
+   nn.setCache( &cache );
+   long nMismatches = 0;
+   t0 = std::chrono::steady_clock::now();
+   for( int q = 0; q < nQueries; q++ )
+   {
+      nn.query( queries[q] );
+      nMismatches += nn.output() != outputs[q];
+   }
+   double cachedSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - t0 ).count();
+   long nHits = cache.numHits();
+   long nMisses = cache.numMisses();
+   long nEvictions = cache.numEvictions();
 
-      // Progress
-      if( n % 1000 == 0 )
+   // Hits only
+   t0 = std::chrono::steady_clock::now();
+   for( int q = 0; q < nQueries; q++ )
+   {
+      nn.query( queries[q % nPopular] );
+   }
+   double hitSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - t0 ).count();
+   nn.setCache( NULL );
+
+   printf( "%d queries, %.0f%% repeated\n", nQueries, repeatPercent );
+   printf( "uncached: %.0f queries/s, %.0f ns per query\n", nQueries / uncachedSeconds, 1e9 * uncachedSeconds / nQueries );
+   printf( "cached:   %.0f queries/s (%.2fx), %ld hits, %ld misses, %ld evictions\n", nQueries / cachedSeconds,
+           uncachedSeconds / cachedSeconds, nHits, nMisses, nEvictions );
+   printf( "hit:      %.0f ns per query, %zu entries in %.1f MB\n", 1e9 * hitSeconds / nQueries,
+           cache.numEntries(), cache.numBytes() / 1048576.0 );
+   printf( "outputs differing from uncached queries: %ld\n", nMismatches );
+
+   return( nMismatches == 0 ? 0 : -1 );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Measure the throughput of batched queries.
+\param nn The network
+\param inputs The input vectors
+\param batchSize The number of input vectors per query
+\return The number of input vectors per second
+*/
+/*----------------------------------------------------------------------------*/
+static double measureQueries( const NeuralNetwork &nn, const std::vector<std::vector<double> > &inputs, int batchSize )
+{
+   std::vector<std::vector<double> > batch;
+   std::vector<std::vector<double> > outputs;
+   long n = 0;
+   double elapsed = 0.0;
+   auto t0 = std::chrono::steady_clock::now();
+   for( size_t i = 0; elapsed < 0.5; i += batch.size() )
+   {
+      if( i >= inputs.size() )
       {
-         printf( "%d..\n", n );
+         i = 0;
       }
+      // The last batch may be partial, and so may all if there are fewer
+      // inputs than batchSize
+      batch.assign( inputs.begin() + i, inputs.begin() + std::min( i + batchSize, inputs.size() ) );
+      nn.query( batch, outputs );
+      n += batch.size();
+      elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - t0 ).count();
    }
 
-   printf( "Finished training with %d samples.\n", n );
+   return( n / elapsed );
+}
 
-   trainfile.close();
 
-   std::ifstream testfile = std::ifstream( testfname );
-   if( !testfile.is_open() )
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Compare the accuracy and the throughput of a trained network with its
+weights stored as double, bfloat16 and IEEE half precision, the latter two
+with each instruction set supported by the host.
+*/
+/*----------------------------------------------------------------------------*/
+static int runPrecision( int argc, const char *argv[] )
+{
+   if( argc < 4 )
    {
-      fprintf( stderr, "Couldn't open training input file '%s'.\n", testfname.c_str() );
+      usage( argc, argv );
       return( -1 );
    }
 
-   // ** Test the neural network
-   // ** With the next 10000 samples
-   int nFail = 0;
-   int nPass = 0;
-   printf( "Testing..\n" );
-   for( n = 0;; n++ )
+   std::string modelfname = argv[2];
+   std::string testfname = argv[3];
+   int batchSize = argc > 4 ? std::stoi( argv[4] ) : 64;
+
+   NeuralNetwork nn = NeuralNetwork( std::vector<int>() );
+   if( !nn.load( modelfname ) )
    {
-      inVector.clear();
-      int digit = readMNIST( testfile, inVector );
-      if( ( digit < 0 ) || ( inVector.size() != 28 * 28 ) )
-      {
-         if( n < 10 )
-         {
-            fprintf( stderr, "Error reading MNIST file during testing.\nFinished reading %d samples.\n", n );
-            testfile.close();
-            return( -1 );
-         } else
-         {
-            break;
-         }
-      }
+      fprintf( stderr, "Couldn't load model file '%s'.\n", modelfname.c_str() );
+      return( -1 );
+   }
 
-      // Query the network
-      nn.query( inVector );
-      std::vector<double> outVector = nn.output();
+   std::vector<std::vector<double> > inputs;
+   std::vector<int> digits;
+   if( mnist::readMNIST( testfname, inputs, digits ) < batchSize || batchSize < 1 )
+   {
+      fprintf( stderr, "Couldn't read %d samples from MNIST test file '%s'.\n", batchSize, testfname.c_str() );
+      return( -1 );
+   }
 
-      // Our network has 10 output neurons, each of which indicating
-      // the probability of detection of a specific digit. To determine
-      // which digit the network as a whole has detected, we use the
-      // number of the output neuron with the highest output value.
-      int detectedDigit = util::indexOfMaxValue( outVector );
+   std::vector<std::vector<double> > reference;
+   nn.query( inputs, reference );
 
-      // If that detected digit equals the annotated marker of the
-      // MNIST dataset, that's a pass
-      if( digit == detectedDigit )
-      {
-         nPass++;
-      } else
+   kernel::Config &config = kernel::config();
+   kernel::Isa best = kernel::bestIsa();
+   printf( "%-8s %-8s %10s %9s %10s %12s %12s\n", "format", "isa", "weights", "success", "max. diff",
+           "queries/s 1", "queries/s b" );
+
+   HalfMatrix::Format formats[] = { HalfMatrix::FORMAT_NONE, HalfMatrix::FORMAT_BF16, HalfMatrix::FORMAT_FP16 };
+   for( int f = 0; f < 3; f++ )
+   {
+      NeuralNetwork variant = nn;
+      double bytes = 0.0;
+      for( int i = 1; i < variant.numLayers(); i++ )
       {
-         nFail++;
+         variant.setWeightFormat( i, formats[f] );
+         bytes += (double)variant.weights( i ).rows() * variant.weights( i ).cols() *
+                  ( formats[f] == HalfMatrix::FORMAT_NONE ? sizeof( double ) : sizeof( uint16_t ) );
       }
 
-      // Progress
-      if( n % 1000 == 0 )
+      for( int isa = formats[f] == HalfMatrix::FORMAT_NONE ? best : kernel::ISA_SCALAR; isa <= best; isa++ )
       {
-         printf( "%d..\n", n );
+         config.isa = (kernel::Isa)isa;
+
+         std::vector<std::vector<double> > outputs;
+         variant.query( inputs, outputs );
+         int nPass = 0;
+         double maxDiff = 0.0;
+         for( int s = 0; s < outputs.size(); s++ )
+         {
+            nPass += util::indexOfMaxValue( outputs[s] ) == digits[s];
+            for( int j = 0; j < outputs[s].size(); j++ )
+            {
+               maxDiff = std::max( maxDiff, fabs( outputs[s][j] - reference[s][j] ) );
+            }
+         }
+
+         printf( "%-8s %-8s %7.2f MB %8.1f%% %10.2g %12.0f %12.0f\n", HalfMatrix::formatName( formats[f] ),
+                 formats[f] == HalfMatrix::FORMAT_NONE ? "-" : kernel::isaName( (kernel::Isa)isa ),
+                 bytes / 1048576.0, 100.0 * nPass / outputs.size(), maxDiff,
+                 measureQueries( variant, inputs, 1 ), measureQueries( variant, inputs, batchSize ) );
       }
    }
+   config.isa = best;
 
-   testfile.close();
+   return( 0 );
+}
 
-   printf( "Finished testing with %d samples.\n", n );
-   printf( "nPass = %d\nnFail = %d\nSuccess rate: %0.1f%%\n",
-      nPass, nFail, 100.0 * ( (double)nPass / (double)( nPass + nFail ) ) );
-   scanf( "\n" );
 
-   return( 0 );
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Measure the throughput of a Cascade with batched queries of all input
+vectors.
+\param cascade The cascade
+\param inputs The input vectors
+\return The number of input vectors per second
+*/
+/*----------------------------------------------------------------------------*/
+static double measureCascade( Cascade &cascade, const std::vector<std::vector<double> > &inputs )
+{
+   std::vector<std::vector<double> > outputs;
+   long n = 0;
+   double elapsed = 0.0;
+   auto t0 = std::chrono::steady_clock::now();
+   while( elapsed < 0.5 )
+   {
+      cascade.query( inputs, outputs );
+      n += inputs.size();
+      elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - t0 ).count();
+   }
+
+   return( n / elapsed );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Run the samples of the MNIST test dataset through a cascade of a small
+gatekeeper network and a large network. The first validationPercent percent
+of the samples calibrate the threshold of the gatekeeper, so the cascade is
+at most maxLossPercent percentage points less accurate than the large
+network. The remaining samples compare the accuracy, the average cost and
+the throughput of the cascade with those of both networks alone.
+*/
+/*----------------------------------------------------------------------------*/
+static int runCascade( int argc, const char *argv[] )
+{
+   if( argc < 5 )
+   {
+      usage( argc, argv );
+      return( -1 );
+   }
+
+   std::string smallfname = argv[2];
+   std::string largefname = argv[3];
+   std::string testfname = argv[4];
+   double maxLoss = argc > 5 ? std::stod( argv[5] ) : 0.5;
+   double validationPercent = argc > 6 ? std::stod( argv[6] ) : 50.0;
+
+   NeuralNetwork small = NeuralNetwork( std::vector<int>() );
+   NeuralNetwork large = NeuralNetwork( std::vector<int>() );
+   if( !small.load( smallfname ) || !large.load( largefname ) )
+   {
+      fprintf( stderr, "Couldn't load model files '%s' and '%s'.\n", smallfname.c_str(), largefname.c_str() );
+      return( -1 );
+   }
+   if( small.numNeurons( 0 ) != large.numNeurons( 0 ) ||
+       small.numNeurons( small.numLayers() - 1 ) != large.numNeurons( large.numLayers() - 1 ) )
+   {
+      fprintf( stderr, "The networks don't have the same inputs and outputs.\n" );
+      return( -1 );
+   }
+
+   std::vector<std::vector<double> > inputs;
+   std::vector<int> digits;
+   mnist::readMNIST( testfname, inputs, digits );
+   int nValidation = (int)( inputs.size() * validationPercent / 100.0 );
+   if( nValidation < 1 || nValidation >= inputs.size() )
+   {
+      fprintf( stderr, "Couldn't read enough samples from MNIST test file '%s'.\n", testfname.c_str() );
+      return( -1 );
+   }
+
+   std::vector<std::vector<double> > validation( inputs.begin(), inputs.begin() + nValidation );
+   std::vector<int> validationDigits( digits.begin(), digits.begin() + nValidation );
+   inputs.erase( inputs.begin(), inputs.begin() + nValidation );
+   digits.erase( digits.begin(), digits.begin() + nValidation );
+
+   Cascade cascade( small, large, 0.0 );
+   if( !cascade.calibrate( validation, validationDigits, maxLoss ) )
+   {
+      fprintf( stderr, "Calibration failed.\n" );
+      return( -1 );
+   }
+   printf( "Calibrated with %d samples for at most %.2f%% loss: threshold %.4f\n\n", nValidation, maxLoss,
+           cascade.threshold() );
+
+   std::vector<std::vector<double> > smallOut, largeOut, cascadeOut;
+   small.query( inputs, smallOut );
+   large.query( inputs, largeOut );
+   cascade.query( inputs, cascadeOut );
+   int nSmallPass = 0, nLargePass = 0, nCascadePass = 0;
+   for( int s = 0; s < inputs.size(); s++ )
+   {
+      nSmallPass += util::indexOfMaxValue( smallOut[s] ) == digits[s];
+      nLargePass += util::indexOfMaxValue( largeOut[s] ) == digits[s];
+      nCascadePass += util::indexOfMaxValue( cascadeOut[s] ) == digits[s];
+   }
+   double escalated = 100.0 * cascade.numEscalated() / cascade.numQueries();
+   double flops = cascade.flopsPerQuery();
+
+   printf( "%-8s %9s %10s %12s %12s\n", "network", "success", "escalated", "MFLOP/query", "queries/s" );
+   printf( "%-8s %8.1f%% %10s %12.3f %12.0f\n", "small", 100.0 * nSmallPass / inputs.size(), "-",
+           cascade.flopsSmall() * 1e-6, measureQueries( small, inputs, inputs.size() ) );
+   printf( "%-8s %8.1f%% %10s %12.3f %12.0f\n", "large", 100.0 * nLargePass / inputs.size(), "-",
+           cascade.flopsLarge() * 1e-6, measureQueries( large, inputs, inputs.size() ) );
+   printf( "%-8s %8.1f%% %9.1f%% %12.3f %12.0f\n", "cascade", 100.0 * nCascadePass / inputs.size(), escalated,
+           flops * 1e-6, measureCascade( cascade, inputs ) );
+   printf( "\nAverage cost of the cascade: %.1f%% of the large network\n", 100.0 * flops / cascade.flopsLarge() );
+
+   return( 0 );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Tune the layer kernels for a network on this host and save the fastest
+configuration to the profile file, replacing an earlier one. The network is
+either a topology or a saved model. Models are saved with double weights, so
+this tunes the double kernels; programs using 16 bit weights call
+autotune::tune() after setWeightFormat() instead.
+*/
+/*----------------------------------------------------------------------------*/
+static int runTune( int argc, const char *argv[] )
+{
+   if( argc < 3 )
+   {
+      usage( argc, argv );
+      return( -1 );
+   }
+
+   std::string network = argv[2];
+   std::string profile = argc > 3 ? argv[3] : autotune::defaultProfile();
+   int batchSize = argc > 4 ? std::stoi( argv[4] ) : 1;
+
+   NeuralNetwork nn = NeuralNetwork( std::vector<int>() );
+   std::vector<LayerSpec> layers;
+   if( LayerSpec::parse( network, layers ) )
+   {
+      nn = NeuralNetwork( layers );
+   } else
+   if( !nn.load( network ) )
+   {
+      fprintf( stderr, "Couldn't load model file '%s'.\n", network.c_str() );
+      return( -1 );
+   }
+
+   std::string key = autotune::hostKey() + ", " + autotune::networkKey( nn, batchSize );
+   printf( "Tuning the kernels for %s..\n", key.c_str() );
+   kernel::Config best;
+   autotune::tune( nn, batchSize, best, true );
+   if( !autotune::saveProfile( profile, key, best ) )
+   {
+      fprintf( stderr, "Couldn't save kernel profile '%s'.\n", profile.c_str() );
+      return( -1 );
+   }
+   printf( "Saved kernel profile to '%s'.\n", profile.c_str() );
+
+   return( 0 );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Profile the layers of a network, given as a topology or as a saved model,
+with hardware performance counters. A copy of the network is trained with
+nSamples samples of the MNIST test dataset, one at a time, and queried with
+the same samples in batches of batchSize samples. For both, a table of the
+passes over each layer is printed, see Profiler::print(). The layer kernels
+run on a single thread, which is the thread the counters count on.
+*/
+/*----------------------------------------------------------------------------*/
+static int runProfile( int argc, const char *argv[] )
+{
+   if( argc < 4 )
+   {
+      usage( argc, argv );
+      return( -1 );
+   }
+
+   std::string network = argv[2];
+   std::string testfname = argv[3];
+   int nSamples = argc > 4 ? std::stoi( argv[4] ) : 1000;
+   int batchSize = argc > 5 ? std::stoi( argv[5] ) : 64;
+
+   NeuralNetwork nn = NeuralNetwork( std::vector<int>() );
+   std::vector<LayerSpec> layers;
+   if( LayerSpec::parse( network, layers ) )
+   {
+      nn = NeuralNetwork( layers );
+   } else
+   if( !nn.load( network ) )
+   {
+      fprintf( stderr, "Couldn't load model file '%s'.\n", network.c_str() );
+      return( -1 );
+   }
+
+   std::vector<std::vector<double> > inputs;
+   std::vector<int> digits;
+   mnist::readMNIST( testfname, inputs, digits );
+   if( inputs.empty() || inputs[0].size() != nn.numNeurons( 0 ) || nn.numNeurons( nn.numLayers() - 1 ) != 10 )
+   {
+      fprintf( stderr, "Couldn't read samples for the network from MNIST test file '%s'.\n", testfname.c_str() );
+      return( -1 );
+   }
+   if( inputs.size() > nSamples )
+   {
+      inputs.resize( nSamples );
+      digits.resize( nSamples );
+   }
+
+   kernel::config().maxThreads = 1;
+   double peak = Profiler::measurePeak();
+   Profiler profiler;
+   printf( "Peak of the layer kernel: %.2f GFLOP/s\n", peak );
+   if( !profiler.available() )
+   {
+      printf( "Hardware counters are not available (%s), see /proc/sys/kernel/perf_event_paranoid.\n"
+              "Only the time and the throughput of each pass are shown.\n", profiler.error().c_str() );
+   } else
+   if( !profiler.error().empty() )
+   {
+      printf( "Some counters are not available (%s), they are shown as '-'.\n", profiler.error().c_str() );
+   }
+
+   bool softmax = nn.layer( nn.numLayers() - 1 ).type == LayerSpec::LAYER_SOFTMAX;
+   NeuralNetwork trainee = nn;
+   trainee.setProfiler( &profiler );
+   for( int s = 0; s < inputs.size(); s++ )
+   {
+      trainee.train( inputs[s], mnist::convertToExpectedOut( digits[s], softmax ? 0.0 : 0.01, softmax ? 1.0 : 0.99 ), 0.01 );
+   }
+   printf( "\nTraining, %d samples one at a time:\n", (int)inputs.size() );
+   profiler.print( trainee, peak );
+
+   profiler.reset();
+   nn.setProfiler( &profiler );
+   for( int s = 0; s < inputs.size(); s += batchSize )
+   {
+      std::vector<std::vector<double> > batch( inputs.begin() + s, inputs.begin() + std::min( (size_t)s + batchSize, inputs.size() ) );
+      std::vector<std::vector<double> > outputs;
+      nn.query( batch, outputs );
+   }
+   printf( "\nQueries, %d samples in batches of %d:\n", (int)inputs.size(), batchSize );
+   profiler.print( nn, peak );
+
+   return( 0 );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Parse the topology of a network for MNIST.
+\param topology The topology in the syntax of LayerSpec::parse()
+\param output The output layer: "sigmoid" keeps the last layer as it is,
+"softmax" turns a dense last layer into a softmax layer
+\param layers Receives the layers
+\return true on success, false if the topology is invalid or doesn't have
+28x28 inputs and 10 outputs
+*/
+/*----------------------------------------------------------------------------*/
+static bool parseTopology( std::string topology, std::string output, std::vector<LayerSpec> &layers )
+{
+   if( !LayerSpec::parse( topology, layers ) ||
+       layers[0].size() != 28 * 28 || layers[layers.size() - 1].size() != 10 )
+   {
+      fprintf( stderr, "Invalid topology '%s'.\n", topology.c_str() );
+      return( false );
+   }
+
+   LayerSpec &last = layers[layers.size() - 1];
+   if( output == "softmax" && last.type == LayerSpec::LAYER_DENSE )
+   {
+      last = LayerSpec::softmax( last.size() );
+   } else
+   if( output != "sigmoid" && output != "softmax" )
+   {
+      fprintf( stderr, "Invalid output layer '%s'.\n", output.c_str() );
+      return( false );
+   }
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Read the MNIST training dataset into memory, one byte per pixel.
+\param trainfname The name of the MNIST training CSV file
+\param dataset Receives the samples
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+static bool readTrainingSet( std::string trainfname, mnist::Dataset &dataset )
+{
+   int nSamples = mnist::readMNIST( trainfname, dataset );
+   if( nSamples < 0 )
+   {
+      fprintf( stderr, "Couldn't open training input file '%s'.\n", trainfname.c_str() );
+      return( false );
+   }
+   if( nSamples < 10 )
+   {
+      fprintf( stderr, "Error reading MNIST file during training.\nFinished reading %d samples.\n", nSamples );
+      return( false );
+   }
+
+   printf( "Read %d training samples (%.1f MB).\n", nSamples, dataset.pixels.size() / 1048576.0 );
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Train a network with all annotated samples, in random order in each epoch.
+\param nn The network
+\param dataset The training samples
+\param nEpochs The number of epochs
+\param seed The seed of the shuffling
+\param alpha The learning rate
+\param verbose If true, print the progress
+\param store If not NULL, a snapshot of the network is published to this
+store every publishInterval samples and after the last sample
+\param publishInterval The number of samples between two snapshots
+\param selector If not NULL, only the samples picked by this selector are
+backpropagated
+*/
+/*----------------------------------------------------------------------------*/
+static void trainNetwork( NeuralNetwork &nn, const mnist::Dataset &dataset, int nEpochs, uint64_t seed, double alpha, bool verbose,
+                          ModelStore *store = NULL, int publishInterval = 0, BackpropSelector *selector = NULL )
+{
+   int nSamples = dataset.size();
+   std::vector<int> order( nSamples );
+   for( int i = 0; i < nSamples; i++ )
+   {
+      order[i] = i;
+   }
+
+   // A softmax output layer expects probabilities, which add up to 1
+   bool softmax = nn.layer( nn.numLayers() - 1 ).type == LayerSpec::LAYER_SOFTMAX;
+   double falseVal = softmax ? 0.0 : 0.01;
+   double trueVal = softmax ? 1.0 : 0.99;
+
+   nn.setSelector( selector );
+   for( int epoch = 0; epoch < nEpochs; epoch++ )
+   {
+      Random rng( seed, RANDOM_SHUFFLE_STREAM + epoch );
+      rng.shuffle( order );
+      double loss = 0.0;
+      auto t0 = std::chrono::steady_clock::now();
+      if( selector )
+      {
+         selector->resetStats();
+      }
+
+      for( int n = 0; n < nSamples; n++ )
+      {
+         int nSample = order[n];
+         std::vector<double> expectedOutVector = mnist::convertToExpectedOut( dataset.digits[nSample], falseVal, trueVal );
+
+         // Here's where the training happens
+         nn.train( dataset.sample( nSample ), dataset.levels, expectedOutVector, alpha );
+         loss += nn.loss();
+
+         if( store && publishInterval > 0 && ( (long)epoch * nSamples + n + 1 ) % publishInterval == 0 )
+         {
+            store->publish( nn );
+         }
+
+         // Progress
+         if( verbose && n % 1000 == 0 )
+         {
+            printf( "%d..\n", n );
+         }
+      }
+
+      if( verbose && selector )
+      {
+         printf( "Finished epoch %d, mean loss %.4f, %.1f%% skipped, %.2f s.\n", epoch + 1, loss / nSamples,
+                 100.0 * selector->skipRate(), std::chrono::duration<double>( std::chrono::steady_clock::now() - t0 ).count() );
+      } else
+      if( verbose )
+      {
+         printf( "Finished epoch %d, mean loss %.4f.\n", epoch + 1, loss / nSamples );
+      }
+   }
+   nn.setSelector( NULL );
+
+   // The last sample may have been published already
+   if( store && ( publishInterval <= 0 || ( (long)nEpochs * nSamples ) % publishInterval != 0 ) )
+   {
+      store->publish( nn );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Evaluate each new snapshot of a network with the MNIST test dataset while the
+network is being trained, until the snapshot after the last epoch has been
+evaluated. Snapshots published while an evaluation is running are skipped.
+\param store The store of the network
+\param dataset The test samples
+\param publishInterval The number of samples between two snapshots
+\param nTrainingSamples The number of samples of all epochs
+*/
+/*----------------------------------------------------------------------------*/
+static void evaluateSnapshots( ModelStore &store, const mnist::Dataset &dataset, int publishInterval, long nTrainingSamples )
+{
+   uint64_t nLast = ( nTrainingSamples + publishInterval - 1 ) / publishInterval;
+   uint64_t nEvaluated = 0;
+   while( nEvaluated < nLast )
+   {
+      if( store.numPublished() - 1 == nEvaluated )
+      {
+         std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+         continue;
+      }
+
+      // The snapshot is held only while the test samples are queried
+      std::vector<std::vector<double> > outputs;
+      {
+         ModelStore::Snapshot snapshot( store );
+         nEvaluated = snapshot.sequence();
+         snapshot.network().query( dataset.pixels.data(), dataset.size(), dataset.levels, outputs );
+      }
+
+      int nPass = 0;
+      for( int i = 0; i < outputs.size(); i++ )
+      {
+         nPass += util::indexOfMaxValue( outputs[i] ) == dataset.digits[i];
+      }
+      printf( "Snapshot %llu after %ld samples: success rate %0.1f%%\n", (unsigned long long)nEvaluated,
+              std::min( (long)nEvaluated * publishInterval, nTrainingSamples ),
+              100.0 * nPass / std::max( (size_t)1, outputs.size() ) );
+   }
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Test a network with the MNIST test dataset and print the success rate.
+\param nn The network
+\param testfname The name of the MNIST test CSV file
+\return true on success, false if the file couldn't be read
+*/
+/*----------------------------------------------------------------------------*/
+static bool testNetwork( NeuralNetwork &nn, std::string testfname )
+{
+   std::ifstream testfile = std::ifstream( testfname );
+   if( !testfile.is_open() )
+   {
+      fprintf( stderr, "Couldn't open training input file '%s'.\n", testfname.c_str() );
+      return( false );
+   }
+
+   std::vector<double> inVector;
+
+   // ** Test the neural network
+   // ** With the next 10000 samples
+   int nFail = 0;
+   int nPass = 0;
+   int n;
+   printf( "Testing..\n" );
+   for( n = 0;; n++ )
+   {
+      inVector.clear();
+      int digit = mnist::readMNIST( testfile, inVector );
+      if( ( digit < 0 ) || ( inVector.size() != 28 * 28 ) )
+      {
+         if( n < 10 )
+         {
+            fprintf( stderr, "Error reading MNIST file during testing.\nFinished reading %d samples.\n", n );
+            testfile.close();
+            return( false );
+         } else
+         {
+            break;
+         }
+      }
+
+      // Query the network
+      nn.query( inVector );
+      std::vector<double> outVector = nn.output();
+
+      // Our network has 10 output neurons, each of which indicating
+      // the probability of detection of a specific digit. To determine
+      // which digit the network as a whole has detected, we use the
+      // number of the output neuron with the highest output value.
+      int detectedDigit = util::indexOfMaxValue( outVector );
+
+      // If that detected digit equals the annotated marker of the
+      // MNIST dataset, that's a pass
+      if( digit == detectedDigit )
+      {
+         nPass++;
+      } else
+      {
+         nFail++;
+      }
+
+      // Progress
+      if( n % 1000 == 0 )
+      {
+         printf( "%d..\n", n );
+      }
+   }
+
+   testfile.close();
+
+   printf( "Finished testing with %d samples.\n", n );
+   printf( "nPass = %d\nnFail = %d\nSuccess rate: %0.1f%%\n",
+      nPass, nFail, 100.0 * ( (double)nPass / (double)( nPass + nFail ) ) );
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Save a network to a model file, if a file name is given.
+\param nn The network
+\param modelfname The name of the model file or NULL
+\return true on success, false on failure
+*/
+/*----------------------------------------------------------------------------*/
+static bool saveNetwork( const NeuralNetwork &nn, const char *modelfname )
+{
+   if( modelfname )
+   {
+      if( !nn.save( modelfname ) )
+      {
+         fprintf( stderr, "Couldn't save model file '%s'.\n", modelfname );
+         return( false );
+      }
+      printf( "Saved model to '%s'.\n", modelfname );
+   }
+
+   return( true );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Print a row of the comparison of factorized networks.
+\param nn The network
+\param layer The factorized layer, or "-"
+\param rank The rank of the factorization, or "-"
+\param energy The fraction of the weight matrix kept by the factorization, or
+a negative value
+\param inputs The input vectors to measure the success rate and the latency with
+\param digits The expected digit of each input vector
+\param trainSet The training samples to fine-tune a copy of the network
+with, or NULL
+\param nEpochs The number of epochs of the fine-tuning
+\param seed The seed of the shuffling
+\param alpha The learning rate of the fine-tuning
+*/
+/*----------------------------------------------------------------------------*/
+static void printFactorization( const NeuralNetwork &nn, const char *layer, const char *rank, double energy,
+                                const std::vector<std::vector<double> > &inputs, const std::vector<int> &digits,
+                                const mnist::Dataset *trainSet, int nEpochs, uint64_t seed, double alpha )
+{
+   char tuned[16] = "-";
+   if( trainSet )
+   {
+      NeuralNetwork trainee = nn;
+      trainNetwork( trainee, *trainSet, nEpochs, seed, alpha, false );
+      snprintf( tuned, sizeof( tuned ), "%.1f%%", lowrank::successRate( trainee, inputs, digits ) );
+   }
+
+   char kept[16] = "-";
+   if( energy >= 0.0 )
+   {
+      snprintf( kept, sizeof( kept ), "%.1f%%", 100.0 * energy );
+   }
+
+   printf( "%6s %5s %8s %9ld %12.4f %9.1f %8.1f%% %8s\n", layer, rank, kept, lowrank::numParameters( nn ),
+           2.0 * lowrank::numMultiplyAdds( nn ) * 1e-6, 1e6 / measureQueries( nn, inputs, 1 ),
+           lowrank::successRate( nn, inputs, digits ), tuned );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Compress the dense layers of a trained network by replacing their weight
+matrices with truncated singular value decompositions (see
+lowrank::factorize()). First, each factorizable layer is factorized alone
+with each candidate rank, and the weights, the cost, the latency and the
+success rate of the network are compared with those of the original network
+on the second half of the MNIST test dataset. With a training dataset (-t),
+the success rate after fine-tuning a copy with a few epochs of training is
+shown as well.
+
+Then the ranks given with -r are applied, or the ranks are chosen for an
+accuracy budget (-b) on the first half of the test dataset. The compressed
+network is fine-tuned if there's a training dataset and saved, if a file is
+given.
+*/
+/*----------------------------------------------------------------------------*/
+static int runLowRank( int argc, const char *argv[] )
+{
+   std::string rankList;
+   double maxLoss = -1.0;
+   std::string trainfname;
+   int nEpochs = 1;
+   double alpha = 0.01;
+   uint64_t seed = std::time( 0 );
+   int opt;
+   while( ( opt = getopt( argc - 1, (char * const *)argv + 1, "r:b:t:e:a:s:" ) ) != -1 )
+   {
+      switch( opt )
+      {
+         case 'r':
+            rankList = optarg;
+            break;
+         case 'b':
+            maxLoss = std::stod( optarg );
+            break;
+         case 't':
+            trainfname = optarg;
+            break;
+         case 'e':
+            nEpochs = std::stoi( optarg );
+            break;
+         case 'a':
+            alpha = std::stod( optarg );
+            break;
+         case 's':
+            seed = std::stoull( optarg );
+            break;
+         default:
+            usage( argc, argv );
+            return( -1 );
+      }
+   }
+
+   int nArgs = argc - 1 - optind;
+   const char **args = argv + 1 + optind;
+   if( nArgs < 2 )
+   {
+      usage( argc, argv );
+      return( -1 );
+   }
+
+   NeuralNetwork nn = NeuralNetwork( std::vector<int>() );
+   if( !nn.load( args[0] ) )
+   {
+      fprintf( stderr, "Couldn't load model file '%s'.\n", args[0] );
+      return( -1 );
+   }
+
+   std::vector<std::vector<double> > inputs;
+   std::vector<int> digits;
+   mnist::readMNIST( args[1], inputs, digits );
+   if( inputs.size() < 2 || inputs[0].size() != nn.numNeurons( 0 ) || nn.numNeurons( nn.numLayers() - 1 ) != 10 )
+   {
+      fprintf( stderr, "Couldn't read samples for the network from MNIST test file '%s'.\n", args[1] );
+      return( -1 );
+   }
+
+   // The ranks are chosen with the first half of the samples and the
+   // networks are compared with the second half
+   int nValidation = inputs.size() / 2;
+   std::vector<std::vector<double> > validation( inputs.begin(), inputs.begin() + nValidation );
+   std::vector<int> validationDigits( digits.begin(), digits.begin() + nValidation );
+   inputs.erase( inputs.begin(), inputs.begin() + nValidation );
+   digits.erase( digits.begin(), digits.begin() + nValidation );
+
+   mnist::Dataset trainSet;
+   if( !trainfname.empty() && !readTrainingSet( trainfname, trainSet ) )
+   {
+      return( -1 );
+   }
+   const mnist::Dataset *tuneSet = trainfname.empty() ? NULL : &trainSet;
+   Random::setSeed( seed );
+
+   std::vector<lowrank::Decomposition> decompositions( nn.numLayers() );
+   for( int i = 1; i < nn.numLayers(); i++ )
+   {
+      if( lowrank::factorizable( nn, i ) )
+      {
+         lowrank::decompose( nn.weights( i ), decompositions[i] );
+      }
+   }
+
+   printf( "%6s %5s %8s %9s %12s %9s %9s %8s\n", "layer", "rank", "energy", "weights", "MFLOP/query", "us/query", "success", "tuned" );
+   printFactorization( nn, "-", "-", -1.0, inputs, digits, tuneSet, nEpochs, seed, alpha );
+   for( int i = 1; i < nn.numLayers(); i++ )
+   {
+      if( !lowrank::factorizable( nn, i ) )
+      {
+         continue;
+      }
+
+      std::vector<int> candidates = lowrank::candidateRanks( nn, i );
+      for( int c = 0; c < candidates.size(); c++ )
+      {
+         std::vector<int> ranks( nn.numLayers(), 0 );
+         ranks[i] = candidates[c];
+         NeuralNetwork factorized = NeuralNetwork( std::vector<int>() );
+         if( lowrank::factorize( nn, decompositions, ranks, factorized ) )
+         {
+            std::string layer = std::to_string( i ), rank = std::to_string( candidates[c] );
+            printFactorization( factorized, layer.c_str(), rank.c_str(), lowrank::energy( decompositions[i], candidates[c] ),
+                                inputs, digits, tuneSet, nEpochs, seed, alpha );
+         }
+      }
+   }
+
+   std::vector<int> ranks( nn.numLayers(), 0 );
+   if( !rankList.empty() )
+   {
+      std::vector<std::string> items = util::strsplit( rankList, ",", false );
+      for( int i = 0; i < items.size(); i++ )
+      {
+         int layer = 0, rank = 0;
+         if( sscanf( items[i].c_str(), "%d:%d", &layer, &rank ) != 2 || !lowrank::factorizable( nn, layer ) || rank < 1 )
+         {
+            fprintf( stderr, "Invalid rank '%s'.\n", items[i].c_str() );
+            return( -1 );
+         }
+         ranks[layer] = rank;
+      }
+   } else
+   if( maxLoss >= 0.0 )
+   {
+      lowrank::chooseRanks( nn, decompositions, validation, validationDigits, maxLoss, ranks );
+   } else
+   {
+      return( 0 );
+   }
+
+   NeuralNetwork compressed = NeuralNetwork( std::vector<int>() );
+   if( !lowrank::factorize( nn, decompositions, ranks, compressed ) )
+   {
+      fprintf( stderr, "Couldn't factorize the network.\n" );
+      return( -1 );
+   }
+
+   std::string topology;
+   for( int i = 0; i < compressed.numLayers(); i++ )
+   {
+      topology += ( i > 0 ? "," : "" ) + compressed.layer( i ).toString();
+   }
+   printf( "\nCompressed network: %s\n", topology.c_str() );
+   printf( "%ld of %ld weights (%.1f%%), success rate %.1f%% (original: %.1f%%)\n", lowrank::numParameters( compressed ),
+           lowrank::numParameters( nn ), 100.0 * lowrank::numParameters( compressed ) / lowrank::numParameters( nn ),
+           lowrank::successRate( compressed, inputs, digits ), lowrank::successRate( nn, inputs, digits ) );
+   if( tuneSet )
+   {
+      trainNetwork( compressed, trainSet, nEpochs, seed, alpha, false );
+      printf( "Success rate after fine-tuning for %d epochs: %.1f%%\n", nEpochs, lowrank::successRate( compressed, inputs, digits ) );
+   }
+
+   if( nArgs > 2 && !saveNetwork( compressed, args[2] ) )
+   {
+      return( -1 );
+   }
+
+   return( 0 );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Train all combinations of several topologies (-l), output layers (-o) and
+learning rates (-a) concurrently with one shared copy of the MNIST training
+dataset, test them with the MNIST test dataset and print a comparison.
+*/
+/*----------------------------------------------------------------------------*/
+static int runSweep( int argc, const char *argv[] )
+{
+   int nEpochs = 1;
+   uint64_t seed = std::time( 0 );
+   std::vector<std::string> topologies;
+   std::vector<std::string> outputs;
+   std::vector<double> alphas;
+   int chunkSize = 64;
+   int opt;
+   while( ( opt = getopt( argc - 1, (char * const *)argv + 1, "e:s:l:o:a:b:" ) ) != -1 )
+   {
+      switch( opt )
+      {
+         case 'e':
+            nEpochs = std::stoi( optarg );
+            break;
+         case 's':
+            seed = std::stoull( optarg );
+            break;
+         case 'l':
+            topologies.push_back( optarg );
+            break;
+         case 'o':
+            outputs.push_back( optarg );
+            break;
+         case 'a':
+         {
+            std::vector<std::string> values = util::strsplit( optarg, ",", false );
+            for( int i = 0; i < values.size(); i++ )
+            {
+               alphas.push_back( std::stod( values[i] ) );
+            }
+            break;
+         }
+         case 'b':
+            chunkSize = std::stoi( optarg );
+            break;
+         default:
+            usage( argc, argv );
+            return( -1 );
+      }
+   }
+
+   int nArgs = argc - 1 - optind;
+   const char **args = argv + 1 + optind;
+   if( nArgs < 2 )
+   {
+      usage( argc, argv );
+      return( -1 );
+   }
+   if( topologies.empty() )
+   {
+      topologies.push_back( "784,100,10" );
+   }
+   if( outputs.empty() )
+   {
+      outputs.push_back( "sigmoid" );
+   }
+   if( alphas.empty() )
+   {
+      alphas.push_back( 0.2 );
+   }
+
+   Random::setSeed( seed );
+   printf( "Random seed: %llu\n", (unsigned long long)seed );
+
+   mnist::Dataset trainSet;
+   mnist::Dataset testSet;
+   if( !readTrainingSet( args[0], trainSet ) )
+   {
+      return( -1 );
+   }
+   if( mnist::readMNIST( args[1], testSet ) < 1 )
+   {
+      fprintf( stderr, "Couldn't read MNIST test file '%s'.\n", args[1] );
+      return( -1 );
+   }
+
+   Sweep sweep( trainSet, nEpochs, seed, chunkSize );
+   for( int t = 0; t < topologies.size(); t++ )
+   {
+      for( int o = 0; o < outputs.size(); o++ )
+      {
+         std::vector<LayerSpec> layers;
+         if( !parseTopology( topologies[t], outputs[o], layers ) )
+         {
+            return( -1 );
+         }
+
+         for( int a = 0; a < alphas.size(); a++ )
+         {
+            if( !sweep.add( topologies[t] + " " + outputs[o], layers, alphas[a] ) )
+            {
+               fprintf( stderr, "Invalid topology '%s'.\n", topologies[t].c_str() );
+               return( -1 );
+            }
+         }
+      }
+   }
+
+   printf( "Training %d variants..\n", sweep.numVariants() );
+   sweep.train();
+   printf( "Finished training, %0.0f samples/s.\n\n", sweep.samplesPerSecond() );
+
+   sweep.test( testSet );
+   sweep.printResults();
+
+   return( 0 );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Train a network with a live stream of labeled samples from stdin ("-"), from
+a FIFO or file, or from the clients of a Unix domain socket, which is created
+if the path doesn't name a FIFO or file. Training stops at the end of the
+stream or when interrupted with SIGINT or SIGTERM, and the network is saved.
+The network is either a new one or loaded from a model file with -m.
+*/
+/*----------------------------------------------------------------------------*/
+static int runOnline( int argc, const char *argv[] )
+{
+   uint64_t seed = std::time( 0 );
+   std::string topology = "784,100,10";
+   std::string output = "sigmoid";
+   std::string initialfname;
+   StreamTrainer::Format format = StreamTrainer::FORMAT_CSV;
+   double alpha = 0.2;
+   int maxBatchSize = 64;
+   int maxLatencyMs = 50;
+   int windowSize = 1000;
+   int queueSize = 4096;
+   int opt;
+   while( ( opt = getopt( argc - 1, (char * const *)argv + 1, "s:l:o:m:f:a:b:L:w:q:" ) ) != -1 )
+   {
+      switch( opt )
+      {
+         case 's':
+            seed = std::stoull( optarg );
+            break;
+         case 'l':
+            topology = optarg;
+            break;
+         case 'o':
+            output = optarg;
+            break;
+         case 'm':
+            initialfname = optarg;
+            break;
+         case 'f':
+            if( !StreamTrainer::parseFormat( optarg, format ) )
+            {
+               usage( argc, argv );
+               return( -1 );
+            }
+            break;
+         case 'a':
+            alpha = std::stod( optarg );
+            break;
+         case 'b':
+            maxBatchSize = std::stoi( optarg );
+            break;
+         case 'L':
+            maxLatencyMs = std::stoi( optarg );
+            break;
+         case 'w':
+            windowSize = std::stoi( optarg );
+            break;
+         case 'q':
+            queueSize = std::stoi( optarg );
+            break;
+         default:
+            usage( argc, argv );
+            return( -1 );
+      }
+   }
+
+   int nArgs = argc - 1 - optind;
+   const char **args = argv + 1 + optind;
+   if( nArgs < 1 )
+   {
+      usage( argc, argv );
+      return( -1 );
+   }
+   std::string source = args[0];
+   const char *modelfname = nArgs > 1 ? args[1] : NULL;
+
+   Random::setSeed( seed );
+   NeuralNetwork nn = NeuralNetwork( std::vector<int>() );
+   if( !initialfname.empty() )
+   {
+      if( !nn.load( initialfname ) )
+      {
+         fprintf( stderr, "Couldn't load model file '%s'.\n", initialfname.c_str() );
+         return( -1 );
+      }
+   } else
+   {
+      std::vector<LayerSpec> layers;
+      if( !parseTopology( topology, output, layers ) )
+      {
+         return( -1 );
+      }
+      nn = NeuralNetwork( layers );
+      fprintf( stderr, "Random seed: %llu\n", (unsigned long long)seed );
+   }
+
+   signal( SIGPIPE, SIG_IGN );
+   signal( SIGINT, StreamTrainer::handleSignal );
+   signal( SIGTERM, StreamTrainer::handleSignal );
+
+   StreamTrainer trainer( nn, alpha, maxBatchSize, maxLatencyMs * 1000, windowSize, queueSize );
+   struct stat st;
+   bool ok;
+   if( source == "-" )
+   {
+      ok = trainer.trainStream( STDIN_FILENO, format );
+   } else
+   if( stat( source.c_str(), &st ) == 0 && ( S_ISFIFO( st.st_mode ) || S_ISREG( st.st_mode ) ) )
+   {
+      int fd = open( source.c_str(), O_RDONLY );
+      if( fd < 0 )
+      {
+         perror( source.c_str() );
+         return( -1 );
+      }
+      ok = trainer.trainStream( fd, format );
+      close( fd );
+   } else
+   {
+      ok = trainer.trainSocket( source, format );
+   }
+
+   if( !ok || !saveNetwork( nn, modelfname ) )
+   {
+      return( -1 );
+   }
+
+   return( 0 );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2026-10-18
+Train a network with several worker processes which synchronize with a ring
+allreduce, then test it with the MNIST test dataset. With -v, check that a
+single worker yields exactly the same network as training in this process,
+over at least 2 epochs, so the shuffling of later epochs is checked as well.
+With -S, measure the scaling efficiency with 1, 2, 4, .. workers up to the
+number given with -n.
+*/
+/*----------------------------------------------------------------------------*/
+static int runDistributed( int argc, const char *argv[] )
+{
+   int nWorkers = ThreadPool::allowedCpus().size();
+   int syncInterval = 16;
+   DistributedTrainer::TransportType transport = DistributedTrainer::TRANSPORT_SHM;
+   int basePort = 17000;
+   int nEpochs = 1;
+   uint64_t seed = std::time( 0 );
+   bool verify = false;
+   bool scaling = false;
+   std::string topology = "784,100,10";
+   std::string output = "sigmoid";
+
+   // Parse the options following the mode
+   int opt;
+   while( ( opt = getopt( argc - 1, (char * const *)argv + 1, "n:k:t:p:e:s:l:o:vS" ) ) != -1 )
+   {
+      switch( opt )
+      {
+         case 'n':
+            nWorkers = std::stoi( optarg );
+            break;
+         case 'k':
+            syncInterval = std::stoi( optarg );
+            break;
+         case 't':
+            transport = std::string( optarg ) == "tcp" ? DistributedTrainer::TRANSPORT_TCP : DistributedTrainer::TRANSPORT_SHM;
+            break;
+         case 'p':
+            basePort = std::stoi( optarg );
+            break;
+         case 'e':
+            nEpochs = std::stoi( optarg );
+            break;
+         case 's':
+            seed = std::stoull( optarg );
+            break;
+         case 'l':
+            topology = optarg;
+            break;
+         case 'o':
+            output = optarg;
+            break;
+         case 'v':
+            verify = true;
+            break;
+         case 'S':
+            scaling = true;
+            break;
+         default:
+            usage( argc, argv );
+            return( -1 );
+      }
+   }
+
+   int nArgs = argc - 1 - optind;
+   const char **args = argv + 1 + optind;
+   std::vector<LayerSpec> layers;
+   if( nArgs < 2 || nWorkers < 1 )
+   {
+      usage( argc, argv );
+      return( -1 );
+   }
+   if( !parseTopology( topology, output, layers ) )
+   {
+      return( -1 );
+   }
+
+   Random::setSeed( seed );
+   printf( "Random seed: %llu\n", (unsigned long long)seed );
+
+   mnist::Dataset trainSet;
+   if( !readTrainingSet( args[0], trainSet ) )
+   {
+      return( -1 );
+   }
+
+   NeuralNetwork nn( layers );
+
+   if( verify )
+   {
+      NeuralNetwork single = nn;
+      NeuralNetwork distributed = nn;
+      int nVerifyEpochs = std::max( nEpochs, 2 );
+
+      trainNetwork( single, trainSet, nVerifyEpochs, seed, 0.2, false );
+      DistributedTrainer trainer( distributed, 1, syncInterval, transport, basePort );
+      if( !trainer.train( trainSet, nVerifyEpochs, seed, 0.2 ) )
+      {
+         fprintf( stderr, "Distributed training failed.\n" );
+         return( -1 );
+      }
+
+      std::vector<double> ws, wd;
+      single.getWeights( ws );
+      distributed.getWeights( wd );
+      bool same = ws == wd;
+      printf( "Single process and 1 worker: %s\n", same ? "identical" : "DIFFERENT" );
+      return( same ? 0 : -1 );
+   }
+
+   if( scaling )
+   {
+      printf( "%8s %14s %10s\n", "workers", "samples/s", "efficiency" );
+      double base = 0.0;
+      for( int n = 1; n <= nWorkers; n *= 2 )
+      {
+         NeuralNetwork replica = nn;
+         DistributedTrainer trainer( replica, n, syncInterval, transport, basePort );
+         if( !trainer.train( trainSet, nEpochs, seed, 0.2 ) )
+         {
+            fprintf( stderr, "Distributed training with %d workers failed.\n", n );
+            return( -1 );
+         }
+         if( n == 1 )
+         {
+            base = trainer.samplesPerSecond();
+         }
+         printf( "%8d %14.0f %9.0f%%\n", n, trainer.samplesPerSecond(),
+            100.0 * trainer.samplesPerSecond() / ( n * base ) );
+      }
+      return( 0 );
+   }
+
+   printf( "Training with %d workers, synchronizing every %d samples..\n", nWorkers, syncInterval );
+   DistributedTrainer trainer( nn, nWorkers, syncInterval, transport, basePort );
+   if( !trainer.train( trainSet, nEpochs, seed, 0.2 ) )
+   {
+      fprintf( stderr, "Distributed training failed.\n" );
+      return( -1 );
+   }
+   printf( "Finished training with %ld samples, %0.0f samples/s.\n", (long)nEpochs * trainSet.size(), trainer.samplesPerSecond() );
+
+   if( !testNetwork( nn, args[1] ) || !saveNetwork( nn, nArgs > 2 ? args[2] : NULL ) )
+   {
+      return( -1 );
+   }
+
+   return( 0 );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2023-12-15
+Train a network with the MNIST training dataset and test it with the MNIST
+test dataset. Optionally, save the trained network to a file.
+*/
+/*----------------------------------------------------------------------------*/
+static int runTraining( int argc, const char *argv[] )
+{
+   if( argc < 3 )
+   {
+      usage( argc, argv );
+      return( -1 );
+   }
+
+   int nEpochs = 1;
+   uint64_t seed = std::time( 0 );
+   std::string topology = "784,100,10";
+   std::string output = "sigmoid";
+   int publishInterval = 0;
+   BackpropSelector::Mode selectMode = BackpropSelector::SELECT_ALL;
+   double keepPercent = 50.0;
+   std::string profile;
+   int opt;
+   while( ( opt = getopt( argc, (char * const *)argv, "e:s:l:o:u:b:k:T:" ) ) != -1 )
+   {
+      switch( opt )
+      {
+         case 'T':
+            profile = optarg;
+            break;
+         case 'b':
+            if( !BackpropSelector::parseMode( optarg, selectMode ) )
+            {
+               usage( argc, argv );
+               return( -1 );
+            }
+            break;
+         case 'k':
+            keepPercent = std::stod( optarg );
+            break;
+         case 'u':
+            publishInterval = std::stoi( optarg );
+            break;
+         case 'e':
+            nEpochs = std::stoi( optarg );
+            break;
+         case 's':
+            seed = std::stoull( optarg );
+            break;
+         case 'l':
+            topology = optarg;
+            break;
+         case 'o':
+            output = optarg;
+            break;
+         default:
+            usage( argc, argv );
+            return( -1 );
+      }
+   }
+
+   std::vector<LayerSpec> layers;
+   if( argc - optind < 2 )
+   {
+      usage( argc, argv );
+      return( -1 );
+   }
+   if( !parseTopology( topology, output, layers ) )
+   {
+      return( -1 );
+   }
+
+   std::string trainfname = argv[optind];
+   std::string testfname = argv[optind + 1];
+   const char *modelfname = argc - optind > 2 ? argv[optind + 2] : NULL;
+
+   // Initialize the random number generator. Weight initialization and
+   // shuffling are reproducible from this seed.
+   Random::setSeed( seed );
+   printf( "Random seed: %llu\n", (unsigned long long)seed );
+
+   // By default, the neuronal network shall have 28x28=784 input neurons,
+   // 100 hidden neurons and 10 output neurons (1 for each possible digit 0..9)
+   NeuralNetwork nn( layers );
+   printf( "Topology: " );
+   for( int i = 0; i < nn.numLayers(); i++ )
+   {
+      printf( "%s%s", i > 0 ? "," : "", nn.layer( i ).toString().c_str() );
+   }
+   printf( "\n" );
+
+   // Training and testing query one sample at a time
+   if( !profile.empty() )
+   {
+      autotune::configure( nn, 1, profile, true );
+   }
+
+   // Read the training samples into memory, so they can be shuffled
+   mnist::Dataset trainSet;
+   if( !readTrainingSet( trainfname, trainSet ) )
+   {
+      return( -1 );
+   }
+
+   // Selective backpropagation starts after the first epoch, when the
+   // losses tell the easy samples from the hard ones
+   BackpropSelector selector( selectMode, keepPercent / 100.0, trainSet.size(), seed );
+
+   // *** Train the neural network
+   // *** With all annotated samples, in random order in each epoch
+   printf( "Training..\n" );
+   if( publishInterval > 0 )
+   {
+      // Evaluate snapshots of the network in the background
+      mnist::Dataset testSet;
+      if( mnist::readMNIST( testfname, testSet ) < 1 )
+      {
+         fprintf( stderr, "Couldn't read MNIST test file '%s'.\n", testfname.c_str() );
+         return( -1 );
+      }
+
+      ModelStore store( nn );
+      std::thread evaluator( evaluateSnapshots, std::ref( store ), std::cref( testSet ),
+                             publishInterval, (long)nEpochs * trainSet.size() );
+      trainNetwork( nn, trainSet, nEpochs, seed, 0.2, true, &store, publishInterval,
+                    selectMode == BackpropSelector::SELECT_ALL ? NULL : &selector );
+      evaluator.join();
+   } else
+   {
+      trainNetwork( nn, trainSet, nEpochs, seed, 0.2, true, NULL, 0,
+                    selectMode == BackpropSelector::SELECT_ALL ? NULL : &selector );
+   }
+   printf( "Finished training with %ld samples.\n", (long)nEpochs * trainSet.size() );
+
+   if( !testNetwork( nn, testfname ) || !saveNetwork( nn, modelfname ) )
+   {
+      return( -1 );
+   }
+
+   scanf( "\n" );
+
+   return( 0 );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*! 2023-12-15
+Main program
+*/
+/*----------------------------------------------------------------------------*/
+int main( int argc, const char *argv[] )
+{
+   std::string mode = argc > 1 ? argv[1] : "";
+
+   if( mode == "serve" )
+   {
+      return( runServer( argc, argv ) );
+   } else
+   if( mode == "loadgen" )
+   {
+      return( runLoadGenerator( argc, argv ) );
+   } else
+   if( mode == "bench" )
+   {
+      return( runBenchmark( argc, argv ) );
+   } else
+   if( mode == "pipeline" )
+   {
+      return( runPipeline( argc, argv ) );
+   } else
+   if( mode == "incremental" )
+   {
+      return( runIncremental( argc, argv ) );
+   } else
+   if( mode == "cache" )
+   {
+      return( runCache( argc, argv ) );
+   } else
+   if( mode == "precision" )
+   {
+      return( runPrecision( argc, argv ) );
+   } else
+   if( mode == "tune" )
+   {
+      return( runTune( argc, argv ) );
+   } else
+   if( mode == "cascade" )
+   {
+      return( runCascade( argc, argv ) );
+   } else
+   if( mode == "profile" )
+   {
+      return( runProfile( argc, argv ) );
+   } else
+   if( mode == "lowrank" )
+   {
+      return( runLowRank( argc, argv ) );
+   } else
+   if( mode == "distributed" )
+   {
+      return( runDistributed( argc, argv ) );
+   } else
+   if( mode == "online" )
+   {
+      return( runOnline( argc, argv ) );
+   } else
+   if( mode == "sweep" )
+   {
+      return( runSweep( argc, argv ) );
+   } else
+   {
+      return( runTraining( argc, argv ) );
+   }
 }
@@ -0,0 +1,290 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file mnist.cpp
+\author Christian Nowak <chnowak@web.de>
+\brief Functions for reading samples from the MNIST dataset in CSV format.
+*/
+/*----------------------------------------------------------------------------*/
+#include <string>
+
+#include "mnist.h"
+#include "util.h"
+
+namespace mnist
+{
+   /*----------------------------------------------------------------------------*/
+   /*! 2023-12-11
+   This function reads a single line from the MNIST CSV file, converts the pixel
+   data to a vector of 28x28 double values ranging from 0.01 to 1.0 an returns
+   the marker value.
+
+   \see static int readCSV( std::ifstream &infile, std::vector<double> &values )
+
+   \param infile The input file stream
+   \param imin The minimum input value to be expected from the MNIST file
+   \param imax The maximum input value to be expected from the MNIST file
+   \param dmin The minimum output value
+   \param dmax The maximum output value
+   \param values The vector of doubles which will be filled with the pixel data
+   \return The marker value
+   */
+   /*----------------------------------------------------------------------------*/
+   int readMNIST( std::ifstream &infile, int imin, int imax, double dmin, double dmax, std::vector<double> &values )
+   {
+      std::string line;
+      int marker = -1;
+      values.clear();
+
+      if( std::getline( infile, line ) )
+      {
+         line = util::trim( line );
+         std::vector<std::string> sVals = util::strsplit( line, ",", false );
+
+         if( sVals.size() > 0 )
+         {
+            marker = std::stoi( sVals[0] );
+
+            for( int i = 1; i < sVals.size(); i++ )
+            {
+               int v = std::stoi( sVals[i] );
+
+               double dv = (double)( v - imin ) / (double)( imax - imin );
+               dv = ( dv * ( dmax - dmin ) ) + dmin;
+               values.push_back( dv );
+            }
+         }
+      }
+
+      return( marker );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2023-12-11
+   In the MNIST CSV file, each line represents a sample of a handwritten digit.
+   The line begins with the marker (the actual digit as an integer value),
+   followed by 784 integer values ranging from 0 to 255 representing 28x28 pixels.
+
+   This function reads a single line from the MNIST CSV file, converts the pixel
+   data to a vector of 28x28 double values ranging from 0.01 to 1.0 an returns
+   the marker value.
+
+   \param infile The input file stream
+   \param values The vector of doubles which will be filled with the pixel data
+   \return The marker value
+   */
+   /*----------------------------------------------------------------------------*/
+   int readMNIST( std::ifstream &infile, std::vector<double> &values )
+   {
+      return( readMNIST( infile, 0, 255, 0.01, 1.0, values ) );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Read all samples of an MNIST CSV file into memory.
+
+   \param filename The name of the MNIST CSV file
+   \param inputs Receives the pixel data of each sample
+   \param digits Receives the marker value of each sample
+   \return The number of samples or -1 if the file couldn't be opened
+   */
+   /*----------------------------------------------------------------------------*/
+   int readMNIST( std::string filename, std::vector<std::vector<double> > &inputs, std::vector<int> &digits )
+   {
+      inputs.clear();
+      digits.clear();
+
+      std::ifstream infile = std::ifstream( filename );
+      if( !infile.is_open() )
+      {
+         return( -1 );
+      }
+
+      std::vector<double> values;
+      for( ;; )
+      {
+         int digit = readMNIST( infile, values );
+         if( ( digit < 0 ) || ( values.size() != 28 * 28 ) )
+         {
+            break;
+         }
+
+         inputs.push_back( values );
+         digits.push_back( digit );
+      }
+
+      infile.close();
+
+      return( inputs.size() );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Read all samples of an MNIST CSV file into memory, one byte per pixel. The
+   levels table maps each pixel value to exactly the same input value as
+   readMNIST( std::ifstream &infile, int imin, int imax, double dmin, double dmax, std::vector<double> &values ).
+
+   \param filename The name of the MNIST CSV file
+   \param imin The minimum input value to be expected from the MNIST file
+   \param imax The maximum input value to be expected from the MNIST file
+   \param dmin The minimum output value
+   \param dmax The maximum output value
+   \param dataset Receives the samples
+   \return The number of samples or -1 if the file couldn't be opened
+   */
+   /*----------------------------------------------------------------------------*/
+   int readMNIST( std::string filename, int imin, int imax, double dmin, double dmax, Dataset &dataset )
+   {
+      dataset.pixels.clear();
+      dataset.digits.clear();
+      dataset.sampleSize = 28 * 28;
+      for( int v = 0; v < 256; v++ )
+      {
+         double dv = (double)( v - imin ) / (double)( imax - imin );
+         dataset.levels[v] = ( dv * ( dmax - dmin ) ) + dmin;
+      }
+
+      std::ifstream infile = std::ifstream( filename );
+      if( !infile.is_open() )
+      {
+         return( -1 );
+      }
+
+      std::string line;
+      while( std::getline( infile, line ) )
+      {
+         line = util::trim( line );
+         std::vector<std::string> sVals = util::strsplit( line, ",", false );
+         if( sVals.size() != dataset.sampleSize + 1 )
+         {
+            break;
+         }
+
+         int digit = std::stoi( sVals[0] );
+         if( digit < 0 )
+         {
+            break;
+         }
+
+         for( int i = 1; i < sVals.size(); i++ )
+         {
+            int v = std::stoi( sVals[i] );
+            dataset.pixels.push_back( v < 0 ? 0 : ( v > 255 ? 255 : v ) );
+         }
+         dataset.digits.push_back( digit );
+      }
+
+      infile.close();
+
+      return( dataset.size() );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Read all samples of an MNIST CSV file into memory, one byte per pixel, with
+   the pixel values mapped to input values from 0.01 to 1.0.
+
+   \param filename The name of the MNIST CSV file
+   \param dataset Receives the samples
+   \return The number of samples or -1 if the file couldn't be opened
+   */
+   /*----------------------------------------------------------------------------*/
+   int readMNIST( std::string filename, Dataset &dataset )
+   {
+      return( readMNIST( filename, 0, 255, 0.01, 1.0, dataset ) );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \return The number of samples
+   */
+   /*----------------------------------------------------------------------------*/
+   int Dataset::size() const
+   {
+      return( digits.size() );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   \param n The index of a sample
+   \return The pixels of the sample
+   */
+   /*----------------------------------------------------------------------------*/
+   const uint8_t *Dataset::sample( int n ) const
+   {
+      return( pixels.data() + (size_t)n * sampleSize );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Expand a sample into input values.
+   \param n The index of a sample
+   \param values Receives the input values
+   */
+   /*----------------------------------------------------------------------------*/
+   void Dataset::input( int n, std::vector<double> &values ) const
+   {
+      const uint8_t *p = sample( n );
+      values.resize( sampleSize );
+      for( int i = 0; i < sampleSize; i++ )
+      {
+         values[i] = levels[p[i]];
+      }
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2023-12-12
+   Our neural network has 28x28=784 input neurons for the pixel data of a
+   handwritten decimal digit and 10 output neurons, each indicating the detection
+   of a specific decimal digit. I.e. if neuron n (n=0..9) is close to 1.0, that
+   means that decimal digit n has been detected.
+   This function converts the value of a decimal digit n, given as an integer
+   parameter, to an expected output vector consisting of 10 double values where
+   only element #n is 'trueVal' (usually = 1.0) and all other elements are
+   'falseVal' (usually = 0.0).
+
+   \param digit The digit, ranging from 0 to 9
+   \param falseVal The double value indicating non-detection
+   \param trueVal The double value indicating detection
+   \return The output vector which can be compared to the output vector of our
+   neural network
+   */
+   /*----------------------------------------------------------------------------*/
+   std::vector<double> convertToExpectedOut( int digit, double falseVal, double trueVal )
+   {
+      std::vector<double> r;
+
+      for( int i = 0; i < 10; i++ )
+      {
+         r.push_back( i == digit ? trueVal : falseVal );
+      }
+
+      return( r );
+   }
+}
@@ -0,0 +1,75 @@
+/*******************************************************************************
+ *  Copyright (c) 2024 Christian Nowak <chnowak@web.de>                        *
+ *   This file is part of NeuralNetwork.                                       *
+ *                                                                             *
+ *  NeuralNetwork is free software: you can redistribute it and/or modify it   *
+ *  under the terms of the GNU General Public License as published by the Free *
+ *  Software Foundation, either version 3 of the License, or (at your option)  *
+ *  any later version.                                                         *
+ *                                                                             *          
+ *  NeuralNetwork is distributed in the hope that it will be useful, but       * 
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY *
+ *  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License    *
+ *  for more details.                                                          *
+ *                                                                             *
+ *  You should have received a copy of the GNU General Public License along    *
+ *  with NeuralNetwork. If not, see <https://www.gnu.org/licenses/>.           *
+ *******************************************************************************/
+
+
+/*----------------------------------------------------------------------------*/
+/*!
+\file mnist.h
+\author Christian Nowak <chnowak@web.de>
+\brief Headerfile for the MNIST CSV reading functions
+*/
+/*----------------------------------------------------------------------------*/
+#ifndef __MNIST_H__
+#define __MNIST_H__
+
+#include <stdint.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace mnist
+{
+   /*----------------------------------------------------------------------------*/
+   /*!
+   \struct Dataset
+   \date  2026-10-18
+   The samples of an MNIST CSV file, kept as one byte per pixel. The affine
+   map from the pixel values to the input values of a network is applied
+   while a sample is fed into the network, by looking up each pixel value in
+   the levels table.
+   */
+   /*----------------------------------------------------------------------------*/
+   struct Dataset
+   {
+      // The pixels of all samples, sampleSize bytes per sample
+      std::vector<uint8_t> pixels;
+
+      // The marker value of each sample
+      std::vector<int> digits;
+
+      // The number of pixels of each sample
+      int sampleSize;
+
+      // The input value of each pixel value
+      double levels[256];
+
+      int size() const;
+      const uint8_t *sample( int n ) const;
+      void input( int n, std::vector<double> &values ) const;
+   };
+
+   int readMNIST( std::ifstream &infile, int imin, int imax, double dmin, double dmax, std::vector<double> &values );
+   int readMNIST( std::ifstream &infile, std::vector<double> &values );
+   int readMNIST( std::string filename, std::vector<std::vector<double> > &inputs, std::vector<int> &digits );
+   int readMNIST( std::string filename, int imin, int imax, double dmin, double dmax, Dataset &dataset );
+   int readMNIST( std::string filename, Dataset &dataset );
+   std::vector<double> convertToExpectedOut( int digit, double falseVal, double trueVal );
+}
+
+#endif
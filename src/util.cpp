@@ -25,6 +25,11 @@
 */
 /*----------------------------------------------------------------------------*/
 
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#include "Random.h"
 #include "util.h"
 
 namespace util
@@ -122,7 +127,8 @@ namespace util
 
    /*----------------------------------------------------------------------------*/
    /*! 2023-12-15
-   Generate a random floating point value within given limits.
+   Generate a random floating point value within given limits, drawn from the
+   calling thread's random stream (see Random::threadLocal()).
    \param min The lower limit
    \param max The upper limit
    \return The generated random value
@@ -134,11 +140,156 @@ namespace util
       {
          double tmp = min;
          min = max;
-         max = min;
+         max = tmp;
+      }
+
+      return( Random::threadLocal().uniform( min, max ) );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Determine the p-th percentile of a set of values with the nearest-rank method.
+   \param values The values, in any order
+   \param p The percentile, ranging from 0.0 to 100.0
+   \return The smallest value that is greater than or equal to p percent of
+   all values, or 0.0 if there are no values
+   */
+   /*----------------------------------------------------------------------------*/
+   double percentile( std::vector<double> values, double p )
+   {
+      if( values.size() < 1 )
+      {
+         return( 0.0 );
+      }
+
+      // The rank is 1-based, the index into the vector is 0-based
+      size_t rank = (size_t)ceil( ( p / 100.0 ) * values.size() );
+      if( rank > 0 )
+      {
+         rank--;
+      }
+      if( rank >= values.size() )
+      {
+         rank = values.size() - 1;
+      }
+
+      std::nth_element( values.begin(), values.begin() + rank, values.end() );
+
+      return( values[rank] );
+   }
+
+
+   // The primes of xxHash64
+   static const uint64_t XXH_PRIME64_1 = 0x9E3779B185EBCA87ull;
+   static const uint64_t XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+   static const uint64_t XXH_PRIME64_3 = 0x165667B19E3779F9ull;
+   static const uint64_t XXH_PRIME64_4 = 0x85EBCA77C2B2AE63ull;
+   static const uint64_t XXH_PRIME64_5 = 0x27D4EB2F165667C5ull;
+
+   static inline uint64_t rotl64( uint64_t x, int r )
+   {
+      return( ( x << r ) | ( x >> ( 64 - r ) ) );
+   }
+
+   static inline uint64_t read64( const uint8_t *p )
+   {
+      uint64_t v;
+      memcpy( &v, p, sizeof( v ) );
+      return( v );
+   }
+
+   static inline uint32_t read32( const uint8_t *p )
+   {
+      uint32_t v;
+      memcpy( &v, p, sizeof( v ) );
+      return( v );
+   }
+
+   static inline uint64_t xxhRound( uint64_t acc, uint64_t input )
+   {
+      acc += input * XXH_PRIME64_2;
+      acc = rotl64( acc, 31 );
+      return( acc * XXH_PRIME64_1 );
+   }
+
+   static inline uint64_t xxhMergeRound( uint64_t acc, uint64_t v )
+   {
+      acc ^= xxhRound( 0, v );
+      return( acc * XXH_PRIME64_1 + XXH_PRIME64_4 );
+   }
+
+
+   /*----------------------------------------------------------------------------*/
+   /*! 2026-10-18
+   Calculate the 64 bit xxHash (XXH64) of a block of memory, a fast
+   non-cryptographic hash function which processes 32 bytes per iteration in
+   four independent lanes. The result is the same as that of the reference
+   implementation on little-endian machines.
+
+   \param data The data
+   \param len The length of the data in bytes
+   \param seed The seed
+   \return The hash
+   */
+   /*----------------------------------------------------------------------------*/
+   uint64_t xxHash64( const void *data, size_t len, uint64_t seed )
+   {
+      const uint8_t *p = (const uint8_t *)data;
+      const uint8_t *end = p + len;
+      uint64_t h;
+
+      if( len >= 32 )
+      {
+         uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+         uint64_t v2 = seed + XXH_PRIME64_2;
+         uint64_t v3 = seed;
+         uint64_t v4 = seed - XXH_PRIME64_1;
+
+         for( ; p + 32 <= end; p += 32 )
+         {
+            v1 = xxhRound( v1, read64( p ) );
+            v2 = xxhRound( v2, read64( p + 8 ) );
+            v3 = xxhRound( v3, read64( p + 16 ) );
+            v4 = xxhRound( v4, read64( p + 24 ) );
+         }
+
+         h = rotl64( v1, 1 ) + rotl64( v2, 7 ) + rotl64( v3, 12 ) + rotl64( v4, 18 );
+         h = xxhMergeRound( h, v1 );
+         h = xxhMergeRound( h, v2 );
+         h = xxhMergeRound( h, v3 );
+         h = xxhMergeRound( h, v4 );
+      } else
+      {
+         h = seed + XXH_PRIME64_5;
+      }
+
+      h += len;
+
+      for( ; p + 8 <= end; p += 8 )
+      {
+         h ^= xxhRound( 0, read64( p ) );
+         h = rotl64( h, 27 ) * XXH_PRIME64_1 + XXH_PRIME64_4;
+      }
+      if( p + 4 <= end )
+      {
+         h ^= (uint64_t)read32( p ) * XXH_PRIME64_1;
+         h = rotl64( h, 23 ) * XXH_PRIME64_2 + XXH_PRIME64_3;
+         p += 4;
+      }
+      for( ; p < end; p++ )
+      {
+         h ^= (uint64_t)*p * XXH_PRIME64_5;
+         h = rotl64( h, 11 ) * XXH_PRIME64_1;
       }
 
-      double v = (double)std::rand() / (double)RAND_MAX; // v = [0.0 .. 1.0]
+      // Avalanche
+      h ^= h >> 33;
+      h *= XXH_PRIME64_2;
+      h ^= h >> 29;
+      h *= XXH_PRIME64_3;
+      h ^= h >> 32;
 
-      return( ( v * ( max - min ) ) + min );
+      return( h );
    }
 }
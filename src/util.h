@@ -27,6 +27,9 @@
 #ifndef __UTIL_H__
 #define __UTIL_H__
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include <vector>
 #include <string>
 
@@ -36,6 +39,8 @@ namespace util
    std::string trim( std::string s );
    std::vector<std::string> strsplit( std::string str, std::string sep, bool keepEmpty );
    double randomValue( double min, double max );
+   double percentile( std::vector<double> values, double p );
+   uint64_t xxHash64( const void *data, size_t len, uint64_t seed );
 }
 
 #endif